@@ -0,0 +1,117 @@
+#ifndef XTCINPUT_CHUNKPREFETCHER_H
+#define XTCINPUT_CHUNKPREFETCHER_H
+
+//--------------------------------------------------------------------------
+// File and Version Information:
+// 	$Id$
+//
+// Description:
+//	Class ChunkPrefetcher.
+//
+//------------------------------------------------------------------------
+
+//-----------------
+// C/C++ Headers --
+//-----------------
+#include <string>
+#include <boost/shared_ptr.hpp>
+#include <boost/utility.hpp>
+
+//----------------------
+// Base Class Headers --
+//----------------------
+
+//-------------------------------
+// Collaborating Class Headers --
+//-------------------------------
+#include "XtcInput/DgHeader.h"
+#include "XtcInput/MemoryGovernor.h"
+#include "XtcInput/ResumableBuffer.h"
+#include "XtcInput/XtcFileName.h"
+
+//------------------------------------
+// Collaborating Class Declarations --
+//------------------------------------
+namespace XtcInput {
+class XtcChunkDgIter;
+}
+
+//		---------------------
+// 		-- Class Interface --
+//		---------------------
+
+namespace XtcInput {
+
+/// @addtogroup XtcInput
+
+/**
+ *  @ingroup XtcInput
+ *
+ *  @brief Reads complete datagrams of one chunk file in the background.
+ *
+ *  Constructor submits a Prefetch task to TaskScheduler which reads the
+ *  chunk front to back with XtcChunkDgIter and keeps complete datagrams in
+ *  memory, up to maxBytes (see ResumableBuffer). The task returns when the
+ *  memory is full and next() submits it again after half of it is free.
+ *  Several instances for consecutive chunks of a stream read from their
+ *  files at the same time, which helps when chunks are on different storage
+ *  targets. Only used for closed (not live) files.
+ *
+ *  Datagrams in memory are reserved in MemoryGovernor, which also limits
+ *  how far ahead the task reads when memory gets tight.
+ *
+ *  This software was developed for the LCLS project.  If you use all or
+ *  part of it, please give an appropriate acknowledgment.
+ *
+ *  @version $Id$
+ */
+
+class ChunkPrefetcher : boost::noncopyable {
+public:
+
+  /**
+   *  @brief Start reading the file.
+   *
+   *  @param[in] path      chunk file name
+   *  @param[in] maxBytes  reading pauses when this many bytes are waiting for next()
+   *  @param[in] memory    memory budget of the reader, zero pointer for no limit
+   *  @param[in] segmentedDgrams passed to DgHeader::dgram()
+   */
+  ChunkPrefetcher(const XtcFileName& path, size_t maxBytes,
+                  const boost::shared_ptr<MemoryGovernor>& memory = boost::shared_ptr<MemoryGovernor>(),
+                  bool segmentedDgrams = false);
+
+  // Destructor stops the reading task
+  ~ChunkPrefetcher();
+
+  /**
+   *  @brief Returns next datagram header with complete datagram, zero on EOF.
+   *
+   *  Waits until the reading task has the datagram, runs the task here if
+   *  no pool thread has started it yet.
+   *
+   *  Exception thrown by the reading task (XTCReadException,
+   *  XTCExtentException, FileOpenException, ...) is re-thrown here after
+   *  all datagrams read before it.
+   */
+  boost::shared_ptr<DgHeader> next();
+
+  /// Returns XtcFileName for this chunk
+  const XtcFileName& path() const { return m_path; }
+
+protected:
+
+  // read next complete datagram, false on EOF, called by the reading task
+  bool readNext(boost::shared_ptr<DgHeader>& hptr);
+
+private:
+
+  XtcFileName m_path;
+  bool m_segmentedDgrams;
+  boost::shared_ptr<XtcChunkDgIter> m_iter;          ///< used by reading task only
+  ResumableBuffer<boost::shared_ptr<DgHeader> > m_buffer;  ///< datagrams read so far, destroyed first
+};
+
+} // namespace XtcInput
+
+#endif // XTCINPUT_CHUNKPREFETCHER_H
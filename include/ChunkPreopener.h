@@ -0,0 +1,97 @@
+#ifndef XTCINPUT_CHUNKPREOPENER_H
+#define XTCINPUT_CHUNKPREOPENER_H
+
+//--------------------------------------------------------------------------
+// File and Version Information:
+// 	$Id$
+//
+// Description:
+//	Class ChunkPreopener.
+//
+//------------------------------------------------------------------------
+
+//-----------------
+// C/C++ Headers --
+//-----------------
+#include <exception>
+#include <boost/shared_ptr.hpp>
+#include <boost/utility.hpp>
+
+//----------------------
+// Base Class Headers --
+//----------------------
+
+//-------------------------------
+// Collaborating Class Headers --
+//-------------------------------
+#include "XtcInput/ChunkFileIterI.h"
+#include "XtcInput/TaskScheduler.h"
+#include "XtcInput/XtcChunkDgIter.h"
+
+//------------------------------------
+// Collaborating Class Declarations --
+//------------------------------------
+
+//		---------------------
+// 		-- Class Interface --
+//		---------------------
+
+namespace XtcInput {
+
+/// @addtogroup XtcInput
+
+/**
+ *  @ingroup XtcInput
+ *
+ *  @brief Opens next chunk of a stream in the background.
+ *
+ *  Constructor submits a task to TaskScheduler which gets next file name from chunk
+ *  iterator (for live data this finds the .inprogress file), opens the
+ *  file and reads its first bytes into the page cache. The chunk iterator
+ *  must not be used by anybody else until get() returns.
+ *
+ *  This software was developed for the LCLS project.  If you use all or
+ *  part of it, please give an appropriate acknowledgment.
+ *
+ *  @version $Id$
+ */
+
+class ChunkPreopener : boost::noncopyable {
+public:
+
+  /**
+   *  @brief Start opening next chunk.
+   *
+   *  @param[in] chunkIter  iterator over chunks in a stream
+   *  @param[in] warmBytes  number of bytes at the start of the file to read
+   */
+  ChunkPreopener(const boost::shared_ptr<ChunkFileIterI>& chunkIter, size_t warmBytes);
+
+  // Destructor cancels the task or waits for it
+  ~ChunkPreopener();
+
+  /**
+   *  @brief Returns iterator for the next chunk, zero pointer if there are no more chunks.
+   *
+   *  Waits for the task (or runs it here if it has not started), exceptions
+   *  from the task (like XTCLiveTimeout) are re-thrown here.
+   */
+  boost::shared_ptr<XtcChunkDgIter> get();
+
+protected:
+
+  // body of the task
+  void run();
+
+private:
+
+  boost::shared_ptr<ChunkFileIterI> m_chunkIter;
+  size_t m_warmBytes;
+  boost::shared_ptr<XtcChunkDgIter> m_dgiter;   ///< result
+  std::exception_ptr m_exception;               ///< exception from the task
+  boost::shared_ptr<TaskScheduler::Task> m_task;
+};
+
+} // namespace XtcInput
+
+#endif // XTCINPUT_CHUNKPREOPENER_H
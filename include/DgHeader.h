@@ -13,6 +13,7 @@
 //-----------------
 // C/C++ Headers --
 //-----------------
+#include <boost/shared_ptr.hpp>
 #include <boost/utility.hpp>
 
 //----------------------
@@ -30,6 +31,9 @@
 //------------------------------------
 // Collaborating Class Declarations --
 //------------------------------------
+namespace XtcInput {
+class SegmentedDgram;
+}
 
 //		---------------------
 // 		-- Class Interface --
@@ -48,6 +52,11 @@ namespace XtcInput {
  *  as read from a file and it also knows how to read remaining
  *  datagram from a file.
  *
+ *  Datagrams larger than the contiguous limit (256MB) are rejected by
+ *  dgram() unless the caller asks for segments: then they are read with
+ *  segmentedDgram() and returned as SegmentedDgram::wrap() pointers, other
+ *  datagrams are always read into one buffer.
+ *
  *  This software was developed for the LCLS project.  If you use all or 
  *  part of it, please give an appropriate acknowledgment.
  *
@@ -68,6 +77,17 @@ public:
    */
   DgHeader(const Pds::Dgram& header, const SharedFile& file, off_t off);
 
+  /**
+   *  Constructor for datagram which has been read into memory already,
+   *  dgram() returns it without reading the file. Header of a segmented
+   *  datagram is taken from its SegmentedDgram.
+   *
+   *  @param[in] dgram    Complete datagram
+   *  @param[in] file     File object
+   *  @param[in] off      Location of this datagram in a file
+   */
+  DgHeader(const Dgram::ptr& dgram, const SharedFile& file, off_t off);
+
   /// Returns offset of the next header (if there is any)
   off_t nextOffset() const;
 
@@ -83,21 +103,53 @@ public:
   /// Get damage
   Pds::Damage damage() const { return m_header.xtc.damage; }
 
-  /// Reads complete datagram into memory
-  Dgram::ptr dgram();
+  /**
+   *  Reads complete datagram into memory. Returns zero pointer on
+   *  premature EOF.
+   *
+   *  @param[in] segmented  if true then datagram above the contiguous limit
+   *                        is returned as SegmentedDgram::wrap() pointer, its
+   *                        top-level XTC has no payload and consumers find
+   *                        the children with SegmentedDgram::find()
+   *
+   *  @throw XTCSizeLimitException if datagram is above the limit and segmented is false
+   */
+  Dgram::ptr dgram(bool segmented = false);
+
+  /**
+   *  Reads complete datagram into memory with every child XTC of the
+   *  top-level XTC in its own buffer, for datagrams of any size. Returns
+   *  zero pointer on premature EOF like dgram().
+   *
+   *  @throw XTCExtentException if extent is smaller than XTC header or goes
+   *         past the end of a file which does not grow, or if children do not
+   *         match the top-level XTC
+   *  @throw XTCSizeLimitException if one child is larger than the contiguous limit
+   */
+  boost::shared_ptr<const SegmentedDgram> segmentedDgram();
 
   /// Get file name for this header
   const XtcFileName& path() const { return m_file.path(); }
 
+  /// Get id of the file name in XtcFileTable
+  XtcFileTable::FileId fileId() const { return m_file.fileId(); }
+
+  /// Get file where this header was read from
+  const SharedFile& file() const { return m_file; }
+
   /// Get the offset of this dgram in the file
   const off_t offset() const { return m_off; }
 protected:
 
 private:
 
+  // protection against corrupted headers before a segmented read
+  void checkExtent(bool inFile);
+
   Pds::Dgram m_header; ///< Actual datagram header
   SharedFile m_file;   ///< File where this datagram header was read from
   off_t      m_off;    ///< Location of this datagram in a file
+  Dgram::ptr m_dgram;  ///< Complete datagram if it was read already
   
 };
 
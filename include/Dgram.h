@@ -13,6 +13,7 @@
 //-----------------
 // C/C++ Headers --
 //-----------------
+#include <utility>
 #include <boost/shared_ptr.hpp>
 
 //----------------------
@@ -24,6 +25,7 @@
 //-------------------------------
 #include "pdsdata/xtc/Dgram.hh"
 #include "XtcInput/XtcFileName.h"
+#include "XtcInput/XtcFileTable.h"
 
 //------------------------------------
 // Collaborating Class Declarations --
@@ -39,7 +41,13 @@ namespace XtcInput {
  *  @brief Wrapper for Pds::Dgram class.
  *  
  *  This class wraps Pds::Datagram class and also adds some additional 
- *  context information to it such as file name and position.
+ *  context information to it such as file name and position. File name
+ *  is kept as an id in XtcFileTable, copies of Dgram do not copy strings.
+ *
+ *  Reader passes datagrams from stage to stage by moving Dgram objects,
+ *  moving does not touch the reference count of the datagram. Datagrams
+ *  read by this package are made with allocate(), which keeps the reference
+ *  count in the same memory block as the datagram.
  *  
  *  This software was developed for the LCLS project.  If you use all or 
  *  part of it, please give an appropriate acknowledgment.
@@ -59,22 +67,45 @@ public:
    */
   static ptr make_ptr(Pds::Dgram* dg) ;
 
+  /**
+   *  @brief Allocates memory for a datagram of given size (header + payload).
+   *
+   *  Datagram and its reference count are in one memory block, there is
+   *  only one allocation per datagram. Memory is not initialized.
+   */
+  static ptr allocate(size_t size) ;
+
   /**
    *  Constructor takes a smart pointer to XTC datagram object, the file name 
    *  where datagram has originated, and optionally the offset within the file
    */
- Dgram(const ptr& dg, XtcFileName file, off64_t offset=-1) : m_dg(dg), m_file(file), m_offset(offset) {}
+  Dgram(const ptr& dg, const XtcFileName& file, off64_t offset=-1)
+    : m_dg(dg), m_file(XtcFileTable::instance().intern(file)), m_offset(offset) {}
+
+  /**
+   *  Same as above but takes file id from XtcFileTable, use this one when
+   *  the id is known already (see SharedFile::fileId()). Pointer is taken
+   *  by value, pass an rvalue to move it in.
+   */
+  Dgram(ptr dg, XtcFileTable::FileId file, off64_t offset=-1)
+    : m_dg(std::move(dg)), m_file(file), m_offset(offset) {}
 
   /**
    *  Default ctor
    */
-  Dgram() : m_dg(), m_file() {}
+  Dgram() : m_dg(), m_file(XtcFileTable::EmptyId), m_offset(-1) {}
 
   /// Return pointer to the datagream
-  ptr dg() const { return m_dg; }
+  const ptr& dg() const { return m_dg; }
+
+  /// Moves pointer to the datagram out, this object becomes empty
+  ptr release() { ptr dg; dg.swap(m_dg); m_file = XtcFileTable::EmptyId; m_offset = -1; return dg; }
   
   /// Return file name
-  const XtcFileName& file() const { return m_file; }
+  const XtcFileName& file() const { return XtcFileTable::instance().name(m_file); }
+
+  /// Return id of the file name in XtcFileTable
+  XtcFileTable::FileId fileId() const { return m_file; }
 
   bool empty() const { return not m_dg.get(); }
   
@@ -102,7 +133,7 @@ private:
 
   // Data members
   ptr m_dg;
-  XtcFileName m_file;
+  XtcFileTable::FileId m_file;
   off64_t m_offset;
 };
 
@@ -4,16 +4,24 @@
 #include <vector>
 
 #include "XtcInput/Dgram.h"
+#include "XtcInput/SmallVector.h"
 
 namespace XtcInput {
 
 /**
  *  @ingroup XtcInput
- *  
+ *
  *  @brief Class to hold list of Pds::Dgram's placed into the event store.
  *
  *  The primary purpose of this is to hide the full C++ name frome EventKeys.
- *  
+ *  File names are kept as XtcFileTable ids, getFileNames() resolves them.
+ *
+ *  Datagrams, file ids, offsets and stream numbers are kept in separate
+ *  arrays (dgrams(), fileIds(), offsets(), streams()) which hold up to
+ *  InlineSize entries without allocating memory. These accessors and the
+ *  per-datagram ones do not copy anything. getDgrams(), getFileNames() and
+ *  getOffsets() return copies in std::vector as before.
+ *
  *  @author David Schneider
  */
 
@@ -24,26 +32,67 @@ public:
   typedef std::vector<XtcInput::XtcFileName> FileListImpl;
 
   typedef std::vector<off64_t> OffsetImpl;
-  
-  DgramListImpl getDgrams() const { return m_dgramList; };
-  
-  FileListImpl getFileNames() const { return m_filenameList; };
-  
-  OffsetImpl getOffsets() const { return m_offsetList; };
-
-  size_t size() const { return m_dgramList.size(); }
-  
+
+  /// events with up to this many datagrams do not allocate memory for the list
+  enum { InlineSize = 8 };
+
+  typedef SmallVector<XtcInput::Dgram::ptr, InlineSize> Dgrams;
+  typedef SmallVector<XtcInput::XtcFileTable::FileId, InlineSize> FileIds;
+  typedef SmallVector<off64_t, InlineSize> Offsets;
+  typedef SmallVector<unsigned, InlineSize> Streams;
+
+  DgramListImpl getDgrams() const { return m_dgrams.toVector(); };
+
+  FileListImpl getFileNames() const;
+
+  OffsetImpl getOffsets() const { return m_offsets.toVector(); };
+
+  /// all datagrams, no copy
+  const Dgrams& dgrams() const { return m_dgrams; }
+
+  /// XtcFileTable ids of the files of all datagrams, no copy
+  const FileIds& fileIds() const { return m_fileIds; }
+
+  /// offsets of all datagrams in their files, no copy
+  const Offsets& offsets() const { return m_offsets; }
+
+  /// stream numbers of all datagrams, no copy
+  const Streams& streams() const { return m_streams; }
+
+  /// datagram i
+  const Dgram::ptr& dg(size_t i) const { return m_dgrams[i]; }
+
+  /// file name of datagram i
+  const XtcFileName& file(size_t i) const { return XtcFileTable::instance().name(m_fileIds[i]); }
+
+  /// offset of datagram i
+  off64_t offset(size_t i) const { return m_offsets[i]; }
+
+  /// index of the datagram from given stream, -1 if there is none
+  int findStream(unsigned stream) const;
+
+  size_t size() const { return m_dgrams.size(); }
+
+  /// make room for n datagrams
+  void reserve(size_t n);
+
   void push_back(const XtcInput::Dgram & dg);
 
+  /// same as above, moves the datagram in and leaves dg empty
+  void push_back(XtcInput::Dgram && dg);
+
+  /// moves datagram i out of the list, its slot keeps zero pointer
+  Dgram take(size_t i);
+
   Dgram::ptr frontDg() const;
 
  private:
-  DgramListImpl m_dgramList;
-  FileListImpl m_filenameList;
-  OffsetImpl m_offsetList;
+  Dgrams m_dgrams;
+  FileIds m_fileIds;
+  Offsets m_offsets;
+  Streams m_streams;
 };
-   
+
 }; // namespace
 
 #endif
-
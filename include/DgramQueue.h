@@ -13,11 +13,12 @@
 //-----------------
 // C/C++ Headers --
 //-----------------
-#include <boost/thread/condition.hpp>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <stdint.h>
 #include <boost/thread/mutex.hpp>
 #include <boost/utility.hpp>
-#include <queue>
-#include <string>
 #include <unistd.h>
 
 //----------------------
@@ -28,6 +29,7 @@
 // Collaborating Class Headers --
 //-------------------------------
 #include "XtcInput/Dgram.h"
+#include "XtcInput/DgramList.h"
 
 //------------------------------------
 // Collaborating Class Declarations --
@@ -46,6 +48,28 @@ namespace XtcInput {
  *
  *  @brief Synchronized datagram queue.
  *
+ *  Bounded single-producer/single-consumer ring: push(), pushEvent() and
+ *  push_exception() are called by one thread, pop() and front() by
+ *  another one, clear() by either of them. Indices of the two sides are
+ *  on separate cache lines and no lock is taken when the queue is neither
+ *  empty nor full. A thread which has to wait spins for a short time and
+ *  then sleeps on a futex; sleeping is an interruption point for
+ *  boost::thread::interrupt() like the waits on boost::condition were.
+ *
+ *  Capacity is a number of datagrams and optionally a number of bytes
+ *  (header plus payload of each datagram). With a byte limit the producer
+ *  also waits until the datagrams fit into it, a datagram larger than the
+ *  limit is only added to an empty queue.
+ *
+ *  With DropOldL1Accepts overflow policy (meant for live monitoring) a
+ *  producer which finds the queue full does not wait: the oldest L1Accept
+ *  datagrams in the queue are dropped until the new ones fit, always whole
+ *  events (adjacent L1Accepts with the same fiducials). Transitions are
+ *  never dropped, producer waits as usual if only transitions are queued.
+ *  Datagrams of a dropped event which arrive later are dropped too; an
+ *  event which the consumer has started to pop may still lose the rest.
+ *  droppedEvents() and droppedDgrams() count what was dropped.
+ *
  *  This software was developed for the LUSI project.  If you use all or
  *  part of it, please give an appropriate acknowledgment.
  *
@@ -59,8 +83,20 @@ public:
 
   typedef Dgram value_type ;
 
-  // Default constructor
-  DgramQueue (size_t maxSize) ;
+  /// What producer does when the queue is full
+  enum OverflowPolicy {
+    Block,              ///< wait until consumer takes datagrams
+    DropOldL1Accepts    ///< drop oldest L1Accept events, wait only for transitions
+  };
+
+  /**
+   *  @brief Constructor.
+   *
+   *  @param[in] maxSize   max. number of datagrams in the queue
+   *  @param[in] maxBytes  max. total size of datagrams in the queue, 0 for no limit
+   *  @param[in] overflow  what producer does when the queue is full
+   */
+  DgramQueue (size_t maxSize, size_t maxBytes = 0, OverflowPolicy overflow = Block) ;
 
   // Destructor
   ~DgramQueue () ;
@@ -69,6 +105,23 @@ public:
   // is full already then wait until somebody calls pop()
   void push (const value_type& dg) ;
 
+  // same as above, moves the datagram into the queue
+  void push (value_type&& dg) ;
+
+  // add all datagrams of one event to the queue in one go, waits until
+  // there is space for the whole event (event larger than the queue is
+  // added in parts)
+  void pushEvent (const DgramList& event) ;
+
+  // same as above, moves the datagrams into the queue
+  void pushEvent (DgramList&& event) ;
+
+  // add several datagrams to the queue in one go, same as pushEvent()
+  void pushBatch (const std::vector<value_type>& dgs) ;
+
+  // same as above, moves the datagrams into the queue
+  void pushBatch (std::vector<value_type>&& dgs) ;
+
   // Producer thread may signal consumer thread that exception had
   // happened by calling push_exception() with non-empty message.
   void push_exception (const std::string& msg) ;
@@ -85,20 +138,115 @@ public:
   // wit the corresponding message.
   value_type front();
 
+  /**
+   *  @brief Move up to maxN datagrams from the head of the queue into dgs.
+   *
+   *  Replaces contents of dgs, returns number of datagrams. Waits until
+   *  the queue is not empty for at most timeoutMs milliseconds (without
+   *  limit if negative, not at all if zero) and returns 0 on timeout.
+   *  Exception from push_exception() is thrown like in pop().
+   */
+  size_t popBatch (std::vector<value_type>& dgs, size_t maxN, int timeoutMs = -1) ;
+
+  /**
+   *  @brief Copy up to k datagrams from the head of the queue into window.
+   *
+   *  Replaces contents of window, datagrams stay in the queue. Does not
+   *  wait, returns number of datagrams which are in the queue now (at most k).
+   */
+  size_t peek (std::vector<value_type>& window, size_t k) ;
+
   // completely erase all queue
   void clear() ;
 
+  /// Returns max. number of datagrams
+  size_t maxSize() const { return m_maxSize; }
+
+  /// Returns max. number of bytes, 0 if there is no byte limit
+  size_t maxBytes() const { return m_maxBytes; }
+
+  /// Returns total size of datagrams in the queue now
+  size_t bytes() const ;
+
+  /// Returns largest value of bytes() seen so far
+  size_t peakBytes() const { return m_peakBytes.load(std::memory_order_relaxed); }
+
+  /// Returns overflow policy
+  OverflowPolicy overflowPolicy() const { return m_overflow; }
+
+  /// Returns number of L1Accept events dropped so far
+  uint64_t droppedEvents() const { return m_droppedEvents.load(std::memory_order_relaxed); }
+
+  /// Returns number of datagrams dropped so far
+  uint64_t droppedDgrams() const { return m_droppedDgrams.load(std::memory_order_relaxed); }
+
 protected:
 
+  // producer: wait until there are n free slots and bytes fit
+  void waitForSpace (size_t n, size_t bytes) ;
+
+  // producer: check for space with m_cachedHead and m_cachedBytesOut
+  bool hasSpace (size_t tail, size_t n, size_t bytes) const ;
+
+  // producer: make n slots after the tail visible to the consumer
+  void publish (size_t n, size_t bytes) ;
+
+  // producer: drop oldest L1Accept events until n datagrams of given size
+  // fit, returns false if nothing could be dropped
+  bool dropOldL1Accepts (size_t n, size_t bytes) ;
+
+  // producer: true if dg belongs to the event which was dropped last
+  bool restOfDropped (const value_type& dg) const ;
+
+  // consumer: wait until the queue is not empty or there is an exception,
+  // returns true with m_consumerBusy set or false after timeoutMs (if not negative)
+  bool waitForData (int timeoutMs = -1) ;
+
+  // consumer: set m_consumerBusy unless clear() is running
+  void enterConsumer () ;
+
+  // consumer: throw exception from push_exception() if there is one
+  void throwException () ;
+
 private:
 
+  enum { CacheLine = 64 };
+
   // Data members
   size_t m_maxSize ;
-  std::queue<value_type> m_queue ;
+  size_t m_maxBytes ;
+  OverflowPolicy m_overflow ;
+  size_t m_mask ;                           ///< ring size minus one, ring size is power of 2
+  std::vector<value_type> m_ring ;
+
+  // written by consumer
+  char m_pad0[CacheLine];
+  std::atomic<size_t> m_head ;              ///< next slot to pop
+  std::atomic<uint64_t> m_bytesOut ;        ///< bytes of all popped datagrams
+  size_t m_cachedTail ;                     ///< last seen m_tail
+  std::atomic<bool> m_consumerBusy ;        ///< consumer is reading slots
+  std::atomic<int> m_consumerWaiting ;      ///< consumer sleeps on m_dataSeq
+
+  // written by producer
+  char m_pad1[CacheLine];
+  std::atomic<size_t> m_tail ;              ///< next slot to push
+  size_t m_cachedHead ;                     ///< last seen m_head
+  std::atomic<uint64_t> m_bytesIn ;         ///< bytes of all pushed datagrams
+  uint64_t m_cachedBytesOut ;               ///< last seen m_bytesOut
+  std::atomic<size_t> m_peakBytes ;
+  std::atomic<int> m_producerWaiting ;      ///< producer sleeps on m_spaceSeq
+  uint64_t m_lastDropped ;                  ///< fiducials of the last dropped event
+
+  // futex words and rarely used state
+  char m_pad2[CacheLine];
+  std::atomic<int> m_dataSeq ;              ///< changed when data or exception is added
+  std::atomic<int> m_spaceSeq ;             ///< changed when slots are freed
+  std::atomic<bool> m_clearing ;            ///< clear() owns the slots
+  std::atomic<bool> m_hasException ;
+  std::atomic<uint64_t> m_droppedEvents ;
+  std::atomic<uint64_t> m_droppedDgrams ;
   std::string m_exception;
-  boost::mutex m_mutex ;
-  boost::condition m_condFull ;
-  boost::condition m_condEmpty ;
+  boost::mutex m_exceptionMutex ;           ///< protects m_exception
 
 };
 
@@ -28,7 +28,10 @@
 #include "XtcInput/MergeMode.h"
 #include "XtcInput/XtcFilesPosition.h"
 #include "XtcInput/RunFileIterI.h"
+#include "XtcInput/ShardSpec.h"
 #include "XtcInput/LiveAvail.h"
+#include "XtcInput/MemoryGovernor.h"
+#include "XtcInput/NumaPlacement.h"
 
 //------------------------------------
 // Collaborating Class Declarations --
@@ -64,6 +67,25 @@ public:
 
   // full constructor with parameters for handling control streams and optionally
   // specifies file offsets before the second event (event after configure).
+  // If eventBuilding is true then datagrams are merged into complete events
+  // first and each event is moved to the queue at once. If prefetchChunks is
+  // non-zero then this many chunks of each stream are read in parallel.
+  // With a sharded ShardSpec only the L1Accepts of this rank (and all
+  // transitions) are read and moved to the queue. If cycleThreads > 1 then
+  // this many calib cycles of a non-live run are merged in parallel. If
+  // concurrentRuns > 1 then this many non-live runs are merged at the same
+  // time, they are still moved to the queue in run order.
+  // All buffers of the reader and the queue are counted in memory, which
+  // limits read-ahead when its budget is nearly used; by default the budget
+  // is half of the cgroup memory limit. A governor which is passed here is
+  // used by this reader only, it can be asked for usage while reading.
+  // NUMA policy other than None places the reader thread, TaskScheduler
+  // threads while they run tasks of this reader, and the datagrams they
+  // read near the thread which makes this object (the consumer), or
+  // interleaves them over all nodes.
+  // With segmentedDgrams datagrams above the contiguous limit (256MB) are
+  // moved to the queue as SegmentedDgram::wrap() pointers, consumers get
+  // them with SegmentedDgram::find(); by default reading them is an error.
   template <typename Iter>
     DgramReader(Iter begin, Iter end, DgramQueue& queue,
                 boost::shared_ptr<XtcInput::LiveAvail> &liveAvail,
@@ -71,7 +93,15 @@ public:
                 unsigned liveTimeout, unsigned runLiveTimeout, double l1OffsetSec,
                 int firstControlStream, unsigned maxStreamClockDiffSec,
                 boost::shared_ptr<XtcFilesPosition> thirdEvent =
-                                boost::shared_ptr<XtcFilesPosition>())
+                                boost::shared_ptr<XtcFilesPosition>(),
+                bool eventBuilding = false,
+                unsigned prefetchChunks = 0,
+                const ShardSpec& shard = ShardSpec(),
+                unsigned cycleThreads = 0,
+                unsigned concurrentRuns = 0,
+                const boost::shared_ptr<MemoryGovernor>& memory = boost::shared_ptr<MemoryGovernor>(),
+                NumaPlacement::Policy numa = NumaPlacement::None,
+                bool segmentedDgrams = false)
     : m_files(begin, end)
     , m_queue( queue )
     , m_mode( mode )
@@ -82,6 +112,14 @@ public:
     , m_firstControlStream(firstControlStream)
     , m_maxStreamClockDiffSec(maxStreamClockDiffSec)
     , m_thirdEvent(thirdEvent)
+    , m_eventBuilding(eventBuilding)
+    , m_prefetchChunks(prefetchChunks)
+    , m_shard(shard)
+    , m_cycleThreads(cycleThreads)
+    , m_concurrentRuns(concurrentRuns)
+    , m_memory(memory)
+    , m_numa(numa)
+    , m_segmentedDgrams(segmentedDgrams)
     , m_liveAvail(liveAvail)
   {}
 
@@ -99,6 +137,14 @@ public:
     , m_l1OffsetSec(l1OffsetSec)
     , m_firstControlStream(80)
     , m_maxStreamClockDiffSec(85)
+    , m_eventBuilding(false)
+    , m_prefetchChunks(0)
+    , m_shard()
+    , m_cycleThreads(0)
+    , m_concurrentRuns(0)
+    , m_memory()
+    , m_numa()
+    , m_segmentedDgrams(false)
   {}
 
   // Destructor
@@ -125,6 +171,14 @@ private:
   int m_firstControlStream;
   unsigned m_maxStreamClockDiffSec;
   boost::shared_ptr<XtcFilesPosition> m_thirdEvent;
+  bool m_eventBuilding;
+  unsigned m_prefetchChunks;
+  ShardSpec m_shard;
+  unsigned m_cycleThreads;
+  unsigned m_concurrentRuns;
+  boost::shared_ptr<MemoryGovernor> m_memory;
+  NumaPlacement m_numa;
+  bool m_segmentedDgrams;
   boost::shared_ptr<XtcInput::LiveAvail> &m_liveAvail;
 };
 
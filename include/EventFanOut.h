@@ -0,0 +1,142 @@
+#ifndef XTCINPUT_EVENTFANOUT_H
+#define XTCINPUT_EVENTFANOUT_H
+
+//--------------------------------------------------------------------------
+// File and Version Information:
+// 	$Id$
+//
+// Description:
+//	Class EventFanOut.
+//
+//------------------------------------------------------------------------
+
+//-----------------
+// C/C++ Headers --
+//-----------------
+#include <deque>
+#include <exception>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+#include <boost/function.hpp>
+#include <boost/thread/condition.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/utility.hpp>
+
+//----------------------
+// Base Class Headers --
+//----------------------
+
+//-------------------------------
+// Collaborating Class Headers --
+//-------------------------------
+#include "XtcInput/DgramList.h"
+#include "XtcInput/DgramQueue.h"
+
+//------------------------------------
+// Collaborating Class Declarations --
+//------------------------------------
+
+//		---------------------
+// 		-- Class Interface --
+//		---------------------
+
+namespace XtcInput {
+
+/// @addtogroup XtcInput
+
+/**
+ *  @ingroup XtcInput
+ *
+ *  @brief Hands events from DgramQueue to a pool of worker threads.
+ *
+ *  run() takes datagrams from the queue until the end of data, groups
+ *  consecutive datagrams of one event (same transition, and same fiducials
+ *  for L1Accept, as DgramReader with event building puts them) and gives
+ *  every event a sequence number. L1Accept events are processed by any
+ *  one worker, several at the same time. Transitions are barriers: all
+ *  earlier events are finished first, then every worker is called with
+ *  the transition (in its own thread), and later events only start after
+ *  all workers have returned. For transitions only one worker (e.g. worker
+ *  0) should give a result to OrderedSink.
+ *
+ *  An exception from a worker stops all workers and is re-thrown from run(),
+ *  so is the exception from DgramQueue::pop().
+ *
+ *  This software was developed for the LCLS project.  If you use all or
+ *  part of it, please give an appropriate acknowledgment.
+ *
+ *  @version $Id$
+ */
+
+class EventFanOut : boost::noncopyable {
+public:
+
+  /// Called in a worker thread with the event, its sequence number and worker number
+  typedef boost::function<void (const DgramList& event, uint64_t seq, unsigned worker)> Worker;
+
+  /**
+   *  @brief Make fan-out stage.
+   *
+   *  @param[in] queue      queue filled by DgramReader
+   *  @param[in] nWorkers   number of worker threads
+   *  @param[in] worker     function called for each event
+   *  @param[in] maxQueued  max number of events waiting for a worker, 0 means 2*nWorkers
+   */
+  EventFanOut(DgramQueue& queue, unsigned nWorkers, const Worker& worker, size_t maxQueued = 0);
+
+  // Destructor
+  ~EventFanOut();
+
+  /**
+   *  @brief Process all events, returns number of events.
+   *
+   *  Worker threads are started and joined here.
+   */
+  uint64_t run();
+
+protected:
+
+  // read one event from the queue, empty list at the end of data
+  DgramList nextEvent();
+
+  // next datagram from m_batch, refills it from the queue when it is used up
+  Dgram& nextDgram();
+
+  // give event to one worker, event is moved
+  void dispatch(DgramList&& event, uint64_t seq);
+
+  // wait until all workers are idle and call all of them with the transition, event is moved
+  void barrier(DgramList&& event, uint64_t seq);
+
+  // body of a worker thread
+  void work(unsigned worker);
+
+  // stop workers after an error, caller holds the lock
+  void fail(const std::exception_ptr& error);
+
+private:
+
+  DgramQueue& m_queue;
+  unsigned m_nWorkers;
+  Worker m_worker;
+  size_t m_maxQueued;
+  std::vector<Dgram> m_batch;         ///< datagrams taken from the queue with popBatch()
+  size_t m_batchPos;                  ///< next datagram in m_batch
+
+  std::deque<std::pair<uint64_t, DgramList> > m_events;  ///< events waiting for a worker
+  unsigned m_busy;                    ///< number of workers processing an L1Accept event
+  DgramList m_transition;             ///< transition for all workers
+  uint64_t m_transitionSeq;
+  uint64_t m_transitionCount;         ///< incremented for each transition
+  unsigned m_transitionLeft;          ///< workers which did not process transition yet
+  bool m_done;                        ///< no more events
+  std::exception_ptr m_error;         ///< first exception from a worker
+  boost::mutex m_mutex;
+  boost::condition m_condWork;        ///< signals workers
+  boost::condition m_condDispatch;    ///< signals dispatcher
+};
+
+} // namespace XtcInput
+
+#endif // XTCINPUT_EVENTFANOUT_H
@@ -0,0 +1,143 @@
+#ifndef XTCINPUT_EVENTJOINTABLE_H
+#define XTCINPUT_EVENTJOINTABLE_H
+
+//--------------------------------------------------------------------------
+// File and Version Information:
+// 	$Id$
+//
+// Description:
+//	Class EventJoinTable.
+//
+//------------------------------------------------------------------------
+
+//-----------------
+// C/C++ Headers --
+//-----------------
+#include <functional>
+#include <queue>
+#include <vector>
+#include <boost/unordered_map.hpp>
+
+//----------------------
+// Base Class Headers --
+//----------------------
+
+//-------------------------------
+// Collaborating Class Headers --
+//-------------------------------
+#include "XtcInput/DgramList.h"
+#include "XtcInput/StreamDgram.h"
+
+//------------------------------------
+// Collaborating Class Declarations --
+//------------------------------------
+
+//		---------------------
+// 		-- Class Interface --
+//		---------------------
+
+namespace XtcInput {
+
+/// @addtogroup XtcInput
+
+/**
+ *  @ingroup XtcInput
+ *
+ *  @brief Hash join of datagrams from several streams into events.
+ *
+ *  Every datagram is given an EventKey. For L1Accepts the key holds the
+ *  fiducials unwrapped into a 64-bit count, the seconds are used to find
+ *  the 17-bit wrap. This works as long as stream clocks are less than half
+ *  a fiducial cycle (182 seconds) apart. Transitions are keyed on their
+ *  L1Block and transition type. Datagrams with equal keys are collected in
+ *  a hash table.
+ *
+ *  Each stream delivers its datagrams in increasing key order, so the
+ *  smallest key among the last datagrams of all unfinished streams is a
+ *  watermark: pending events at or below it cannot get more datagrams and
+ *  are ready to be emitted. Reading next from the stream returned by
+ *  laggard() keeps the table small, the cost per event does not depend on
+ *  how far apart the stream clocks are.
+ *
+ *  This software was developed for the LCLS project.  If you use all or
+ *  part of it, please give an appropriate acknowledgment.
+ *
+ *  @version $Id$
+ */
+
+class EventJoinTable {
+public:
+
+  /// order of an event in the run
+  struct EventKey {
+    unsigned run;
+    int64_t block;
+    unsigned phase;   ///< 0 for transitions, 1 for L1Accepts
+    int64_t id;       ///< transition rank or unwrapped fiducials
+
+    bool operator<(const EventKey& o) const;
+    bool operator>(const EventKey& o) const { return o < *this; }
+    bool operator==(const EventKey& o) const;
+    bool operator!=(const EventKey& o) const { return not (*this == o); }
+  };
+
+  EventJoinTable();
+
+  /// add a stream, returns its slot number
+  unsigned addStream();
+
+  /// number of streams
+  unsigned streams() const { return m_lastKey.size(); }
+
+  /// add non-empty datagram read from the stream in given slot
+  void add(unsigned slot, const StreamDgram& dg);
+
+  /// mark stream in given slot as finished, it is not waited for any more
+  void streamDone(unsigned slot);
+
+  /// slot of unfinished stream with the smallest key, -1 if all streams are finished
+  int laggard() const;
+
+  /// true if the earliest pending event can be emitted
+  bool ready() const;
+
+  /// remove and return earliest pending event, empty list if there are none
+  DgramList pop();
+
+  /// make key for a non-empty datagram, unwrapping fiducials updates the reference
+  EventKey makeKey(const StreamDgram& dg);
+
+  /// unwrap fiducials into a count which is continuous across the 17-bit wrap
+  int64_t unwrapFiducials(uint32_t seconds, unsigned fiducials);
+
+protected:
+
+  // position of a transition in the L1Block
+  static int64_t transitionRank(unsigned service);
+
+  // smallest key among the unfinished streams
+  bool watermark(EventKey& key) const;
+
+private:
+
+  typedef boost::unordered_map<EventKey, DgramList> Table;
+  typedef std::priority_queue<EventKey, std::vector<EventKey>, std::greater<EventKey> > Order;
+
+  Table m_table;                     ///< pending events
+  Order m_order;                     ///< keys of pending events, earliest on top
+  std::vector<EventKey> m_lastKey;   ///< key of the last datagram from each stream
+  std::vector<bool> m_started;       ///< stream delivered at least one datagram
+  std::vector<bool> m_done;          ///< stream is finished
+  bool m_haveRef;                    ///< reference for unwrapping is set
+  uint32_t m_refSeconds;             ///< seconds of the last unwrapped L1Accept
+  int64_t m_refId;                   ///< unwrapped fiducials of the last L1Accept
+  bool m_haveEmitted;
+  EventKey m_lastEmitted;
+};
+
+/// hash function used by boost::unordered_map
+std::size_t hash_value(const EventJoinTable::EventKey& key);
+
+} // namespace XtcInput
+
+#endif // XTCINPUT_EVENTJOINTABLE_H
@@ -0,0 +1,157 @@
+#ifndef XTCINPUT_LOSERTREE_H
+#define XTCINPUT_LOSERTREE_H
+
+//--------------------------------------------------------------------------
+// File and Version Information:
+// 	$Id$
+//
+// Description:
+//	Class LoserTree.
+//
+//------------------------------------------------------------------------
+
+//-----------------
+// C/C++ Headers --
+//-----------------
+#include <vector>
+#include <algorithm>
+#include <utility>
+
+//----------------------
+// Base Class Headers --
+//----------------------
+
+//-------------------------------
+// Collaborating Class Headers --
+//-------------------------------
+
+//------------------------------------
+// Collaborating Class Declarations --
+//------------------------------------
+
+//		---------------------
+// 		-- Class Interface --
+//		---------------------
+
+namespace XtcInput {
+
+/// @addtogroup XtcInput
+
+/**
+ *  @ingroup XtcInput
+ *
+ *  @brief Tournament (loser) tree for k-way merging.
+ *
+ *  Holds exactly one element per input (slot). The interface follows
+ *  std::priority_queue with the same Greater comparison, so the element
+ *  returned by top() is the one for which no other element is less.
+ *  Instead of pop()/push() the caller replaces the top element with the
+ *  next element from the same input by calling replaceTop(). Only the path
+ *  from that slot to the root is replayed, this takes at most ceil(log2 k)
+ *  comparisons and elements are never moved between slots.
+ *
+ *  Elements are added with push() before the first call to top(), the tree
+ *  is built on first access. Ties are resolved in favor of the element that
+ *  is already the winner of the subtree, the order of equal elements is
+ *  unspecified as it is for std::priority_queue.
+ *
+ *  This software was developed for the LCLS project.  If you use all or
+ *  part of it, please give an appropriate acknowledgment.
+ *
+ *  @version $Id$
+ */
+
+template <class T, class Greater>
+class LoserTree {
+public:
+
+  typedef T value_type;
+
+  explicit LoserTree(const Greater& greater = Greater())
+    : m_greater(greater)
+    , m_slots()
+    , m_tree()
+    , m_built(false)
+  {}
+
+  /// number of slots
+  size_t size() const { return m_slots.size(); }
+
+  /// true if there are no slots
+  bool empty() const { return m_slots.empty(); }
+
+  /// add one more slot, must be called before the first call to top()
+  void push(const T& value) {
+    m_slots.push_back(value);
+    m_built = false;
+  }
+
+  /// slot number of the current winner
+  size_t topSlot() {
+    if (not m_built) build();
+    return m_tree[0];
+  }
+
+  /// smallest element
+  const T& top() { return m_slots[topSlot()]; }
+
+  /// replace smallest element with the next element from the same input
+  void replaceTop(const T& value) {
+    size_t winner = topSlot();
+    m_slots[winner] = value;
+    replay(winner);
+  }
+
+  /// same as replaceTop() but moves the smallest element out and value in
+  T exchangeTop(T&& value) {
+    size_t winner = topSlot();
+    T top(std::move(m_slots[winner]));
+    m_slots[winner] = std::move(value);
+    replay(winner);
+    return top;
+  }
+
+protected:
+
+  // new element in the slot of the winner, play its path to the root
+  void replay(size_t winner) {
+    const size_t k = m_slots.size();
+    for (size_t node = (winner + k) / 2; node > 0; node /= 2) {
+      if (beats(m_tree[node], winner)) std::swap(m_tree[node], winner);
+    }
+    m_tree[0] = winner;
+  }
+
+  // true if slot a wins against slot b, ties go to a
+  bool beats(size_t a, size_t b) const { return not m_greater(m_slots[a], m_slots[b]); }
+
+  // play the whole tournament, node n has children 2n and 2n+1, slot s is leaf k+s
+  void build() {
+    const size_t k = m_slots.size();
+    m_tree.assign(std::max(k, size_t(1)), 0);
+    if (k > 0) m_tree[0] = play(1);
+    m_built = true;
+  }
+
+  // returns winner of the subtree at node, stores losers
+  size_t play(size_t node) {
+    const size_t k = m_slots.size();
+    if (node >= k) return node - k;
+    size_t left = play(2*node);
+    size_t right = play(2*node+1);
+    if (beats(right, left)) std::swap(left, right);
+    m_tree[node] = right;
+    return left;
+  }
+
+private:
+
+  Greater m_greater;
+  std::vector<T> m_slots;       ///< current element of each input
+  std::vector<size_t> m_tree;   ///< m_tree[0] is the winner, other nodes hold losers
+  bool m_built;
+};
+
+} // namespace XtcInput
+
+#endif // XTCINPUT_LOSERTREE_H
@@ -0,0 +1,162 @@
+#ifndef XTCINPUT_MEMORYGOVERNOR_H
+#define XTCINPUT_MEMORYGOVERNOR_H
+
+//--------------------------------------------------------------------------
+// File and Version Information:
+// 	$Id$
+//
+// Description:
+//	Class MemoryGovernor.
+//
+//------------------------------------------------------------------------
+
+//-----------------
+// C/C++ Headers --
+//-----------------
+#include <atomic>
+#include <iosfwd>
+#include <vector>
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/utility.hpp>
+
+//----------------------
+// Base Class Headers --
+//----------------------
+
+//-------------------------------
+// Collaborating Class Headers --
+//-------------------------------
+
+//------------------------------------
+// Collaborating Class Declarations --
+//------------------------------------
+
+//		---------------------
+// 		-- Class Interface --
+//		---------------------
+
+namespace XtcInput {
+
+/// @addtogroup XtcInput
+
+/**
+ *  @ingroup XtcInput
+ *
+ *  @brief Memory budget shared by the buffers of one DgramReader.
+ *
+ *  Every stage which keeps datagrams in memory (ChunkPrefetcher, calib
+ *  cycle buffers of XtcStreamMerger, run buffers of XtcMergeIterator)
+ *  reserves their size here and releases it when the datagrams are passed
+ *  on; DgramQueue is added as a gauge. Reserving never fails, data which
+ *  is needed to make progress is always read. Speculative read-ahead stops
+ *  when the total is above 3/4 of the budget (speculativeAllowed()) and
+ *  buffer limits are scaled down by scaleLimit() once half of the budget
+ *  is used.
+ *
+ *  Budget of 0 means no limit, everything is still counted.
+ *
+ *  This software was developed for the LCLS project.  If you use all or
+ *  part of it, please give an appropriate acknowledgment.
+ *
+ *  @version $Id$
+ */
+
+class MemoryGovernor : boost::noncopyable {
+public:
+
+  /// Buffering stages, for reporting
+  enum Use {
+    Prefetch,     ///< ChunkPrefetcher
+    CycleBuffer,  ///< merged calib cycles of XtcStreamMerger
+    RunBuffer,    ///< merged runs of XtcMergeIterator
+    OutputQueue,  ///< DgramQueue
+    NumUses
+  };
+
+  typedef boost::function<size_t ()> Gauge;
+  typedef unsigned GaugeId;
+
+  /// Memory limit of the process cgroup (v2 or v1), 0 if there is no limit
+  static size_t cgroupMemoryLimit();
+
+  /// Budget used by DgramReader: half of the cgroup memory limit, 0 if there is no limit
+  static size_t defaultBudget();
+
+  /// Make governor with given budget in bytes, 0 for no limit
+  explicit MemoryGovernor(size_t budget);
+
+  /// Returns budget, 0 if there is no limit
+  size_t budget() const { return m_budget; }
+
+  /// Count bytes kept in memory by a stage
+  void reserve(Use use, size_t bytes);
+
+  /// Return bytes counted by reserve()
+  void release(Use use, size_t bytes);
+
+  /// true if speculative read-ahead may continue, total is below 3/4 of the budget
+  bool speculativeAllowed() const;
+
+  /**
+   *  @brief Returns buffer limit scaled by memory pressure.
+   *
+   *  Returns wanted limit while at most half of the budget is used, then
+   *  less and less down to wanted/8 when the whole budget is used.
+   */
+  size_t scaleLimit(size_t wanted) const;
+
+  /**
+   *  @brief Add memory which is counted by somebody else.
+   *
+   *  Gauge is called whenever the total is needed, it has to be cheap and
+   *  thread-safe. It must stay valid until removeGauge() with the returned
+   *  id, which waits for calls in progress.
+   */
+  GaugeId addGauge(Use use, const Gauge& gauge);
+
+  /// Remove gauge added by addGauge(), it is not called after this returns
+  void removeGauge(GaugeId id);
+
+  /// Total bytes now, including gauges
+  size_t used() const;
+
+  /// Bytes of one stage now
+  size_t used(Use use) const;
+
+  /// Largest total seen by reserve()
+  size_t peak() const { return m_peak.load(std::memory_order_relaxed); }
+
+  /// Print usage of all stages
+  void print(std::ostream& out) const;
+
+private:
+
+  // total of reserved bytes and gauges
+  size_t total(size_t reserved) const;
+
+  // update peak with total
+  void updatePeak(size_t total);
+
+  size_t m_budget;
+  std::atomic<size_t> m_reserved;                 ///< sum of m_used
+  std::atomic<size_t> m_used[NumUses];            ///< reserved by each stage
+  std::atomic<size_t> m_peak;
+  struct GaugeEntry {
+    GaugeId id;
+    Use use;
+    Gauge gauge;
+  };
+
+  mutable boost::mutex m_gaugeMutex;              ///< protects m_gauges, held during calls
+  std::vector<GaugeEntry> m_gauges;
+  GaugeId m_nextGaugeId;
+};
+
+/// Insertion operator for MemoryGovernor usage
+std::ostream&
+operator<<(std::ostream& out, const MemoryGovernor& memory);
+
+} // namespace XtcInput
+
+#endif // XTCINPUT_MEMORYGOVERNOR_H
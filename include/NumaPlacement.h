@@ -0,0 +1,165 @@
+#ifndef XTCINPUT_NUMAPLACEMENT_H
+#define XTCINPUT_NUMAPLACEMENT_H
+
+//--------------------------------------------------------------------------
+// File and Version Information:
+// 	$Id$
+//
+// Description:
+//	Class NumaPlacement.
+//
+//------------------------------------------------------------------------
+
+//-----------------
+// C/C++ Headers --
+//-----------------
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include <sched.h>
+#include <boost/utility.hpp>
+
+//----------------------
+// Base Class Headers --
+//----------------------
+
+//-------------------------------
+// Collaborating Class Headers --
+//-------------------------------
+
+//------------------------------------
+// Collaborating Class Declarations --
+//------------------------------------
+
+//		---------------------
+// 		-- Class Interface --
+//		---------------------
+
+namespace XtcInput {
+
+/// @addtogroup XtcInput
+
+/**
+ *  @ingroup XtcInput
+ *
+ *  @brief Where reading threads run and where datagram memory comes from.
+ *
+ *  Datagram buffers are allocated by the thread which reads them (reader
+ *  thread of DgramReader, or a TaskScheduler thread for prefetching), so
+ *  the memory policy of these threads decides on which NUMA node the
+ *  consumer finds its data. Policies:
+ *
+ *  - None: nothing is changed, the kernel default (local node of the
+ *    reading thread) is used.
+ *  - ConsumerNode: reading threads run on the CPUs of the consumer's node
+ *    and allocate memory there, so the consumer reads local memory.
+ *  - Interleave: memory pages are spread over all nodes, threads are not
+ *    pinned. Good when consumers run on all nodes (see EventFanOut).
+ *
+ *  Consumer's node is the node of the thread which makes the object,
+ *  unless it is given. Node layout comes from /sys/devices/system/node
+ *  when the object is made and memory policy is set with set_mempolicy(2),
+ *  on a machine with one node or without permission applyToThread() does
+ *  nothing. Threads shared with other code (TaskScheduler pool) use Scope
+ *  so that the placement only lasts while they work for the reader.
+ *
+ *  This software was developed for the LCLS project.  If you use all or
+ *  part of it, please give an appropriate acknowledgment.
+ *
+ *  @version $Id$
+ */
+
+class NumaPlacement {
+public:
+
+  /**
+   *  @brief Placement applied to the calling thread for the life of the object.
+   *
+   *  Saves CPU affinity and memory policy of the thread, applies the
+   *  placement and restores both in destructor. Zero or inactive placement
+   *  changes nothing.
+   */
+  class Scope : boost::noncopyable {
+  public:
+    explicit Scope(const NumaPlacement* placement);
+    ~Scope();
+  private:
+    bool m_restoreAffinity;
+    bool m_restorePolicy;
+    cpu_set_t m_affinity;
+    int m_mode;
+    unsigned long m_nodeMask[1024 / (8 * sizeof(unsigned long))];  ///< MaxNodes bits
+  };
+
+  enum Policy {
+    None,           ///< leave threads and memory alone
+    ConsumerNode,   ///< pin reading threads and their memory to the consumer's node
+    Interleave      ///< interleave memory over all nodes
+  };
+
+  /**
+   *  @brief Make policy from string: "none", "consumer" or "interleave".
+   *
+   *  @throw ArgumentException Thrown if string is not one of the names
+   */
+  static Policy policy(const std::string& str);
+
+  /// Parse kernel CPU or node list like "0-3,8-11", bad entries are skipped
+  static std::vector<unsigned> parseList(const std::string& str);
+
+  /// Number of online NUMA nodes, 1 if this is not known
+  static unsigned numNodes();
+
+  /// CPUs of a node, empty if there is no such node
+  static std::vector<unsigned> nodeCpus(unsigned node);
+
+  /// Node of the CPU which runs the calling thread, -1 if not known
+  static int currentNode();
+
+  /**
+   *  @brief Make placement.
+   *
+   *  @param[in] policy   what to do
+   *  @param[in] node     consumer's node, negative means node of the calling thread
+   */
+  explicit NumaPlacement(Policy policy = None, int node = -1);
+
+  /// Returns the policy
+  Policy policy() const { return m_policy; }
+
+  /// Returns consumer's node, -1 if not known
+  int node() const { return m_node; }
+
+  /// true if the policy changes anything on this machine
+  bool active() const { return m_active; }
+
+  /**
+   *  @brief Apply the policy to the calling thread.
+   *
+   *  Sets CPU affinity and memory policy of the thread, returns false if
+   *  that was not possible (the thread keeps running as before).
+   */
+  bool applyToThread() const;
+
+  /// Print policy and nodes
+  void print(std::ostream& out) const;
+
+private:
+
+  Policy m_policy;
+  int m_node;
+  bool m_active;                ///< policy is not None and there is more than one node
+  std::vector<unsigned> m_cpus; ///< CPUs of m_node for ConsumerNode
+};
+
+/// Insertion operator for policy values
+std::ostream&
+operator<<(std::ostream& out, NumaPlacement::Policy policy);
+
+/// Insertion operator for placement, same as print()
+std::ostream&
+operator<<(std::ostream& out, const NumaPlacement& placement);
+
+} // namespace XtcInput
+
+#endif // XTCINPUT_NUMAPLACEMENT_H
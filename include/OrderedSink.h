@@ -0,0 +1,131 @@
+#ifndef XTCINPUT_ORDEREDSINK_H
+#define XTCINPUT_ORDEREDSINK_H
+
+//--------------------------------------------------------------------------
+// File and Version Information:
+// 	$Id$
+//
+// Description:
+//	Class OrderedSink.
+//
+//------------------------------------------------------------------------
+
+//-----------------
+// C/C++ Headers --
+//-----------------
+#include <map>
+#include <stdint.h>
+#include <boost/function.hpp>
+#include <boost/optional.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/utility.hpp>
+
+//----------------------
+// Base Class Headers --
+//----------------------
+
+//-------------------------------
+// Collaborating Class Headers --
+//-------------------------------
+
+//------------------------------------
+// Collaborating Class Declarations --
+//------------------------------------
+
+//		---------------------
+// 		-- Class Interface --
+//		---------------------
+
+namespace XtcInput {
+
+/// @addtogroup XtcInput
+
+/**
+ *  @ingroup XtcInput
+ *
+ *  @brief Restores event order of results produced by several threads.
+ *
+ *  Threads give results in any order with put() together with the event
+ *  sequence number (as assigned by EventFanOut). Every sequence number
+ *  starting from firstSeq must be either put() or skip()-ed. Writer is
+ *  called in the order of sequence numbers, from the thread which filled
+ *  the gap, never from two threads at the same time and without holding
+ *  the lock so that other threads are not blocked while it writes.
+ *
+ *  This software was developed for the LCLS project.  If you use all or
+ *  part of it, please give an appropriate acknowledgment.
+ *
+ *  @version $Id$
+ */
+
+template <typename T>
+class OrderedSink : boost::noncopyable {
+public:
+
+  typedef boost::function<void (uint64_t seq, const T& value)> Writer;
+
+  explicit OrderedSink(const Writer& writer, uint64_t firstSeq = 0)
+    : m_writer(writer)
+    , m_pending()
+    , m_next(firstSeq)
+    , m_writing(false)
+    , m_mutex()
+  {}
+
+  /// result for event seq
+  void put(uint64_t seq, const T& value) { add(seq, boost::optional<T>(value)); }
+
+  /// event seq has no result
+  void skip(uint64_t seq) { add(seq, boost::optional<T>()); }
+
+  /// sequence number of the next result to write
+  uint64_t next() const {
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_next;
+  }
+
+  /// number of results waiting for earlier ones
+  size_t pending() const {
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_pending.size();
+  }
+
+protected:
+
+  // store result, write everything which is in order now unless other thread writes
+  void add(uint64_t seq, const boost::optional<T>& value) {
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_pending.insert(std::make_pair(seq, value));
+    if (m_writing) return;
+    m_writing = true;
+    while (not m_pending.empty() and m_pending.begin()->first == m_next) {
+      const boost::optional<T> next = m_pending.begin()->second;
+      m_pending.erase(m_pending.begin());
+      const uint64_t nextSeq = m_next ++;
+      if (next) {
+        lock.unlock();
+        try {
+          m_writer(nextSeq, *next);
+        } catch (...) {
+          lock.lock();
+          m_writing = false;
+          throw;
+        }
+        lock.lock();
+      }
+    }
+    m_writing = false;
+  }
+
+private:
+
+  Writer m_writer;
+  std::map<uint64_t, boost::optional<T> > m_pending;  ///< results out of order
+  uint64_t m_next;                                    ///< seq of next result to write
+  bool m_writing;                                     ///< some thread is in the writer
+  mutable boost::mutex m_mutex;
+};
+
+} // namespace XtcInput
+
+#endif // XTCINPUT_ORDEREDSINK_H
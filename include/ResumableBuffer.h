@@ -0,0 +1,287 @@
+#ifndef XTCINPUT_RESUMABLEBUFFER_H
+#define XTCINPUT_RESUMABLEBUFFER_H
+
+//--------------------------------------------------------------------------
+// File and Version Information:
+// 	$Id$
+//
+// Description:
+//	Class ResumableBuffer.
+//
+//------------------------------------------------------------------------
+
+//-----------------
+// C/C++ Headers --
+//-----------------
+#include <deque>
+#include <exception>
+#include <utility>
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/utility.hpp>
+
+//----------------------
+// Base Class Headers --
+//----------------------
+
+//-------------------------------
+// Collaborating Class Headers --
+//-------------------------------
+#include "XtcInput/MemoryGovernor.h"
+#include "XtcInput/TaskScheduler.h"
+
+//------------------------------------
+// Collaborating Class Declarations --
+//------------------------------------
+
+//		---------------------
+// 		-- Class Interface --
+//		---------------------
+
+namespace XtcInput {
+
+/// @addtogroup XtcInput
+
+/**
+ *  @ingroup XtcInput
+ *
+ *  @brief Items produced in the background and kept in memory until taken.
+ *
+ *  A TaskScheduler task calls the producer for one item after another and
+ *  keeps them in a queue. The task returns when the queue holds maxBytes
+ *  (less if MemoryGovernor is short of memory, see scaleLimit()) or when
+ *  speculative reading is not allowed, and next() submits it again after
+ *  half of it is free. The first item is always produced, the consumer
+ *  waits for it. next() runs the task in the calling thread if no pool
+ *  thread has started it yet.
+ *
+ *  Producer returns false after the last item, it is not called again
+ *  then. Exception thrown by the producer is re-thrown by next() after all
+ *  items produced before it. Bytes of queued items are reserved in
+ *  MemoryGovernor for the given use.
+ *
+ *  Optional notify function is called without the buffer lock after an
+ *  item is added and after the task returns, this is for a consumer which
+ *  waits for one of several buffers to become ready().
+ *
+ *  Destructor stops the task and waits for it if it is running, so a
+ *  buffer should be destroyed before anything its producer uses.
+ *
+ *  This software was developed for the LCLS project.  If you use all or
+ *  part of it, please give an appropriate acknowledgment.
+ *
+ *  @version $Id$
+ */
+
+template <class T>
+class ResumableBuffer : boost::noncopyable {
+public:
+
+  typedef T value_type;
+
+  /// Makes next item, false if there are no more items
+  typedef boost::function<bool (T&)> Producer;
+
+  /// Memory used by an item
+  typedef boost::function<size_t (const T&)> Sizer;
+
+  /// Called when the buffer state changes
+  typedef boost::function<void ()> Notify;
+
+  /**
+   *  @brief Make buffer, nothing is produced before start() or next().
+   *
+   *  @param[in] produce   makes one item, called by the task only
+   *  @param[in] size      memory used by an item
+   *  @param[in] maxBytes  task pauses when this many bytes are waiting for next()
+   *  @param[in] memory    memory budget, counts the queued items
+   *  @param[in] use       stage of the items for memory
+   *  @param[in] priority  priority of the task
+   *  @param[in] notify    called when an item is added or the task returns
+   */
+  ResumableBuffer(const Producer& produce, const Sizer& size, size_t maxBytes,
+                  const boost::shared_ptr<MemoryGovernor>& memory, MemoryGovernor::Use use,
+                  TaskScheduler::Priority priority, const Notify& notify = Notify())
+    : m_produce(produce)
+    , m_size(size)
+    , m_maxBytes(maxBytes)
+    , m_memory(memory)
+    , m_use(use)
+    , m_priority(priority)
+    , m_notify(notify)
+    , m_queue()
+    , m_bytes(0)
+    , m_done(false)
+    , m_stop(false)
+    , m_running(false)
+    , m_error()
+    , m_task()
+    , m_mutex()
+    , m_condEmpty()
+  {}
+
+  // Destructor stops the task
+  ~ResumableBuffer()
+  {
+    boost::shared_ptr<TaskScheduler::Task> task;
+    {
+      boost::mutex::scoped_lock lock(m_mutex);
+      m_stop = true;
+      task = m_task;
+    }
+    if (task) task->cancel();
+    m_memory->release(m_use, m_bytes);
+  }
+
+  /// Start producing in the background
+  void start()
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    resume();
+  }
+
+  /**
+   *  @brief Take next item, false after the last one.
+   *
+   *  Waits until the task has produced the item. Re-throws the exception
+   *  of the producer when all items before it are taken.
+   */
+  bool next(T& item)
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    while (m_queue.empty() and not m_done) {
+      resume();
+      // produce here if no pool thread has started it yet
+      boost::shared_ptr<TaskScheduler::Task> task = m_task;
+      lock.unlock();
+      bool ranHere = task->tryRun();
+      lock.lock();
+      if (not ranHere and m_queue.empty() and not m_done) m_condEmpty.wait(lock);
+    }
+
+    if (m_queue.empty()) {
+      if (m_error) std::rethrow_exception(m_error);
+      return false;
+    }
+
+    item = std::move(m_queue.front());
+    m_queue.pop_front();
+    const size_t size = m_size(item);
+    m_bytes -= size;
+    m_memory->release(m_use, size);
+    if (m_bytes <= m_memory->scaleLimit(m_maxBytes) / 2 and m_memory->speculativeAllowed()) resume();
+    return true;
+  }
+
+  /// Run the task here if no pool thread has started it, true if it was run here
+  bool tryRun()
+  {
+    boost::shared_ptr<TaskScheduler::Task> task;
+    {
+      boost::mutex::scoped_lock lock(m_mutex);
+      resume();
+      task = m_task;
+    }
+    return task and task->tryRun();
+  }
+
+  /// true if producing has finished or paused with items in the queue
+  bool ready() const
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_done or (not m_running and not m_queue.empty());
+  }
+
+  /// Number of items in the queue
+  size_t size() const
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    return m_queue.size();
+  }
+
+protected:
+
+  // submit the task unless it is running, caller holds the lock
+  void resume()
+  {
+    if (m_running or m_done or m_stop) return;
+    m_running = true;
+    m_task = TaskScheduler::instance().submit(boost::bind(&ResumableBuffer::run, this), m_priority);
+  }
+
+  // true if the task should pause, caller holds the lock
+  bool full() const
+  {
+    if (m_queue.empty()) return false;
+    return m_bytes >= m_memory->scaleLimit(m_maxBytes) or not m_memory->speculativeAllowed();
+  }
+
+  // body of the task, returns when the queue is full
+  void run()
+  {
+    try {
+      while (true) {
+        {
+          boost::mutex::scoped_lock lock(m_mutex);
+          if (m_stop or full()) {
+            m_running = false;
+            break;
+          }
+        }
+
+        T item;
+        if (not m_produce(item)) {
+          boost::mutex::scoped_lock lock(m_mutex);
+          m_done = true;
+          m_running = false;
+          m_condEmpty.notify_one();
+          break;
+        }
+
+        const size_t size = m_size(item);
+        {
+          boost::mutex::scoped_lock lock(m_mutex);
+          m_queue.push_back(std::move(item));
+          m_bytes += size;
+          m_memory->reserve(m_use, size);
+          m_condEmpty.notify_one();
+        }
+        if (m_notify) m_notify();
+      }
+    } catch (...) {
+      // pass error to the consumer, it is reported after all good items
+      boost::mutex::scoped_lock lock(m_mutex);
+      m_error = std::current_exception();
+      m_done = true;
+      m_running = false;
+      m_condEmpty.notify_one();
+    }
+    if (m_notify) m_notify();
+  }
+
+private:
+
+  Producer m_produce;
+  Sizer m_size;
+  size_t m_maxBytes;
+  boost::shared_ptr<MemoryGovernor> m_memory;
+  MemoryGovernor::Use m_use;
+  TaskScheduler::Priority m_priority;
+  Notify m_notify;
+  std::deque<T> m_queue;            ///< items produced so far
+  size_t m_bytes;                   ///< size of items in m_queue
+  bool m_done;                      ///< producing has finished
+  bool m_stop;                      ///< producing should finish
+  bool m_running;                   ///< task is submitted
+  std::exception_ptr m_error;       ///< exception from producer
+  boost::shared_ptr<TaskScheduler::Task> m_task;  ///< last submitted task
+  mutable boost::mutex m_mutex;
+  boost::condition m_condEmpty;
+};
+
+} // namespace XtcInput
+
+#endif // XTCINPUT_RESUMABLEBUFFER_H
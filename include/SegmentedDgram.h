@@ -0,0 +1,121 @@
+#ifndef XTCINPUT_SEGMENTEDDGRAM_H
+#define XTCINPUT_SEGMENTEDDGRAM_H
+
+//--------------------------------------------------------------------------
+// File and Version Information:
+// 	$Id$
+//
+// Description:
+//	Class SegmentedDgram.
+//
+//------------------------------------------------------------------------
+
+//-----------------
+// C/C++ Headers --
+//-----------------
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/utility.hpp>
+
+//----------------------
+// Base Class Headers --
+//----------------------
+
+//-------------------------------
+// Collaborating Class Headers --
+//-------------------------------
+#include "pdsdata/xtc/Dgram.hh"
+#include "XtcInput/Dgram.h"
+
+//------------------------------------
+// Collaborating Class Declarations --
+//------------------------------------
+
+//		---------------------
+// 		-- Class Interface --
+//		---------------------
+
+namespace XtcInput {
+
+/// @addtogroup XtcInput
+
+/**
+ *  @ingroup XtcInput
+ *
+ *  @brief Datagram whose child XTCs are in separate buffers.
+ *
+ *  Datagram header and top-level XTC are kept as read from the file,
+ *  every child of the top-level XTC (with its payload) is in its own
+ *  buffer. There is no single allocation of the size of the datagram,
+ *  so datagrams larger than the contiguous limit can be read too (see
+ *  DgHeader::segmentedDgram()).
+ *
+ *  Reader asked for segments (DgHeader::dgram(true)) passes such datagrams
+ *  as a Dgram::ptr made by wrap(): header and top-level XTC without payload
+ *  (extent is sizeof(Pds::Xtc)), the pointer keeps this object alive and
+ *  find() returns it. Consumers which ask for segments use find() or
+ *  contiguous(); other readers never return segmented datagrams.
+ *
+ *  This software was developed for the LCLS project.  If you use all or
+ *  part of it, please give an appropriate acknowledgment.
+ *
+ *  @version $Id$
+ */
+
+class SegmentedDgram : boost::noncopyable {
+public:
+
+  typedef boost::shared_ptr<const Pds::Xtc> XtcPtr;
+  typedef std::vector<XtcPtr>::const_iterator const_iterator;
+
+  /// Segments of a datagram made by wrap(), zero pointer for other datagrams
+  static boost::shared_ptr<const SegmentedDgram> find(const Dgram::ptr& dg);
+
+  /**
+   *  @brief Make datagram pointer without payload which owns segments.
+   *
+   *  Header and top-level XTC are copied, extent of the XTC in the copy
+   *  covers no payload.
+   */
+  static Dgram::ptr wrap(const boost::shared_ptr<const SegmentedDgram>& dg);
+
+  /// Make datagram with the header as read from a file and no children yet
+  explicit SegmentedDgram(const Pds::Dgram& header);
+
+  /// Add next child XTC, buffer holds its header and payload
+  void push_back(const XtcPtr& child);
+
+  /// Header and top-level XTC, extent covers all children
+  const Pds::Dgram& header() const { return m_header; }
+
+  /// Number of child XTCs
+  size_t size() const { return m_children.size(); }
+
+  /// Child XTC i
+  const Pds::Xtc& child(size_t i) const { return *m_children[i]; }
+
+  /// Iterators over child XTC pointers, in file order
+  const_iterator begin() const { return m_children.begin(); }
+  const_iterator end() const { return m_children.end(); }
+
+  /// Size of header and all children, same as the contiguous datagram
+  size_t bytes() const { return sizeof m_header + m_payloadSize; }
+
+  /// true if all children cover the payload of the top-level XTC
+  bool complete() const {
+    return m_header.xtc.extent >= sizeof(Pds::Xtc) and m_payloadSize == m_header.xtc.extent - sizeof(Pds::Xtc);
+  }
+
+  /// Copy into one contiguous datagram (of bytes() size)
+  Dgram::ptr contiguous() const;
+
+private:
+
+  Pds::Dgram m_header;              ///< header as read from a file
+  std::vector<XtcPtr> m_children;   ///< one buffer per child XTC
+  size_t m_payloadSize;             ///< total extent of children
+};
+
+} // namespace XtcInput
+
+#endif // XTCINPUT_SEGMENTEDDGRAM_H
@@ -0,0 +1,110 @@
+#ifndef XTCINPUT_SHARDSPEC_H
+#define XTCINPUT_SHARDSPEC_H
+
+//--------------------------------------------------------------------------
+// File and Version Information:
+// 	$Id$
+//
+// Description:
+//	Class ShardSpec.
+//
+//------------------------------------------------------------------------
+
+//-----------------
+// C/C++ Headers --
+//-----------------
+#include <iosfwd>
+#include <stdint.h>
+
+//----------------------
+// Base Class Headers --
+//----------------------
+
+//-------------------------------
+// Collaborating Class Headers --
+//-------------------------------
+
+//------------------------------------
+// Collaborating Class Declarations --
+//------------------------------------
+
+//		---------------------
+// 		-- Class Interface --
+//		---------------------
+
+namespace XtcInput {
+
+/// @addtogroup XtcInput
+
+/**
+ *  @ingroup XtcInput
+ *
+ *  @brief Share of L1Accepts of a run read by one of several processes.
+ *
+ *  Processes which read the same run with the same size and mode but a
+ *  different rank get disjoint sets of L1Accepts, together all of them.
+ *  Transitions are delivered to every rank. Ownership only depends on the
+ *  datagram itself, so it is the same for all streams and all ranks:
+ *
+ *  - ByCalibCycle: L1Block (calib cycle number in the run) modulo size,
+ *  - ByFiducialBlock: fiducials divided by blockSize modulo size, a block
+ *    has blockSize consecutive 360 Hz fiducials (blockSize/3 events at 120 Hz).
+ *
+ *  Default-constructed instance is a single rank which owns everything.
+ *
+ *  This software was developed for the LCLS project.  If you use all or
+ *  part of it, please give an appropriate acknowledgment.
+ *
+ *  @version $Id$
+ */
+
+class ShardSpec {
+public:
+
+  enum Mode { ByCalibCycle, ByFiducialBlock };
+
+  /// Single rank, owns all L1Accepts
+  ShardSpec() : m_rank(0), m_size(1), m_mode(ByCalibCycle), m_blockSize(1) {}
+
+  /**
+   *  @brief Make shard for one rank.
+   *
+   *  @param[in] rank       rank of this process, 0 to size-1
+   *  @param[in] size       number of processes
+   *  @param[in] mode       how L1Accepts are assigned to ranks
+   *  @param[in] blockSize  number of fiducials in a block for ByFiducialBlock
+   *
+   *  @throw ArgumentException Thrown if rank is not below size or blockSize is 0
+   */
+  ShardSpec(unsigned rank, unsigned size, Mode mode = ByCalibCycle, unsigned blockSize = 360);
+
+  /// true if there is more than one rank
+  bool sharded() const { return m_size > 1; }
+
+  /// true if this rank gets L1Accept with given L1Block and fiducials
+  bool owns(uint64_t block, unsigned fiducials) const {
+    if (m_size == 1) return true;
+    const uint64_t n = m_mode == ByCalibCycle ? block : fiducials / m_blockSize;
+    return n % m_size == m_rank;
+  }
+
+  unsigned rank() const { return m_rank; }
+  unsigned size() const { return m_size; }
+  Mode mode() const { return m_mode; }
+  unsigned blockSize() const { return m_blockSize; }
+
+private:
+
+  unsigned m_rank;
+  unsigned m_size;
+  Mode m_mode;
+  unsigned m_blockSize;
+};
+
+/// Insertion operator, prints rank/size and mode
+std::ostream&
+operator<<(std::ostream& out, const ShardSpec& shard);
+
+} // namespace XtcInput
+
+#endif // XTCINPUT_SHARDSPEC_H
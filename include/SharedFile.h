@@ -29,6 +29,7 @@
 // Collaborating Class Headers --
 //-------------------------------
 #include "XtcInput/XtcFileName.h"
+#include "XtcInput/XtcFileTable.h"
 
 //------------------------------------
 // Collaborating Class Declarations --
@@ -83,6 +84,9 @@ public:
   /// Return file name
   const XtcFileName& path() const { return m_impl->path; }
 
+  /// Return id of the file name in XtcFileTable
+  XtcFileTable::FileId fileId() const { return m_impl->fileId; }
+
   /// Return file descriptor
   int fd() const { return m_impl ? m_impl->fd : -1; }
 
@@ -102,18 +106,44 @@ public:
   ///  Reposition offset of the file, returns new offset.
   off_t seek(off_t offset, int whence) { return ::lseek(m_impl->fd, offset, whence); }
 
+  ///  Tell kernel how the file will be accessed, see posix_fadvise(2).
+  int advise(off_t offset, off_t len, int advice) const { return ::posix_fadvise(m_impl->fd, offset, len, advice); }
+
+  /**
+   *  Returns true if size bytes starting at offset are already in the file
+   *  or the writer has closed the file, so that read() will not wait.
+   *  Always true for files which are not live.
+   */
+  bool ready(off_t offset, size_t size);
+
+  /**
+   *  Read size bytes at given offset without moving file offset. Does not
+   *  wait for live data, returns 0 if the bytes are not in the file yet.
+   */
+  ssize_t peek(char* buf, size_t size, off_t offset);
+
+  /**
+   *  Returns size of the file if it does not grow any more (file is not
+   *  live or the writer has closed it), negative number otherwise.
+   */
+  off_t finalSize();
+
 
 protected:
 
   // check that we reached EOF while reading live data
   bool eof();
 
+  // check that live file has been renamed to its final name
+  bool writerDone(struct stat& statFinal);
+
 private:
 
   struct SharedFileImpl {
     SharedFileImpl(const XtcFileName& argPath, unsigned argLiveTimeout);
     ~SharedFileImpl();
     XtcFileName path;
+    XtcFileTable::FileId fileId;
     unsigned liveTimeout;
     int fd;
     off_t lastFileLength;
@@ -0,0 +1,158 @@
+#ifndef XTCINPUT_SMALLVECTOR_H
+#define XTCINPUT_SMALLVECTOR_H
+
+//--------------------------------------------------------------------------
+// File and Version Information:
+// 	$Id$
+//
+// Description:
+//	Class SmallVector.
+//
+//------------------------------------------------------------------------
+
+//-----------------
+// C/C++ Headers --
+//-----------------
+#include <algorithm>
+#include <vector>
+#include <utility>
+
+//----------------------
+// Base Class Headers --
+//----------------------
+
+//-------------------------------
+// Collaborating Class Headers --
+//-------------------------------
+
+//------------------------------------
+// Collaborating Class Declarations --
+//------------------------------------
+
+//		---------------------
+// 		-- Class Interface --
+//		---------------------
+
+namespace XtcInput {
+
+/// @addtogroup XtcInput
+
+/**
+ *  @ingroup XtcInput
+ *
+ *  @brief Vector which keeps up to N elements inside the object.
+ *
+ *  Used for per-event data where most events have a few elements, like
+ *  datagrams of one event in DgramList. Up to N elements no memory is
+ *  allocated, with more elements all of them are moved to a std::vector.
+ *  T must be default constructible, the inline elements are constructed
+ *  with the object; this is cheap for the pointers and integers it is
+ *  used for. Only appending is supported.
+ *
+ *  This software was developed for the LCLS project.  If you use all or
+ *  part of it, please give an appropriate acknowledgment.
+ *
+ *  @version $Id$
+ */
+
+template <class T, unsigned N>
+class SmallVector {
+public:
+
+  typedef T value_type;
+  typedef const T* const_iterator;
+  typedef T* iterator;
+
+  SmallVector() : m_size(0) {}
+
+  SmallVector(const SmallVector& other) = default;
+  SmallVector& operator=(const SmallVector& other) = default;
+
+  /// moves elements, other is left empty
+  SmallVector(SmallVector&& other) : m_size(0) { take(other); }
+
+  /// same as above, own elements are released
+  SmallVector& operator=(SmallVector&& other) {
+    if (this != &other) take(other);
+    return *this;
+  }
+
+  /// number of elements
+  size_t size() const { return m_size; }
+
+  /// true if there are no elements
+  bool empty() const { return m_size == 0; }
+
+  /// true if elements are kept inside the object
+  bool isInline() const { return m_heap.empty(); }
+
+  /// pointer to the first element
+  const T* data() const { return isInline() ? m_inline : &m_heap[0]; }
+  T* data() { return isInline() ? m_inline : &m_heap[0]; }
+
+  const_iterator begin() const { return data(); }
+  const_iterator end() const { return data() + m_size; }
+  iterator begin() { return data(); }
+  iterator end() { return data() + m_size; }
+
+  const T& operator[](size_t i) const { return data()[i]; }
+  T& operator[](size_t i) { return data()[i]; }
+
+  const T& front() const { return data()[0]; }
+
+  /// copy of the elements in a std::vector
+  std::vector<T> toVector() const { return std::vector<T>(begin(), end()); }
+
+  /// make room for n elements, only allocates when n is above N
+  void reserve(size_t n) {
+    if (n <= N or n <= m_heap.capacity()) return;
+    m_heap.reserve(n);
+    if (isInline()) spill();
+  }
+
+  /// add one element at the end
+  void push_back(const T& value) { push_back(T(value)); }
+
+  /// same as above, moves value in
+  void push_back(T&& value) {
+    if (isInline() and m_size < N) {
+      m_inline[m_size] = std::move(value);
+    } else {
+      if (isInline()) spill();
+      m_heap.push_back(std::move(value));
+    }
+    ++ m_size;
+  }
+
+private:
+
+  // take elements of other, leave it empty; generated move would keep
+  // m_size of the source with its elements gone
+  void take(SmallVector& other) {
+    m_heap = std::move(other.m_heap);
+    other.m_heap.clear();
+    for (size_t i = 0; i != N; ++ i) {
+      m_inline[i] = std::move(other.m_inline[i]);
+      other.m_inline[i] = T();
+    }
+    m_size = other.m_size;
+    other.m_size = 0;
+  }
+
+  // move inline elements to the heap vector
+  void spill() {
+    m_heap.reserve(std::max(size_t(2*N), m_heap.capacity()));
+    for (size_t i = 0; i != m_size; ++ i) {
+      m_heap.push_back(std::move(m_inline[i]));
+      m_inline[i] = T();
+    }
+  }
+
+  T m_inline[N];          ///< elements while there are at most N of them
+  std::vector<T> m_heap;  ///< all elements once there are more than N
+  size_t m_size;
+};
+
+} // namespace XtcInput
+
+#endif // XTCINPUT_SMALLVECTOR_H
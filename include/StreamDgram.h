@@ -13,7 +13,8 @@
 //-----------------
 // C/C++ Headers --
 //-----------------
-#include <map>
+#include <stdint.h>
+#include <utility>
 #include "boost/shared_ptr.hpp"
 //----------------------
 // Base Class Headers --
@@ -84,6 +85,12 @@ namespace XtcInput {
  *  For instance, it could be the stream number so as to identify Dgrams that move 
  *  in and out of a priority queue.
  *
+ *  Everything StreamDgramGreater needs for sorting is copied into a MergeKey
+ *  when the StreamDgram is constructed. Comparisons then only work with integers
+ *  and never go back to the datagram or to the file name. This means that the
+ *  datagram header must not be modified (see XtcStreamMerger::updateDgramTime)
+ *  after the StreamDgram has been made.
+ *
  *  @version $Id$
  *
  *  @see StreamDgramGreater 
@@ -92,14 +99,40 @@ class StreamDgram : public Dgram {
  public:
   typedef enum {DAQ, controlUnderDAQ, controlIndependent} StreamType;  
 
- StreamDgram(const Dgram &dgram, StreamType streamType, int64_t L1block, int streamId) 
-   : Dgram(dgram), m_streamType(streamType), m_L1block(L1block), m_streamId(streamId)
-  {}
+  enum { NumStreamTypes = 3 };
+
+  /**
+   *  @brief sort information extracted from the datagram and file name.
+   *
+   *  category is (isL1Accept ? 0 : NumStreamTypes) + streamType, it indexes
+   *  the comparison table in StreamDgramGreater. clock holds the seconds in the
+   *  upper 32 bits and the nanoseconds in the lower 32 bits so that clock times
+   *  compare as a single integer.
+   */
+  struct MergeKey {
+    unsigned run;
+    int64_t block;
+    unsigned category;
+    unsigned service;
+    uint64_t clock;
+    uint32_t seconds;
+    unsigned fiducials;
+  };
+
+  /// takes dgram by value, pass an rvalue to move the datagram in
+ StreamDgram(Dgram dgram, StreamType streamType, int64_t L1block, int streamId) 
+   : Dgram(std::move(dgram)), m_streamType(streamType), m_L1block(L1block), m_streamId(streamId)
+  {
+    m_key = makeMergeKey(*this, streamType, L1block);
+  }
 
   /**
    *  Default ctor
    */
- StreamDgram() : Dgram(), m_streamType(DAQ), m_L1block(-1) {}
+ StreamDgram() : Dgram(), m_streamType(DAQ), m_L1block(-1), m_streamId(0)
+  {
+    m_key = makeMergeKey(*this, m_streamType, m_L1block);
+  }
 
   /// returns L1Block, or -1 if Dgram is empty.
   int64_t L1Block() const { 
@@ -113,6 +146,14 @@ class StreamDgram : public Dgram {
   /// returns streamId
   int streamId() const { return m_streamId; }
 
+  /// returns the key used for sorting, undefined content if Dgram is empty
+  const MergeKey & mergeKey() const { return m_key; }
+
+  /// returns true if the datagram is an L1Accept
+  bool isL1Accept() const { return m_key.category < unsigned(NumStreamTypes); }
+
+  static MergeKey makeMergeKey(const Dgram &dgram, StreamType streamType, int64_t L1block);
+
   static std::string streamType2str(const StreamType type); // get string rep
   static std::string dumpStr(const StreamDgram &dg);  // dump object to string, for debugging
 
@@ -121,6 +162,7 @@ class StreamDgram : public Dgram {
   StreamType m_streamType;
   int64_t m_L1block;
   int m_streamId;
+  MergeKey m_key;
 };
 
 /**
@@ -142,33 +184,33 @@ class StreamDgramGreater {
   /// operator greater than for two StreamDgram's
   bool operator()(const StreamDgram &a, const StreamDgram &b) const;
 
-  /// determine if two StreamDgram's are part of the same event
+  /**
+   *  @brief determine if two StreamDgram's are part of the same event
+   *
+   *  Both must be in the same run and L1Block. Two L1Accepts are the same event
+   *  if their fiducials match (see FiducialsCompare::fiducialsEqual), two other
+   *  transitions if they are the same transition. An L1Accept and a transition
+   *  are never the same event. Throws if a controlIndependent stream is involved.
+   */
   bool sameEvent(const StreamDgram &a, const StreamDgram &b) const;
 
  protected:
 
-  // types for determining the category of a StreamDgram, and a pair of StreamDgram's
-  typedef enum {L1Accept, otherTrans} TransitionType;
-
-  typedef std::pair<TransitionType, StreamDgram::StreamType> DgramCategory;
-
-  typedef std::pair<DgramCategory, DgramCategory> DgramCategoryAB;
-
-  static DgramCategory getDgramCategory(const StreamDgram &dg);
-
-  static DgramCategoryAB makeDgramCategoryAB(DgramCategory a, DgramCategory b);
-
-
   /// the different kinds of comparisons
   typedef enum {clockGreater, fidGreater, blockGreater, badGreater} CompareMethod;  
 
+  enum { NumCategories = 2*StreamDgram::NumStreamTypes };
+
+  /// compare method for each pair of MergeKey categories, symmetric
+  static const CompareMethod s_compareTable[NumCategories][NumCategories];
+
   /**
    * @brief returns true if a > b based on the clock
    *
    * First the run and L1Block are used. For dgrams in the same run and L1Block,
    * the clock is used.
    */
-  bool doClockGreater(const StreamDgram &a, const StreamDgram &b) const;
+  bool doClockGreater(const StreamDgram::MergeKey &a, const StreamDgram::MergeKey &b) const;
 
   /**
    * @brief returns true if a > b based on the sec/fiducials.
@@ -178,7 +220,7 @@ class StreamDgramGreater {
    *
    * @see FiducialsCompare
    */
-  bool doFidGreater(const StreamDgram &a, const StreamDgram &b) const;
+  bool doFidGreater(const StreamDgram::MergeKey &a, const StreamDgram::MergeKey &b) const;
 
   /**
    * @brief returns true if a > b based on the block number and dgram transition.
@@ -186,37 +228,16 @@ class StreamDgramGreater {
    * The two datagrams must have mixed transitions, that is one must be an L1Accept,
    * and the other not an L1Accept. Otherwise an exception is thrown.
    */
-  bool doBlockGreater(const StreamDgram &a, const StreamDgram &b) const;
+  bool doBlockGreater(const StreamDgram::MergeKey &a, const StreamDgram::MergeKey &b) const;
 
   /**
    * @brief place holder for a not implemented compare.
    *
    * Throws an exception if called.
    */
-  bool doBadGreater(const StreamDgram &a, const StreamDgram &b) const;
-
-  /**
-   *  @brief returns -1, 0, 1 based on comparing run numbers.
-   *
-   *  a < b: returns -1
-   *  a==b : returns  0   
-   *  a > b: returns  1
-   * 
-   *  where the run number is obtained from the dgram filename
-   */
-  int runLessGreater(const StreamDgram &a, const StreamDgram &b) const;
-
-  /**
-   *  @brief helper function that returns -1, 0, 1 based on comparing L1Block
-   *
-   *  a < b: returns -1
-   *  a ==b : returns  0   
-   *  a > b: returns  1
-   */
-  int blockLessGreater(const StreamDgram &a, const StreamDgram &b) const;
+  bool doBadGreater(const StreamDgram::MergeKey &a, const StreamDgram::MergeKey &b) const;
 
  private:
-  std::map<DgramCategoryAB, CompareMethod> m_LUT;
   FiducialsCompare m_fidCompare;
 
  public:
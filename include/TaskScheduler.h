@@ -0,0 +1,204 @@
+#ifndef XTCINPUT_TASKSCHEDULER_H
+#define XTCINPUT_TASKSCHEDULER_H
+
+//--------------------------------------------------------------------------
+// File and Version Information:
+// 	$Id$
+//
+// Description:
+//	Class TaskScheduler.
+//
+//------------------------------------------------------------------------
+
+//-----------------
+// C/C++ Headers --
+//-----------------
+#include <deque>
+#include <exception>
+#include <vector>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/utility.hpp>
+
+//----------------------
+// Base Class Headers --
+//----------------------
+
+//-------------------------------
+// Collaborating Class Headers --
+//-------------------------------
+#include "XtcInput/NumaPlacement.h"
+
+//----------------------
+// Base Class Headers --
+//----------------------
+
+//-------------------------------
+// Collaborating Class Headers --
+//-------------------------------
+
+//------------------------------------
+// Collaborating Class Declarations --
+//------------------------------------
+
+//		---------------------
+// 		-- Class Interface --
+//		---------------------
+
+namespace XtcInput {
+
+/// @addtogroup XtcInput
+
+/**
+ *  @ingroup XtcInput
+ *
+ *  @brief Work-stealing thread pool for background work of XtcInput.
+ *
+ *  Each pool thread has its own queue per priority, tasks submitted from a
+ *  pool thread go to its own queue, others are spread round-robin. An idle
+ *  thread takes the oldest task from its own queue or steals the newest one
+ *  from another thread, always looking at all queues of a higher priority
+ *  before a lower one, so Live tasks come before speculative Prefetch.
+ *
+ *  Tasks must not block waiting for other tasks or for the consumer,
+ *  long-running work (like reading ahead) returns when its buffer is full
+ *  and is submitted again by the consumer. A thread which needs the result
+ *  of a task which has not started yet runs it itself (Task::tryRun() and
+ *  Task::wait()), so waiting never depends on a free pool thread.
+ *
+ *  instance() is shared by all XtcInput classes, its size is the CPU quota
+ *  of the process cgroup (or CPU affinity if there is no quota).
+ *
+ *  A task runs with the NUMA placement of the thread which submitted it
+ *  (see PlacementScope), pool threads return to their own placement after
+ *  the task, so one reader does not move threads used by others.
+ *
+ *  This software was developed for the LCLS project.  If you use all or
+ *  part of it, please give an appropriate acknowledgment.
+ *
+ *  @version $Id$
+ */
+
+class TaskScheduler : boost::noncopyable {
+public:
+
+  /// Task priorities, lower value runs first
+  enum Priority {
+    Live,         ///< data needed now or live data
+    Normal,       ///< data needed soon (next run, next calib cycles)
+    Prefetch,     ///< speculative read-ahead
+    NumPriorities
+  };
+
+  typedef boost::function<void ()> Function;
+
+  /// Submitted function, used to wait for it
+  class Task : boost::noncopyable {
+  public:
+
+    /// Task runs with placement of the calling thread
+    Task(const Function& fun, Priority priority);
+
+    /// Run in this thread if nobody has started it, true if it was run here
+    bool tryRun();
+
+    /// Wait until finished (runs it here if not started), re-throws its exception
+    void wait();
+
+    /// Make sure it never runs, or wait for the end if it has started; true if it never ran
+    bool cancel();
+
+    /// true after the end of function or cancel()
+    bool done() const;
+
+    Priority priority() const { return m_priority; }
+
+  private:
+
+    friend class TaskScheduler;
+
+    enum State { Pending, Running, Finished, Cancelled };
+
+    // change state from Pending to Running, false if it is not pending
+    bool claim();
+
+    // call function after successful claim()
+    void execute();
+
+    Function m_fun;
+    Priority m_priority;
+    boost::shared_ptr<const NumaPlacement> m_placement;  ///< placement of the submitting thread
+    State m_state;
+    std::exception_ptr m_error;
+    mutable boost::mutex m_mutex;
+    boost::condition m_cond;
+  };
+
+  /**
+   *  @brief Placement of the calling thread and of tasks which it submits.
+   *
+   *  Applies placement to the calling thread (NumaPlacement::Scope) and
+   *  makes it the placement of tasks submitted by this thread, and by these
+   *  tasks in turn. Previous placement is restored in destructor. Zero
+   *  pointer means the default placement.
+   */
+  class PlacementScope : boost::noncopyable {
+  public:
+    explicit PlacementScope(const boost::shared_ptr<const NumaPlacement>& placement);
+    ~PlacementScope();
+  private:
+    boost::shared_ptr<const NumaPlacement> m_previous;
+    NumaPlacement::Scope m_scope;
+  };
+
+  /// Placement set by PlacementScope in the calling thread, zero pointer if none
+  static boost::shared_ptr<const NumaPlacement> placement();
+
+  /// Scheduler shared by all XtcInput classes
+  static TaskScheduler& instance();
+
+  /// Number of CPUs which the process can use: cgroup quota or CPU affinity
+  static unsigned cpuQuota();
+
+  /// Make scheduler with given number of threads (at least one)
+  explicit TaskScheduler(unsigned nThreads);
+
+  /// Destructor runs all queued tasks and stops the threads
+  ~TaskScheduler();
+
+  /// Queue function for one of the threads
+  boost::shared_ptr<Task> submit(const Function& fun, Priority priority);
+
+  /// Number of threads
+  unsigned size() const { return m_queues.size(); }
+
+protected:
+
+  // body of a pool thread
+  void work(unsigned index);
+
+  // remove one task from the queues, own queue first
+  boost::shared_ptr<Task> take(unsigned index);
+
+private:
+
+  struct Queue {
+    boost::mutex mutex;
+    std::deque<boost::shared_ptr<Task> > tasks[NumPriorities];
+  };
+
+  std::vector<boost::shared_ptr<Queue> > m_queues;  ///< one per thread
+  unsigned m_nextQueue;       ///< queue for the next task from outside the pool
+  unsigned m_pending;         ///< number of tasks in all queues
+  bool m_stop;
+  boost::mutex m_mutex;
+  boost::condition m_cond;
+  boost::thread_group m_threads;
+};
+
+} // namespace XtcInput
+
+#endif // XTCINPUT_TASKSCHEDULER_H
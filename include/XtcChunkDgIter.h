@@ -28,6 +28,7 @@
 //------------------------------------
 // Collaborating Class Declarations --
 //------------------------------------
+#include "XtcInput/ChunkPrefetcher.h"
 #include "XtcInput/DgHeader.h"
 #include "XtcInput/SharedFile.h"
 #include "XtcInput/XtcFileName.h"
@@ -74,6 +75,18 @@ public:
    */
   XtcChunkDgIter (const XtcFileName& path, unsigned liveTimeout = 0) ;
 
+  /**
+   *  @brief Create iterator which takes datagrams from a prefetcher
+   *
+   *  next() returns datagrams read by ChunkPrefetcher thread. If nextAtOffset()
+   *  is called the prefetcher is dropped and the file is read directly.
+   *
+   *  @param[in]  prefetch  Prefetcher for closed chunk file
+   *
+   *  @throw FileOpenException Thrown in case file cannot be open.
+   */
+  explicit XtcChunkDgIter (const boost::shared_ptr<ChunkPrefetcher>& prefetch) ;
+
   // Destructor
   ~XtcChunkDgIter () ;
 
@@ -108,6 +121,29 @@ public:
    */
   boost::shared_ptr<DgHeader> nextAtOffset(off64_t offset);
 
+  /**
+   *  @brief Returns true if next() will not wait for live data.
+   *
+   *  True when the whole next datagram (header and payload) is already in the
+   *  file or when the file is closed by the writer. Always true for files which
+   *  are not live. Does not change the position of the iterator.
+   */
+  bool nextReady() ;
+
+  /**
+   *  @brief Returns number of bytes after the next datagram to read.
+   *
+   *  Negative if it is not known yet because live file is still being written.
+   */
+  off_t bytesLeft() ;
+
+  /**
+   *  @brief Read first bytes of the file so that they are in the page cache.
+   *
+   *  For live files only the part which is already written is read.
+   */
+  void warm(size_t bytes) ;
+
   /**
    *  @brief Returns XtcFileName for this chunk.
    *
@@ -121,6 +157,8 @@ private:
 
   SharedFile m_file;    ///< Single chunk file
   off_t      m_off;     ///< offset in file of the next datagram to read
+  boost::shared_ptr<ChunkPrefetcher> m_prefetch;  ///< if non-zero next() takes datagrams from it
+  off_t      m_finalSize;  ///< size of the file once it does not grow any more, -1 before
 
 };
 
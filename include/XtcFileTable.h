@@ -0,0 +1,116 @@
+#ifndef XTCINPUT_XTCFILETABLE_H
+#define XTCINPUT_XTCFILETABLE_H
+
+//--------------------------------------------------------------------------
+// File and Version Information:
+// 	$Id$
+//
+// Description:
+//	Class XtcFileTable.
+//
+//------------------------------------------------------------------------
+
+//-----------------
+// C/C++ Headers --
+//-----------------
+#include <atomic>
+#include <map>
+#include <string>
+#include <stdint.h>
+#include <boost/thread/mutex.hpp>
+#include <boost/utility.hpp>
+
+//----------------------
+// Base Class Headers --
+//----------------------
+
+//-------------------------------
+// Collaborating Class Headers --
+//-------------------------------
+#include "XtcInput/XtcFileName.h"
+
+//------------------------------------
+// Collaborating Class Declarations --
+//------------------------------------
+
+//		---------------------
+// 		-- Class Interface --
+//		---------------------
+
+namespace XtcInput {
+
+/// @addtogroup XtcInput
+
+/**
+ *  @ingroup XtcInput
+ *
+ *  @brief Table of interned file names shared by all readers.
+ *
+ *  Datagrams carry a small FileId instead of a copy of XtcFileName, the
+ *  name is resolved with name() when somebody needs it. Each distinct path
+ *  is stored once by intern(), which is called when a file is opened (see
+ *  SharedFile). Entries are never removed or moved, so name() needs no
+ *  lock and the returned reference stays valid. Id 0 is the empty name.
+ *
+ *  The table lives as long as the process and is not cleared when a
+ *  reader finishes: datagrams only keep the id and may be held by user
+ *  code after their reader is gone, so no reader can tell when its names
+ *  are not needed anymore. Memory grows with the number of distinct
+ *  chunk files opened, which is a few hundred per run (streams times
+ *  chunks), a few hundred bytes each. The table holds up to 4M names
+ *  (MaxBlocks blocks of BlockSize), that is thousands of runs in one
+ *  process; intern() throws when it is full instead of growing without
+ *  bound, so a process which is expected to read more than that has to
+ *  be restarted.
+ *
+ *  This software was developed for the LCLS project.  If you use all or
+ *  part of it, please give an appropriate acknowledgment.
+ *
+ *  @version $Id$
+ */
+
+class XtcFileTable : boost::noncopyable {
+public:
+
+  typedef uint32_t FileId;
+
+  /// Id of the empty file name
+  enum { EmptyId = 0 };
+
+  /// Returns the instance used by everybody, lives until the process exits
+  static XtcFileTable& instance();
+
+  /**
+   *  @brief Returns id for a file name, adds the name if it is new.
+   *
+   *  @throw XTCGenException Thrown if the table is full
+   */
+  FileId intern(const XtcFileName& file);
+
+  /// Returns file name for an id returned by intern()
+  const XtcFileName& name(FileId id) const {
+    return m_blocks[id >> BlockBits].load(std::memory_order_acquire)[id & BlockMask];
+  }
+
+  /// Returns number of names in the table, including the empty one
+  size_t size() const;
+
+protected:
+
+  XtcFileTable();
+
+  ~XtcFileTable();
+
+private:
+
+  enum { BlockBits = 10, BlockSize = 1 << BlockBits, BlockMask = BlockSize - 1, MaxBlocks = 4096 };
+
+  std::atomic<XtcFileName*> m_blocks[MaxBlocks];  ///< entries in blocks which never move
+  std::map<std::string, FileId> m_ids;            ///< path to id
+  FileId m_size;                                  ///< next free id
+  mutable boost::mutex m_mutex;                   ///< protects m_ids, m_size and adding blocks
+};
+
+} // namespace XtcInput
+
+#endif // XTCINPUT_XTCFILETABLE_H
@@ -13,7 +13,11 @@
 //-----------------
 // C/C++ Headers --
 //-----------------
+#include <deque>
+#include <exception>
 #include <boost/shared_ptr.hpp>
+#include <boost/thread/condition.hpp>
+#include <boost/thread/mutex.hpp>
 #include <boost/utility.hpp>
 
 //----------------------
@@ -24,7 +28,10 @@
 // Collaborating Class Headers --
 //-------------------------------
 #include "XtcInput/Dgram.h"
+#include "XtcInput/DgramList.h"
+#include "XtcInput/MemoryGovernor.h"
 #include "XtcInput/RunFileIterI.h"
+#include "XtcInput/TaskScheduler.h"
 #include "XtcInput/XtcStreamMerger.h"
 #include "XtcInput/XtcFileName.h"
 #include "XtcInput/XtcFilesPosition.h"
@@ -57,11 +64,40 @@ namespace XtcInput {
 class XtcMergeIterator : boost::noncopyable {
 public:
 
-  // Default constructor
+  // Default constructor. If pipelineRuns is true then merger for the next
+  // run is made by a TaskScheduler task while the current run is being read,
+  // this should not be used for live data. Only L1Accepts of the given
+  // shard are returned. With cycleThreads > 1 calib cycles of a run are
+  // merged in parallel, see XtcStreamMerger.
+  //
+  // With concurrentRuns > 1 up to this many runs are merged at the same time
+  // by TaskScheduler tasks, each by its own XtcStreamMerger which keeps
+  // merged events in memory until they are returned (pipelineRuns is not
+  // used then). Runs are returned one after another, never interleaved, in
+  // the order of runIter or, if completionOrder is true, in the order in
+  // which they become ready: merging has finished or its memory is full.
+  // Not for live data.
+  //
+  // All buffers of the mergers (prefetched chunks, calib cycles, concurrent
+  // runs) are counted in memory, which also makes them smaller when it is
+  // nearly used up. Zero pointer means no limit.
+  //
+  // If segmentedDgrams is true then datagrams above the contiguous limit
+  // are returned segmented (see DgHeader::dgram()), otherwise reading them
+  // throws XTCSizeLimitException.
   XtcMergeIterator(const boost::shared_ptr<RunFileIterI>& runIter, 
                    double l1OffsetSec, int firstControlStream,
                    unsigned maxStreamClockDiffSec,
-                   boost::shared_ptr<XtcFilesPosition> thirdEvent);
+                   boost::shared_ptr<XtcFilesPosition> thirdEvent,
+                   XtcStreamMerger::MergeEngine engine = XtcStreamMerger::PriorityQueueEngine,
+                   unsigned prefetchChunks = 0,
+                   bool pipelineRuns = false,
+                   const ShardSpec& shard = ShardSpec(),
+                   unsigned cycleThreads = 0,
+                   unsigned concurrentRuns = 0,
+                   bool completionOrder = false,
+                   const boost::shared_ptr<MemoryGovernor>& memory = boost::shared_ptr<MemoryGovernor>(),
+                   bool segmentedDgrams = false);
 
 
   // Destructor
@@ -81,6 +117,19 @@ public:
    */
   Dgram next() ;
 
+  /**
+   *  @brief Return all datagrams of the next event.
+   *
+   *  Same as next() but returns complete events as built by
+   *  XtcStreamMerger::nextEvent(). Empty list is returned after
+   *  the last run has been read.
+   *
+   *  @throw FileOpenException Thrown in case chunk file cannot be open.
+   *  @throw XTCReadException Thrown for any read errors
+   *  @throw XTCLiveTimeout Thrown for timeout during live data reading
+   */
+  DgramList nextEvent() ;
+
   /**
    * return true if available events, outside the stream queues, is at least numEvents.
    */
@@ -88,7 +137,37 @@ public:
 
 protected:
 
+  // make merger for the next run, returns false if there are no more runs
+  bool openNextRun();
+
+  // make merger for the run, reads first datagram in every stream
+  boost::shared_ptr<XtcStreamMerger> makeMerger(const boost::shared_ptr<StreamFileIterI>& fileNameIter,
+                                                const boost::shared_ptr<XtcFilesPosition>& xtcFilesPos);
+
+  // body of the task which makes merger for the next run
+  void makeNextRunMerger();
+
+  // position for the run which runIter has just returned, thirdEvent for the first run
+  boost::shared_ptr<XtcFilesPosition> runStartPosition();
+
 private:
+
+  struct RunSegment;
+
+  // start merging next run from runIter, false if there are no more runs
+  bool startRun();
+
+  // next event of the run, false at its end, called by the merging task
+  bool mergeRun(RunSegment* segment, DgramList& event);
+
+  // buffer of a run has new events or its task has returned
+  void runChanged();
+
+  // remove run which is returned next from m_runs
+  boost::shared_ptr<RunSegment> takeRun();
+
+  // next event from the runs merged concurrently
+  DgramList nextRunEvent();
   
   boost::shared_ptr<RunFileIterI> m_runIter;
   double m_l1OffsetSec;
@@ -97,6 +176,26 @@ private:
   boost::shared_ptr<XtcStreamMerger> m_dgiter ;  ///< Datagram iterator for current run
   boost::shared_ptr<XtcFilesPosition> m_thirdEvent;
   bool m_firstRun;
+  XtcStreamMerger::MergeEngine m_engine;
+  unsigned m_prefetchChunks;
+  bool m_pipelineRuns;
+  ShardSpec m_shard;
+  unsigned m_cycleThreads;
+  boost::shared_ptr<MemoryGovernor> m_memory;     ///< counts run buffers, passed to mergers
+  bool m_segmentedDgrams;                         ///< passed to mergers
+  boost::shared_ptr<TaskScheduler::Task> m_nextRunTask; ///< makes merger for the next run
+  boost::shared_ptr<XtcStreamMerger> m_nextMerger;  ///< merger for the next run, zero after last run
+  unsigned m_nextRun;                             ///< run number of m_nextMerger
+  std::exception_ptr m_nextRunError;              ///< exception from m_nextRunTask
+  unsigned m_concurrentRuns;                      ///< max number of runs merged at the same time
+  bool m_completionOrder;                         ///< runs are returned when they are ready
+  bool m_noMoreRuns;                              ///< runIter is exhausted
+  std::deque<boost::shared_ptr<RunSegment> > m_runs;  ///< runs being merged, not yet returned
+  boost::shared_ptr<RunSegment> m_currentRun;     ///< run being returned
+  std::deque<Dgram> m_runOutput;                  ///< rest of the event when next() is used
+  boost::mutex m_runMutex;                        ///< protects m_currentRun and m_runChanges
+  boost::condition m_runCond;                     ///< signals new events or finished runs
+  unsigned m_runChanges;                          ///< counts runChanged() calls
 
 };
 
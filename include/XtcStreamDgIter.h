@@ -13,6 +13,7 @@
 //-----------------
 // C/C++ Headers --
 //-----------------
+#include <deque>
 #include <string>
 #include <vector>
 #include <cstdio>
@@ -27,8 +28,11 @@
 // Collaborating Class Headers --
 //-------------------------------
 #include "XtcInput/ChunkFileIterI.h"
+#include "XtcInput/ChunkPrefetcher.h"
+#include "XtcInput/ChunkPreopener.h"
 #include "XtcInput/DgHeader.h"
 #include "XtcInput/Dgram.h"
+#include "XtcInput/MemoryGovernor.h"
 #include "XtcInput/XtcFileName.h"
 
 //------------------------------------
@@ -70,9 +74,18 @@ public:
    *
    *  @param[in]  chunkIter Iterator over chunks in a stream
    *  @param[in]  controlStream indicates this is a control/EPICS IOC stream
+   *  @param[in]  prefetchChunks if non-zero then this many chunks of the stream
+   *              are read in parallel by ChunkPrefetcher threads (not for live data)
+   *  @param[in]  memory memory budget of the reader, fewer chunks are prefetched
+   *              when it is nearly used up; zero pointer for no limit
+   *  @param[in]  segmentedDgrams if true then datagrams above the contiguous
+   *              limit are returned segmented, see DgHeader::dgram()
    */
   XtcStreamDgIter(const boost::shared_ptr<ChunkFileIterI>& chunkIter,
-                  bool controlStream=false);
+                  bool controlStream=false,
+                  unsigned prefetchChunks=0,
+                  const boost::shared_ptr<MemoryGovernor>& memory = boost::shared_ptr<MemoryGovernor>(),
+                  bool segmentedDgrams = false);
 
   /// struct to take a filename and offset for the third datagram in the iteration
   struct ThirdDatagram {
@@ -98,10 +111,16 @@ public:
    *             third datagram this stream iterator returns. The filename must
    *             exist in the chunkIter or an exception will be thrown from next
    *  @param[in] controlStream true if this is a control/EPICS/IOC stream
+   *  @param[in] prefetchChunks as with first constructor
+   *  @param[in] memory as with first constructor
+   *  @param[in] segmentedDgrams as with first constructor
    */
   XtcStreamDgIter(const boost::shared_ptr<ChunkFileIterI>& chunkIter,
                   const boost::shared_ptr<ThirdDatagram> & thirdDatagram,
-                  bool controlStream = false);
+                  bool controlStream = false,
+                  unsigned prefetchChunks = 0,
+                  const boost::shared_ptr<MemoryGovernor>& memory = boost::shared_ptr<MemoryGovernor>(),
+                  bool segmentedDgrams = false);
 
   // Destructor
   ~XtcStreamDgIter () ;
@@ -120,6 +139,53 @@ public:
    */
   Dgram next() ;
 
+  /**
+   *  @brief Return header of the next datagram without reading its payload.
+   *
+   *  Same order as next(), zero pointer after last file has been read.
+   *  Caller reads the datagram with DgHeader::dgram() if it needs it, this
+   *  may return zero pointer for non-fatal read errors.
+   *
+   *  @throw FileOpenException Thrown in case chunk file cannot be open.
+   *  @throw XTCReadException Thrown for any read errors
+   *  @throw XTCLiveTimeout Thrown for timeout during live data reading
+   */
+  boost::shared_ptr<DgHeader> nextHeader() ;
+
+  /**
+   *  @brief Return true if next() will not wait for live data.
+   *
+   *  Reads ahead all complete datagrams which are already in the live
+   *  files without waiting for more data. Always true for closed files.
+   */
+  bool ready() ;
+
+  /**
+   *  @brief Fill the read-ahead queue.
+   *
+   *  next() does this itself, this can be used to fill the queue in a
+   *  different thread while nobody else uses this instance. First call to
+   *  next() only reads up to the first transition (normally Configure)
+   *  as this is enough to return it.
+   */
+  void fill() { readAhead(true); }
+
+  /// Return timeout value for reading live data, 0 for closed files
+  unsigned liveTimeout() const { return m_chunkIter->liveTimeout(); }
+
+  /// Return name of the chunk file being read, empty if none is open
+  XtcFileName chunkName() const;
+
+  /**
+   *  @brief Tell whether the merger has other live streams to use.
+   *
+   *  For live data next() waits for the writer until the read-ahead queue
+   *  is full, so that datagrams are sorted like in closed files. While
+   *  the merger can use other streams it only waits when the queue is
+   *  empty and takes what is on disk otherwise. Off by default.
+   */
+  void setOtherStreams(bool others) { m_otherStreams = others; }
+
   /**
    * @brief returns the last DgHeader in the queue
    *
@@ -131,12 +197,15 @@ protected:
 
 private:
 
-  // fill the read-ahead queue
-  void readAhead();
+  // fill the read-ahead queue, if wait is false then live data is never waited for
+  void readAhead(bool wait);
 
   // add one header to the queue in a correct position
   void queueHeader(const boost::shared_ptr<DgHeader>& header);
 
+  // open iterator for the next chunk, zero pointer after the last chunk
+  boost::shared_ptr<XtcChunkDgIter> openNextChunk();
+
   typedef std::vector<boost::shared_ptr<DgHeader> > HeaderQueue;
 
   boost::shared_ptr<ChunkFileIterI> m_chunkIter;  ///< Iterator over chunk file names
@@ -146,6 +215,12 @@ private:
   HeaderQueue m_headerQueue;            ///< Queue for read-ahead headers
   bool m_controlStream;                 ///< true if this is a control stream
   boost::shared_ptr<ThirdDatagram> m_thirdDatagram;
+  unsigned m_prefetchChunks;            ///< number of chunks to read in parallel
+  boost::shared_ptr<MemoryGovernor> m_memory;  ///< passed to ChunkPrefetcher
+  bool m_segmentedDgrams;               ///< passed to DgHeader::dgram()
+  bool m_otherStreams;                  ///< merger has other live streams, see setOtherStreams()
+  std::deque<boost::shared_ptr<ChunkPrefetcher> > m_prefetch; ///< following chunks being read
+  boost::shared_ptr<ChunkPreopener> m_preopen;  ///< next chunk being opened in the background
 };
 
 } // namespace XtcInput
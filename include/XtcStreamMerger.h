@@ -16,6 +16,7 @@
 #include <map>
 #include <queue>
 #include <deque>
+#include <vector>
 #include <boost/utility.hpp>
 #include <boost/shared_ptr.hpp>
 
@@ -26,8 +27,15 @@
 //-------------------------------
 // Collaborating Class Headers --
 //-------------------------------
+#include "XtcInput/ChunkFileIterI.h"
+#include "XtcInput/DgramList.h"
+#include "XtcInput/EventJoinTable.h"
+#include "XtcInput/LoserTree.h"
+#include "XtcInput/MemoryGovernor.h"
+#include "XtcInput/ShardSpec.h"
 #include "XtcInput/StreamDgram.h"
 #include "XtcInput/StreamFileIterI.h"
+#include "XtcInput/TaskScheduler.h"
 #include "XtcInput/XtcStreamDgIter.h"
 #include "XtcInput/XtcFileName.h"
 #include "XtcInput/XtcFilesPosition.h"
@@ -65,6 +73,18 @@ namespace XtcInput {
 class XtcStreamMerger : boost::noncopyable {
 public:
 
+  /**
+   *  @brief Algorithm used to select the next datagram among the streams.
+   *
+   *  PriorityQueueEngine keeps all stream heads in a std::priority_queue,
+   *  LoserTreeEngine keeps one slot per stream in a LoserTree and only replays
+   *  the path of the replaced stream. Both produce the same order.
+   *  HashJoinEngine does not compare datagrams with StreamDgramGreater, it joins
+   *  them into events on unwrapped fiducials in an EventJoinTable and tolerates
+   *  stream clocks up to half a fiducial cycle apart.
+   */
+  enum MergeEngine { PriorityQueueEngine, LoserTreeEngine, HashJoinEngine };
+
   /**
    *  @brief Make iterator instance
    *
@@ -74,11 +94,37 @@ public:
    *  @param[in]  maxStreamClockDiffSec maximum difference between stream clocks in seconds
    *              should be <= 85 seconds.
    *  @param[in]  thirdEvent if non-null, offsets for second event
+   *  @param[in]  engine algorithm used to merge the streams
+   *  @param[in]  prefetchChunks number of chunks of each stream read in parallel,
+   *              0 to read chunks one after another
+   *  @param[in]  shard share of L1Accepts returned by this instance, transitions
+   *              are always returned. Payload of other L1Accepts is not read,
+   *              unless prefetchChunks is non-zero.
+   *  @param[in]  cycleThreads if greater than 1, number of calib cycles merged
+   *              in parallel, see below
+   *  @param[in]  memory memory budget of the reader for prefetched chunks and
+   *              calib cycle buffers, zero pointer for no limit
+   *  @param[in]  segmentedDgrams if true then datagrams above the contiguous
+   *              limit are returned segmented, see DgHeader::dgram()
+   *
+   *  With cycleThreads > 1 headers of all streams are scanned first for
+   *  BeginCalibCycle transitions. If every stream has the same number of
+   *  them (at least two) each calib cycle is merged by a separate instance
+   *  in TaskScheduler tasks, jumping to the cycle like thirdEvent does, and
+   *  the cycles are returned in order. At most cycleThreads cycles are
+   *  in progress at the same time. Otherwise, and for live data or
+   *  with thirdEvent, streams are merged serially.
    */
   XtcStreamMerger(const boost::shared_ptr<StreamFileIterI>& streamIter,
                   double l1OffsetSec, int firstControlStream,
                   unsigned maxStreamClockDiffSec,
-                  boost::shared_ptr<XtcFilesPosition> thirdEvent) ;
+                  boost::shared_ptr<XtcFilesPosition> thirdEvent,
+                  MergeEngine engine = PriorityQueueEngine,
+                  unsigned prefetchChunks = 0,
+                  const ShardSpec& shard = ShardSpec(),
+                  unsigned cycleThreads = 0,
+                  const boost::shared_ptr<MemoryGovernor>& memory = boost::shared_ptr<MemoryGovernor>(),
+                  bool segmentedDgrams = false) ;
 
   // Destructor
   ~XtcStreamMerger () ;
@@ -97,6 +143,21 @@ public:
    */
   Dgram next() ;
 
+  /**
+   *  @brief Return all datagrams of the next event.
+   *
+   *  Collects consecutive datagrams from different streams for which
+   *  StreamDgramGreater::sameEvent is true. Each stream contributes at most
+   *  one datagram. The list also holds file name and offset of each datagram.
+   *  Returns an empty list after the last file has been read. Calls to next()
+   *  and nextEvent() can be mixed.
+   *
+   *  @throw FileOpenException Thrown in case chunk file cannot be open.
+   *  @throw XTCReadException Thrown for any read errors
+   *  @throw XTCLiveTimeout Thrown for timeout during live data reading
+   */
+  DgramList nextEvent() ;
+
   unsigned countAvailDgramsStopAt(unsigned maxToCount);
 
 protected:
@@ -137,11 +198,64 @@ protected:
   static uint64_t getNextBlock(const TransBlock & prevTransBlock, const Dgram &dg);
   bool processingDAQ() const { return m_processingDAQ; }
 
+  // next datagram with its merge information, caller holds m_protect
+  StreamDgram nextStreamDgram();
+
+  // next event from the join table for HashJoinEngine, caller holds m_protect
+  DgramList nextJoinedEvent();
+
+  // add first datagram of a stream to the merge engine
+  void pushInitial(const StreamDgram &dg);
+
+  // earliest datagram among the streams
+  const StreamDgram & topDgram();
+
+  // replace earliest datagram with the next one from the same stream, returns the earliest
+  StreamDgram exchangeTopDgram(StreamDgram &&dg);
+
 private:
   typedef std::pair<StreamDgram::StreamType, int> StreamIndex;
+  typedef std::vector<std::pair<unsigned, boost::shared_ptr<ChunkFileIterI> > > ChunkIters;
+  struct CycleSegment;
   static std::string dumpStr(const StreamIndex &streamIndex);           ///< debugging string for StreamIndex
+
+  // next datagram from one stream with its L1Block, skips datagrams which are not merged
+  StreamDgram readStreamDgram(const StreamIndex &streamIndex);
+
+  // next datagram from one stream and its L1Block, skips datagrams which are not merged
+  Dgram readDgram(const StreamIndex &streamIndex, XtcStreamDgIter& stream, 
+                  TransBlock& priorTransBlock, uint64_t& block);
+
+  // wait for the read-ahead task which the constructor started for the stream
+  void waitForFill(const StreamIndex &streamIndex);
+
+  // next datagram of the only stream, merging is bypassed, caller holds m_protect
+  Dgram nextSingleDgram();
+
+  // for live data wait until stream has complete datagram, reading ahead in other streams,
+  // throws XTCLiveTimeout after liveTimeout seconds
+  void waitForStream(const StreamIndex &streamIndex);
+
+  // live stream has no more datagrams, the last one left waits for its full read-ahead
+  void liveStreamDone();
+
+  // find calib cycles in all streams and start merging them in parallel, false
+  // if streams have to be merged serially, chunk iterators are replaced then
+  bool initCycles(ChunkIters &chunkIters);
+
+  // start merging next calib cycle
+  void startCycle();
+
+  // next event of the calib cycle, false at its end, called by the merging task
+  bool mergeCycle(CycleSegment* segment, DgramList& event);
+
+  // next event from the calib cycles merged in parallel, caller holds m_protect
+  DgramList nextCycleEvent();
+
   std::map<StreamIndex, boost::shared_ptr<XtcStreamDgIter> > m_streams; ///< Set of datagram iterators for streams
   std::map<StreamIndex, TransBlock> m_priorTransBlock;                  ///< TransBlock for last dgram from each stream
+  typedef std::map<StreamIndex, boost::shared_ptr<TaskScheduler::Task> > FillTasks;
+  FillTasks m_fillTasks;                      ///< read-ahead started by the constructor, until first use of the stream
 
   bool m_processingDAQ;                       ///< set to true if DAQ streams exist in the merge
   int32_t m_l1OffsetSec ;                     ///< Time offset to add to non-L1Accept transitions (seconds)
@@ -150,8 +264,45 @@ private:
   StreamDgramGreater m_streamDgramGreater;    ///< for comparing two dgrams in the priority queue
   boost::shared_ptr<XtcFilesPosition> m_thirdEvent; ///< if non-null, offsets for third event
 
-  typedef std::priority_queue<StreamDgram, std::vector<StreamDgram>, StreamDgramGreater> OutputQueue;
+  MergeEngine m_engine;                       ///< which of the two containers below is used
+  // priority queue which can move its top element out
+  class OutputQueue : public std::priority_queue<StreamDgram, std::vector<StreamDgram>, StreamDgramGreater> {
+  public:
+    explicit OutputQueue(const StreamDgramGreater& greater) : std::priority_queue<StreamDgram, std::vector<StreamDgram>, StreamDgramGreater>(greater) {}
+    StreamDgram exchangeTop(StreamDgram &&dg) {
+      std::pop_heap(c.begin(), c.end(), comp);
+      StreamDgram top(std::move(c.back()));
+      c.back() = std::move(dg);
+      std::push_heap(c.begin(), c.end(), comp);
+      return top;
+    }
+  };
   OutputQueue m_outputQueue;                  ///< Output queue for datagrams
+  typedef LoserTree<StreamDgram, StreamDgramGreater> OutputTree;
+  OutputTree m_outputTree;                    ///< One slot per stream for LoserTreeEngine
+  EventJoinTable m_joinTable;                 ///< Pending events for HashJoinEngine
+  std::vector<StreamIndex> m_joinStreams;     ///< Stream in each slot of m_joinTable
+  std::deque<StreamDgram> m_joinOutput;       ///< Rest of the joined or cycle event when next() is used
+  ShardSpec m_shard;                          ///< L1Accepts returned by this instance
+  uint64_t m_blockOffset;                     ///< L1Block of the first calib cycle, for cycle mergers
+
+  bool m_cycleMode;                           ///< calib cycles are merged in parallel
+  unsigned m_cycleThreads;                    ///< max number of calib cycles merged at the same time
+  double m_cycleL1OffsetSec;                  ///< l1OffsetSec for the cycle mergers
+  unsigned m_maxStreamClockDiffSec;           ///< for the cycle mergers
+  std::vector<XtcFileName> m_cycleFiles;      ///< all files of the run
+  std::vector<boost::shared_ptr<XtcFilesPosition> > m_cycleStarts; ///< BeginCalibCycle of each cycle
+  size_t m_nextCycle;                         ///< next calib cycle to start
+  boost::shared_ptr<MemoryGovernor> m_memory; ///< counts cycle buffers, passed to streams
+  bool m_segmentedDgrams;                     ///< passed to streams and DgHeader::dgram()
+  std::deque<boost::shared_ptr<CycleSegment> > m_cycles; ///< cycles being merged, current first, their tasks use members above
+
+  boost::shared_ptr<XtcStreamDgIter> m_singleStream; ///< the only stream, non-zero if merging is bypassed
+  StreamIndex m_singleIndex;                  ///< index of m_singleStream
+  TransBlock* m_singlePrior;                  ///< its entry in m_priorTransBlock
+  Dgram m_singleFirst;                        ///< first datagram, until it is returned
+  bool m_singleEnd;                           ///< m_singleStream has no more datagrams
+  unsigned m_liveStreams;                     ///< live streams which still have datagrams
   StreamAvail m_streamAvail;
 
   // synchronize calls to next from reader thread and countAvailDgramsStopAt from analysis thread
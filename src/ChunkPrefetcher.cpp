@@ -0,0 +1,100 @@
+//--------------------------------------------------------------------------
+// File and Version Information:
+// 	$Id$
+//
+// Description:
+//	Class ChunkPrefetcher...
+//
+//------------------------------------------------------------------------
+
+//-----------------------
+// This Class's Header --
+//-----------------------
+#include "XtcInput/ChunkPrefetcher.h"
+
+//-----------------
+// C/C++ Headers --
+//-----------------
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+
+//-------------------------------
+// Collaborating Class Headers --
+//-------------------------------
+#include "MsgLogger/MsgLogger.h"
+#include "XtcInput/XtcChunkDgIter.h"
+
+//-----------------------------------------------------------------------
+// Local Macros, Typedefs, Structures, Unions and Forward Declarations --
+//-----------------------------------------------------------------------
+
+namespace {
+
+  const char* logger = "XtcInput.ChunkPrefetcher";
+
+  // memory used by the datagram of a header
+  size_t dgramSize(const boost::shared_ptr<XtcInput::DgHeader>& hptr)
+  {
+    return hptr->nextOffset() - hptr->offset();
+  }
+
+}
+
+//		----------------------------------------
+// 		-- Public Function Member Definitions --
+//		----------------------------------------
+
+namespace XtcInput {
+
+//----------------
+// Constructors --
+//----------------
+ChunkPrefetcher::ChunkPrefetcher(const XtcFileName& path, size_t maxBytes,
+                                 const boost::shared_ptr<MemoryGovernor>& memory,
+                                 bool segmentedDgrams)
+  : m_path(path)
+  , m_segmentedDgrams(segmentedDgrams)
+  , m_iter()
+  , m_buffer(boost::bind(&ChunkPrefetcher::readNext, this, _1), dgramSize, maxBytes,
+             memory ? memory : boost::make_shared<MemoryGovernor>(0),
+             MemoryGovernor::Prefetch, TaskScheduler::Prefetch)
+{
+  MsgLog(logger, trace, "start prefetching file: " << m_path);
+  m_buffer.start();
+}
+
+//--------------
+// Destructor --
+//--------------
+ChunkPrefetcher::~ChunkPrefetcher()
+{
+  // m_buffer is destroyed first, it stops the reading task
+}
+
+// Returns next datagram header with complete datagram, zero on EOF
+boost::shared_ptr<DgHeader>
+ChunkPrefetcher::next()
+{
+  boost::shared_ptr<DgHeader> hptr;
+  if (not m_buffer.next(hptr)) return boost::shared_ptr<DgHeader>();
+  return hptr;
+}
+
+// read next complete datagram, false on EOF, called by the reading task
+bool
+ChunkPrefetcher::readNext(boost::shared_ptr<DgHeader>& hptr)
+{
+  if (not m_iter) m_iter = boost::make_shared<XtcChunkDgIter>(m_path);
+
+  // header pass, then payload of the same datagram
+  boost::shared_ptr<DgHeader> header = m_iter->next();
+  if (not header) return false;
+  Dgram::ptr dg = header->dgram(m_segmentedDgrams);
+  if (not dg) return false;
+
+  // file is shared with header, no new file descriptor for the datagram
+  hptr = boost::make_shared<DgHeader>(dg, header->file(), header->offset());
+  return true;
+}
+
+} // namespace XtcInput
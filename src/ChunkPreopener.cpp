@@ -0,0 +1,91 @@
+//--------------------------------------------------------------------------
+// File and Version Information:
+// 	$Id$
+//
+// Description:
+//	Class ChunkPreopener...
+//
+//------------------------------------------------------------------------
+
+//-----------------------
+// This Class's Header --
+//-----------------------
+#include "XtcInput/ChunkPreopener.h"
+
+//-----------------
+// C/C++ Headers --
+//-----------------
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+
+//-------------------------------
+// Collaborating Class Headers --
+//-------------------------------
+#include "MsgLogger/MsgLogger.h"
+
+//-----------------------------------------------------------------------
+// Local Macros, Typedefs, Structures, Unions and Forward Declarations --
+//-----------------------------------------------------------------------
+
+namespace {
+
+  const char* logger = "XtcInput.ChunkPreopener";
+
+}
+
+//		----------------------------------------
+// 		-- Public Function Member Definitions --
+//		----------------------------------------
+
+namespace XtcInput {
+
+//----------------
+// Constructors --
+//----------------
+ChunkPreopener::ChunkPreopener(const boost::shared_ptr<ChunkFileIterI>& chunkIter, size_t warmBytes)
+  : m_chunkIter(chunkIter)
+  , m_warmBytes(warmBytes)
+  , m_dgiter()
+  , m_exception()
+  , m_task()
+{
+  // for live data the reader will wait for this file soon
+  TaskScheduler::Priority priority = 
+    m_chunkIter->liveTimeout() > 0 ? TaskScheduler::Live : TaskScheduler::Normal;
+  m_task = TaskScheduler::instance().submit(boost::bind(&ChunkPreopener::run, this), priority);
+}
+
+//--------------
+// Destructor --
+//--------------
+ChunkPreopener::~ChunkPreopener()
+{
+  m_task->cancel();
+}
+
+// Returns iterator for the next chunk, zero pointer if there are no more chunks
+boost::shared_ptr<XtcChunkDgIter>
+ChunkPreopener::get()
+{
+  m_task->wait();
+  if (m_exception) std::rethrow_exception(m_exception);
+  return m_dgiter;
+}
+
+// body of the task
+void
+ChunkPreopener::run()
+try {
+  const XtcFileName& file = m_chunkIter->next();
+  if (file.path().empty()) return;
+
+  MsgLog(logger, trace, "pre-opening file: " << file) ;
+  m_dgiter = boost::make_shared<XtcChunkDgIter>(file, m_chunkIter->liveTimeout());
+  m_dgiter->warm(m_warmBytes);
+
+} catch (...) {
+
+  m_exception = std::current_exception();
+}
+
+} // namespace XtcInput
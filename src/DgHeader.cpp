@@ -18,11 +18,13 @@
 //-----------------
 // C/C++ Headers --
 //-----------------
+#include <boost/make_shared.hpp>
 
 //-------------------------------
 // Collaborating Class Headers --
 //-------------------------------
 #include "XtcInput/Exceptions.h"
+#include "XtcInput/SegmentedDgram.h"
 #include "MsgLogger/MsgLogger.h"
 
 //-----------------------------------------------------------------------
@@ -52,11 +54,23 @@ DgHeader::DgHeader(const Pds::Dgram& header, const SharedFile& file, off_t off)
   : m_header()
   , m_file(file)
   , m_off(off)
+  , m_dgram()
 {
   // Dgram copy constructor does not work like we need, do byte-copy instead for sure way
   std::copy((const char*)&header, ((const char*)&header)+sizeof header, (char*)&m_header);
 }
 
+DgHeader::DgHeader(const Dgram::ptr& dgram, const SharedFile& file, off_t off)
+  : m_header()
+  , m_file(file)
+  , m_off(off)
+  , m_dgram(dgram)
+{
+  boost::shared_ptr<const SegmentedDgram> segments = SegmentedDgram::find(dgram);
+  const Pds::Dgram* header = segments ? &segments->header() : dgram.get();
+  std::copy((const char*)header, ((const char*)header)+sizeof m_header, (char*)&m_header);
+}
+
 /// Returns offset of the next header (if there is any)
 off_t
 DgHeader::nextOffset() const
@@ -66,27 +80,33 @@ DgHeader::nextOffset() const
 
 /// Reads complete datagram into memory
 Dgram::ptr
-DgHeader::dgram()
+DgHeader::dgram(bool segmented)
 {
+  if (m_dgram) return m_dgram;
+
   const size_t headerSize = sizeof m_header;
   const uint32_t payloadSize = m_header.xtc.extent - sizeof m_header.xtc;
-  const uint32_t datagramSize = headerSize + payloadSize;
+  const size_t datagramSize = headerSize + payloadSize;
 
   // check datagram size, protection against corrupted headers
   MsgLog(logger, debug, "XTC extent size = " << m_header.xtc.extent);
   if (datagramSize > ::maxDgramSize) {
-    throw XTCSizeLimitException(ERR_LOC, m_file.path().path(), datagramSize, ::maxDgramSize);
+    if (not segmented) {
+      throw XTCSizeLimitException(ERR_LOC, m_file.path().path(), datagramSize, ::maxDgramSize);
+    }
+    // large datagram is read in pieces, pointer keeps them
+    MsgLog(logger, debug, "reading datagram of size " << datagramSize << " in segments, offset = " << m_off);
+    boost::shared_ptr<const SegmentedDgram> segments = segmentedDgram();
+    return segments ? SegmentedDgram::wrap(segments) : Dgram::ptr();
   }
 
-  // allocate memory for header+payload
-  Pds::Dgram* dg = (Pds::Dgram*)new char[datagramSize];
+  // allocate memory for header+payload, one allocation with the reference count
+  Dgram::ptr dgram = Dgram::allocate(datagramSize);
+  Pds::Dgram* dg = dgram.get();
 
   // copy header
   std::copy((const char*)&m_header, ((const char*)&m_header)+headerSize, (char*)dg);
 
-  // wrap into smart pointer so it gets deleted
-  Dgram::ptr dgram = Dgram::make_ptr(dg);
-
   // make sure that we are at correct location
   m_file.seek(m_off + headerSize, SEEK_SET);
 
@@ -103,4 +123,101 @@ DgHeader::dgram()
   return dgram;
 }
 
+/// Reads complete datagram into memory, one buffer per child XTC
+boost::shared_ptr<const SegmentedDgram>
+DgHeader::segmentedDgram()
+{
+  if (m_dgram) {
+    boost::shared_ptr<const SegmentedDgram> segments = SegmentedDgram::find(m_dgram);
+    if (segments) return segments;
+  }
+  checkExtent(not m_dgram);
+
+  const size_t headerSize = sizeof m_header;
+  const size_t payloadSize = m_header.xtc.extent - sizeof m_header.xtc;
+  boost::shared_ptr<SegmentedDgram> segments = boost::make_shared<SegmentedDgram>(m_header);
+
+  // datagram in memory already, children point into it
+  if (m_dgram) {
+    const char* payload = m_dgram->xtc.payload();
+    for (size_t pos = 0; pos != payloadSize; ) {
+      if (payloadSize - pos < sizeof(Pds::Xtc)) {
+        throw XTCExtentException(ERR_LOC, m_file.path().path(), m_off + headerSize + pos, payloadSize - pos);
+      }
+      const Pds::Xtc* child = (const Pds::Xtc*)(payload + pos);
+      if (child->extent < sizeof(Pds::Xtc) or child->extent > payloadSize - pos) {
+        throw XTCExtentException(ERR_LOC, m_file.path().path(), m_off + headerSize + pos, child->extent);
+      }
+      segments->push_back(SegmentedDgram::XtcPtr(m_dgram, child));
+      pos += child->extent;
+    }
+    return segments;
+  }
+
+  // make sure that we are at correct location
+  m_file.seek(m_off + headerSize, SEEK_SET);
+
+  for (size_t pos = 0; pos != payloadSize; ) {
+
+    // child header first, it gives the size of the buffer
+    Pds::Xtc xtc;
+    if (payloadSize - pos < sizeof xtc) {
+      throw XTCExtentException(ERR_LOC, m_file.path().path(), m_off + headerSize + pos, payloadSize - pos);
+    }
+    ssize_t nread = m_file.read((char*)&xtc, sizeof xtc);
+    if (nread < 0) {
+      throw XTCReadException(ERR_LOC, m_file.path().path());
+    } else if (nread != ssize_t(sizeof xtc)) {
+      break;
+    }
+    if (xtc.extent < sizeof xtc or xtc.extent > payloadSize - pos) {
+      throw XTCExtentException(ERR_LOC, m_file.path().path(), m_off + headerSize + pos, xtc.extent);
+    }
+    if (xtc.extent > ::maxDgramSize) {
+      throw XTCSizeLimitException(ERR_LOC, m_file.path().path(), xtc.extent, ::maxDgramSize);
+    }
+
+    // header and payload of the child in one buffer
+    boost::shared_ptr<char[]> buf = boost::make_shared_noinit<char[]>(xtc.extent);
+    std::copy((const char*)&xtc, ((const char*)&xtc)+sizeof xtc, buf.get());
+    const size_t childPayload = xtc.extent - sizeof xtc;
+    MsgLog(logger, debug, "reading child XTC, size = " << xtc.extent << ", offset = " << m_off + headerSize + pos);
+    nread = m_file.read(buf.get() + sizeof xtc, childPayload);
+    if (nread < 0) {
+      throw XTCReadException(ERR_LOC, m_file.path().path());
+    } else if (nread != ssize_t(childPayload)) {
+      break;
+    }
+
+    segments->push_back(SegmentedDgram::XtcPtr(buf, reinterpret_cast<const Pds::Xtc*>(buf.get())));
+    pos += xtc.extent;
+  }
+
+  if (not segments->complete()) {
+    MsgLog(logger, warning, "EOF while reading datagram payload from file: " << m_file.path());
+    return boost::shared_ptr<const SegmentedDgram>();
+  }
+  return segments;
+}
+
+// protection against corrupted headers before a segmented read
+void
+DgHeader::checkExtent(bool inFile)
+{
+  if (m_header.xtc.extent < sizeof m_header.xtc) {
+    throw XTCExtentException(ERR_LOC, m_file.path().path(), m_off, m_header.xtc.extent);
+  }
+
+  // children are read one by one, bogus extent must not make us read
+  // until EOF; size of a live file is not known until it is closed
+  if (inFile) {
+    const off_t fileSize = m_file.finalSize();
+    if (fileSize >= 0 and nextOffset() > fileSize) {
+      MsgLog(logger, error, "xtc.extent=" << m_header.xtc.extent << " goes past the end of file "
+             << m_file.path() << ", size " << fileSize << ", offset " << m_off);
+      throw XTCExtentException(ERR_LOC, m_file.path().path(), m_off, m_header.xtc.extent);
+    }
+  }
+}
+
 } // namespace XtcInput
@@ -19,6 +19,7 @@
 // C/C++ Headers --
 //-----------------
 #include <sstream>
+#include <boost/make_shared.hpp>
 
 //-------------------------------
 // Collaborating Class Headers --
@@ -52,6 +53,17 @@ Dgram::make_ptr(Pds::Dgram* dg)
   return ptr(dg, &Dgram::destroy);
 }
 
+/**
+ *  @brief Allocates memory for a datagram of given size (header + payload).
+ */
+Dgram::ptr
+Dgram::allocate(size_t size)
+{
+  // reference count lives in front of the buffer, aliasing pointer to the datagram
+  boost::shared_ptr<char[]> buf = boost::make_shared_noinit<char[]>(size);
+  return ptr(buf, reinterpret_cast<Pds::Dgram*>(buf.get()));
+}
+
 
 /**
  *  @brief Factory method which copies existing datagram and wraps new 
@@ -63,9 +75,9 @@ Dgram::copy(Pds::Dgram* dg)
   // make a copy
   char* dgbuf = (char*)dg ;
   size_t dgsize = sizeof(Pds::Dgram) + dg->xtc.sizeofPayload();
-  char* buf = new char[dgsize] ;
-  std::copy( dgbuf, dgbuf+dgsize, buf ) ;
-  return ptr((Pds::Dgram*)buf, &destroy);
+  ptr copy = allocate(dgsize) ;
+  std::copy( dgbuf, dgbuf+dgsize, (char*)copy.get() ) ;
+  return copy;
 }
 
 bool Dgram::operator< (const Dgram& other) const {
@@ -1,15 +1,51 @@
 #include "XtcInput/DgramList.h"
 
+#include <stdexcept>
+
 namespace XtcInput {
 
 void DgramList::push_back(const XtcInput::Dgram & dg) {
-  m_dgramList.push_back(dg.dg());
-  m_filenameList.push_back(dg.file());
-  m_offsetList.push_back(dg.offset());
+  push_back(Dgram(dg));
+}
+
+void DgramList::push_back(XtcInput::Dgram && dg) {
+  m_fileIds.push_back(dg.fileId());
+  m_offsets.push_back(dg.offset());
+  m_streams.push_back(dg.file().stream());
+  m_dgrams.push_back(dg.release());
+}
+
+Dgram DgramList::take(size_t i) {
+  Dgram::ptr dg;
+  dg.swap(m_dgrams[i]);
+  return Dgram(std::move(dg), m_fileIds[i], m_offsets[i]);
+}
+
+DgramList::FileListImpl DgramList::getFileNames() const {
+  const XtcFileTable& table = XtcFileTable::instance();
+  FileListImpl names;
+  names.reserve(m_fileIds.size());
+  for (unsigned i = 0; i != m_fileIds.size(); ++ i) names.push_back(table.name(m_fileIds[i]));
+  return names;
+}
+
+int DgramList::findStream(unsigned stream) const {
+  for (unsigned i = 0; i != m_streams.size(); ++ i) {
+    if (m_streams[i] == stream) return i;
+  }
+  return -1;
+}
+
+void DgramList::reserve(size_t n) {
+  m_dgrams.reserve(n);
+  m_fileIds.reserve(n);
+  m_offsets.reserve(n);
+  m_streams.reserve(n);
 }
 
 Dgram::ptr DgramList::frontDg() const {
-  return m_dgramList.at(0);
+  if (m_dgrams.empty()) throw std::out_of_range("DgramList::frontDg: empty list");
+  return m_dgrams.front();
 }
 
 } // namespace XtcInput
@@ -18,15 +18,97 @@
 //-----------------
 // C/C++ Headers --
 //-----------------
+#include <algorithm>
+#include <ctime>
+#include <stdint.h>
+#include <stdexcept>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <boost/thread/thread.hpp>
 
 //-------------------------------
 // Collaborating Class Headers --
 //-------------------------------
+#include "XtcInput/SegmentedDgram.h"
+#include "pdsdata/xtc/Dgram.hh"
 
 //-----------------------------------------------------------------------
 // Local Macros, Typedefs, Structures, Unions and Forward Declarations --
 //-----------------------------------------------------------------------
 
+namespace {
+
+  // number of checks before a waiting thread goes to sleep, spinning
+  // only delays the other thread if there is a single CPU
+  int spinCount()
+  {
+    static const int count = boost::thread::hardware_concurrency() > 1 ? 2000 : 0;
+    return count;
+  }
+
+  // sleeping thread wakes up this often to check for boost::thread::interrupt()
+  const long sleepNsec = 100000000;
+
+  inline void cpuRelax()
+  {
+#if defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#endif
+  }
+
+  // sleep while futex word has the given value, at most nsec nanoseconds
+  void futexWait(std::atomic<int>& word, int value, long nsec = sleepNsec)
+  {
+    struct timespec timeout = { 0, nsec };
+    syscall(SYS_futex, reinterpret_cast<int*>(&word), FUTEX_WAIT_PRIVATE, value, &timeout, 0, 0);
+  }
+
+  // change futex word and wake up the thread sleeping on it
+  void futexWake(std::atomic<int>& word)
+  {
+    word.fetch_add(1);
+    syscall(SYS_futex, reinterpret_cast<int*>(&word), FUTEX_WAKE_PRIVATE, 1, 0, 0, 0);
+  }
+
+  uint64_t monotonicNsec()
+  {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec)*1000000000 + ts.tv_nsec;
+  }
+
+  // size of datagram header and payload, segments of a segmented datagram
+  inline size_t dgramBytes(const XtcInput::Dgram& dg)
+  {
+    if (dg.empty()) return 0;
+    const size_t payload = dg.dg()->xtc.sizeofPayload();
+    if (payload == 0) {
+      boost::shared_ptr<const XtcInput::SegmentedDgram> segments = XtcInput::SegmentedDgram::find(dg.dg());
+      if (segments) return segments->bytes();
+    }
+    return sizeof(Pds::Dgram) + payload;
+  }
+
+  // fiducials of L1Accept datagram, same for all datagrams of one event
+  // (stream clocks differ), compared only for adjacent datagrams like in
+  // EventFanOut so the wrap-around does not matter
+  const uint64_t NoEvent = ~uint64_t(0);
+  inline uint64_t l1Key(const XtcInput::Dgram& dg)
+  {
+    if (dg.empty() or dg.dg()->seq.service() != Pds::TransitionId::L1Accept) return NoEvent;
+    return dg.dg()->seq.stamp().fiducials();
+  }
+
+  // smallest power of 2 not less than size
+  size_t ringSize(size_t size)
+  {
+    size_t n = 1;
+    while (n < size) n <<= 1;
+    return n;
+  }
+
+}
+
 //		----------------------------------------
 // 		-- Public Function Member Definitions --
 //		----------------------------------------
@@ -36,13 +118,32 @@ namespace XtcInput {
 //----------------
 // Constructors --
 //----------------
-DgramQueue::DgramQueue ( size_t maxSize )
-  : m_maxSize ( maxSize )
-  , m_queue()
+DgramQueue::DgramQueue ( size_t maxSize, size_t maxBytes, OverflowPolicy overflow )
+  : m_maxSize ( maxSize > 0 ? maxSize : 1 )
+  , m_maxBytes ( maxBytes )
+  , m_overflow ( overflow )
+  , m_mask ( ringSize(m_maxSize) - 1 )
+  , m_ring ( m_mask + 1 )
+  , m_head ( 0 )
+  , m_bytesOut ( 0 )
+  , m_cachedTail ( 0 )
+  , m_consumerBusy ( false )
+  , m_consumerWaiting ( 0 )
+  , m_tail ( 0 )
+  , m_cachedHead ( 0 )
+  , m_bytesIn ( 0 )
+  , m_cachedBytesOut ( 0 )
+  , m_peakBytes ( 0 )
+  , m_producerWaiting ( 0 )
+  , m_lastDropped ( NoEvent )
+  , m_dataSeq ( 0 )
+  , m_spaceSeq ( 0 )
+  , m_clearing ( false )
+  , m_hasException ( false )
+  , m_droppedEvents ( 0 )
+  , m_droppedDgrams ( 0 )
   , m_exception()
-  , m_mutex()
-  , m_condFull()
-  , m_condEmpty()
+  , m_exceptionMutex()
 {
 }
 
@@ -58,19 +159,78 @@ DgramQueue::~DgramQueue ()
 void
 DgramQueue::push (const value_type& dg)
 {
-  boost::mutex::scoped_lock qlock ( m_mutex ) ;
+  push(value_type(dg));
+}
 
-  // wait until we have an empty slot
-  while ( m_queue.size() >= m_maxSize ) {
-    m_condFull.wait( qlock ) ;
+// same as above, moves the datagram into the queue
+void
+DgramQueue::push (value_type&& dg)
+{
+  if (m_overflow == DropOldL1Accepts) {
+    if (restOfDropped(dg)) {
+      m_droppedDgrams.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    // dropped event is complete, its fiducials come again after a wrap-around
+    m_lastDropped = NoEvent;
   }
 
-  // store the packet
-  m_queue.push ( dg ) ;
+  const size_t bytes = dgramBytes(dg);
+  waitForSpace(1, bytes);
 
-  // tell anybody waiting for queue to become non-empty
-  m_condEmpty.notify_one () ;
+  // making space may have dropped the event of this datagram
+  if (m_overflow == DropOldL1Accepts and restOfDropped(dg)) {
+    m_droppedDgrams.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  m_ring[m_tail.load(std::memory_order_relaxed) & m_mask] = std::move(dg);
+  publish(1, bytes);
+}
 
+// add all datagrams of one event to the queue in one go, waits until
+// there is space for the whole event
+void
+DgramQueue::pushEvent (const DgramList& event)
+{
+  pushEvent(DgramList(event));
+}
+
+// same as above, moves the datagrams into the queue
+void
+DgramQueue::pushEvent (DgramList&& event)
+{
+  std::vector<value_type> batch;
+  batch.reserve(event.size());
+  for (unsigned i = 0; i != event.size(); ++ i) batch.push_back(event.take(i));
+  pushBatch(std::move(batch));
+}
+
+// add several datagrams to the queue in one go
+void
+DgramQueue::pushBatch (const std::vector<value_type>& dgs)
+{
+  pushBatch(std::vector<value_type>(dgs));
+}
+
+// same as above, moves the datagrams into the queue
+void
+DgramQueue::pushBatch (std::vector<value_type>&& dgs)
+{
+  size_t bytes = 0;
+  for (unsigned i = 0; i != dgs.size(); ++ i) bytes += dgramBytes(dgs[i]);
+
+  // batch which can never fit goes in parts
+  if (dgs.size() > m_maxSize or (m_maxBytes > 0 and bytes > m_maxBytes)) {
+    for (unsigned i = 0; i != dgs.size(); ++ i) push(std::move(dgs[i]));
+    return;
+  }
+  if (dgs.empty()) return;
+
+  // consumer sees all datagrams at once
+  waitForSpace(dgs.size(), bytes);
+  const size_t tail = m_tail.load(std::memory_order_relaxed);
+  for (unsigned i = 0; i != dgs.size(); ++ i) m_ring[(tail + i) & m_mask] = std::move(dgs[i]);
+  publish(dgs.size(), bytes);
 }
 
 // Producer thread may signal consumer thread that exception had
@@ -78,13 +238,14 @@ DgramQueue::push (const value_type& dg)
 void
 DgramQueue::push_exception (const std::string& msg)
 {
-  boost::mutex::scoped_lock qlock(m_mutex);
-
-  // store the message
-  m_exception = msg;
+  {
+    boost::mutex::scoped_lock elock(m_exceptionMutex);
+    m_exception = msg;
+    m_hasException.store(not msg.empty());
+  }
 
   // tell anybody waiting for new data
-  m_condEmpty.notify_one();
+  futexWake(m_dataSeq);
 }
 
 // get one datagram from the head of the queue, if the queue is
@@ -92,29 +253,24 @@ DgramQueue::push_exception (const std::string& msg)
 DgramQueue::value_type
 DgramQueue::pop()
 {
-  boost::mutex::scoped_lock qlock ( m_mutex ) ;
+  waitForData();
 
-  // wait until we have something in the queue
-  while (m_exception.empty() and m_queue.empty()) {
-
-    m_condEmpty.wait( qlock ) ;
-
-    // throw exception if non-empty, reset exception message
-    if (not m_exception.empty()) {
-      std::string msg;
-      msg.swap(m_exception);
-      throw std::runtime_error(msg);
-    }
-
-    if (not m_queue.empty()) break;
+  const size_t head = m_head.load(std::memory_order_relaxed);
+  if (head == m_cachedTail) {
+    m_consumerBusy.store(false, std::memory_order_release);
+    throwException();
   }
 
-  // get a packet
-  value_type p = m_queue.front() ;
-  m_queue.pop() ;
+  // get a packet, slot does not keep the datagram
+  value_type& slot = m_ring[head & m_mask];
+  value_type p = std::move(slot);
+  slot = value_type();
+  m_bytesOut.store(m_bytesOut.load(std::memory_order_relaxed) + dgramBytes(p), std::memory_order_relaxed);
+  m_head.store(head + 1);
+  m_consumerBusy.store(false, std::memory_order_release);
 
-  // tell anybody waiting for queue to become non-full
-  m_condFull.notify_one () ;
+  // tell producer if it waits for queue to become non-full
+  if (m_producerWaiting.exchange(0)) futexWake(m_spaceSeq);
 
   return p ;
 }
@@ -124,37 +280,282 @@ DgramQueue::pop()
 DgramQueue::value_type  
 DgramQueue::front() {
 
-  boost::mutex::scoped_lock qlock ( m_mutex ) ;
+  waitForData();
 
-  // wait until we have something in the queue
-  while (m_exception.empty() and m_queue.empty()) {
+  const size_t head = m_head.load(std::memory_order_relaxed);
+  if (head == m_cachedTail) {
+    m_consumerBusy.store(false, std::memory_order_release);
+    throwException();
+  }
 
-    m_condEmpty.wait( qlock ) ;
+  value_type p = m_ring[head & m_mask];
+  m_consumerBusy.store(false, std::memory_order_release);
+  return p;
+}
 
-    // throw exception if non-empty, reset exception message
-    if (not m_exception.empty()) {
-      std::string msg;
-      msg.swap(m_exception);
-      throw std::runtime_error(msg);
-    }
+// move up to maxN datagrams from the head of the queue into dgs
+size_t
+DgramQueue::popBatch (std::vector<value_type>& dgs, size_t maxN, int timeoutMs)
+{
+  dgs.clear();
+  if (maxN == 0) return 0;
+  if (not waitForData(timeoutMs)) return 0;
+
+  const size_t head = m_head.load(std::memory_order_relaxed);
+  if (head == m_cachedTail) {
+    m_consumerBusy.store(false, std::memory_order_release);
+    throwException();
+  }
 
-    if (not m_queue.empty()) break;
+  // take everything that is there now, up to maxN
+  m_cachedTail = m_tail.load(std::memory_order_acquire);
+  const size_t n = std::min(maxN, m_cachedTail - head);
+  dgs.reserve(n);
+  size_t bytes = 0;
+  for (size_t i = head; i != head + n; ++ i) {
+    value_type& slot = m_ring[i & m_mask];
+    bytes += dgramBytes(slot);
+    dgs.push_back(std::move(slot));
+    slot = value_type();
   }
+  m_bytesOut.store(m_bytesOut.load(std::memory_order_relaxed) + bytes, std::memory_order_relaxed);
+  m_head.store(head + n);
+  m_consumerBusy.store(false, std::memory_order_release);
+
+  // tell producer if it waits for queue to become non-full
+  if (m_producerWaiting.exchange(0)) futexWake(m_spaceSeq);
 
-  return m_queue.front();
+  return n;
+}
+
+// copy up to k datagrams from the head of the queue into window
+size_t
+DgramQueue::peek (std::vector<value_type>& window, size_t k)
+{
+  window.clear();
+  enterConsumer();
+  const size_t head = m_head.load(std::memory_order_acquire);
+  m_cachedTail = m_tail.load(std::memory_order_acquire);
+  const size_t n = std::min(k, m_cachedTail - head);
+  window.reserve(n);
+  for (size_t i = head; i != head + n; ++ i) window.push_back(m_ring[i & m_mask]);
+  m_consumerBusy.store(false, std::memory_order_release);
+  return n;
 }
 
 // completely erase all queue
 void 
 DgramQueue::clear()
 {
-  boost::mutex::scoped_lock qlock ( m_mutex ) ;
-
-  // erase everything
-  while (not m_queue.empty()) m_queue.pop() ;
+  // only one clear() at a time, consumer stays out until it is done
+  bool expected = false;
+  while (not m_clearing.compare_exchange_weak(expected, true)) {
+    expected = false;
+    cpuRelax();
+  }
+  while (m_consumerBusy.load()) cpuRelax();
+
+  // erase everything, producer does not touch slots before its tail
+  const size_t tail = m_tail.load(std::memory_order_acquire);
+  size_t bytes = 0;
+  for (size_t i = m_head.load(std::memory_order_relaxed); i != tail; ++ i) {
+    bytes += dgramBytes(m_ring[i & m_mask]);
+    m_ring[i & m_mask] = value_type();
+  }
+  m_bytesOut.store(m_bytesOut.load(std::memory_order_relaxed) + bytes, std::memory_order_relaxed);
+  m_head.store(tail);
+  m_cachedTail = tail;
+  m_clearing.store(false);
 
   // tell anybody waiting for queue to become non-full
-  m_condFull.notify_one () ;
+  futexWake(m_spaceSeq);
+}
+
+// total size of datagrams in the queue now
+size_t
+DgramQueue::bytes() const
+{
+  const uint64_t out = m_bytesOut.load(std::memory_order_acquire);
+  const uint64_t in = m_bytesIn.load(std::memory_order_acquire);
+  return in > out ? in - out : 0;
+}
+
+// producer: wait until there are n free slots and bytes fit
+void
+DgramQueue::waitForSpace (size_t n, size_t bytes)
+{
+  const size_t tail = m_tail.load(std::memory_order_relaxed);
+  if (hasSpace(tail, n, bytes)) return;
+
+  for (int spin = 0; ; ++ spin) {
+    // m_bytesOut is updated before m_head
+    m_cachedHead = m_head.load(std::memory_order_acquire);
+    m_cachedBytesOut = m_bytesOut.load(std::memory_order_relaxed);
+    if (hasSpace(tail, n, bytes)) return;
+    if (m_overflow == DropOldL1Accepts and dropOldL1Accepts(n, bytes)) continue;
+    if (spin < spinCount()) {
+      cpuRelax();
+      continue;
+    }
+
+    // sleep, consumer wakes us up if it sees the flag after freeing a slot
+    boost::this_thread::interruption_point();
+    const int seq = m_spaceSeq.load();
+    m_producerWaiting.store(1);
+    m_cachedHead = m_head.load();
+    m_cachedBytesOut = m_bytesOut.load(std::memory_order_relaxed);
+    if (not hasSpace(tail, n, bytes)) futexWait(m_spaceSeq, seq);
+    m_producerWaiting.store(0);
+  }
+}
+
+// producer: check for space with m_cachedHead and m_cachedBytesOut
+bool
+DgramQueue::hasSpace (size_t tail, size_t n, size_t bytes) const
+{
+  if (tail + n - m_cachedHead > m_maxSize) return false;
+  if (m_maxBytes == 0 or tail == m_cachedHead) return true;
+  return m_bytesIn.load(std::memory_order_relaxed) - m_cachedBytesOut + bytes <= m_maxBytes;
+}
+
+// producer: make n slots after the tail visible to the consumer
+void
+DgramQueue::publish (size_t n, size_t bytes)
+{
+  const uint64_t in = m_bytesIn.load(std::memory_order_relaxed) + bytes;
+  m_bytesIn.store(in, std::memory_order_relaxed);
+  const size_t current = in - m_bytesOut.load(std::memory_order_relaxed);
+  if (current > m_peakBytes.load(std::memory_order_relaxed)) m_peakBytes.store(current, std::memory_order_relaxed);
+
+  // store and load are not reordered, consumer which went to sleep
+  // before this store is seen as waiting
+  m_tail.store(m_tail.load(std::memory_order_relaxed) + n);
+  if (m_consumerWaiting.exchange(0)) futexWake(m_dataSeq);
+}
+
+// producer: drop oldest L1Accept events until n datagrams of given size fit
+bool
+DgramQueue::dropOldL1Accepts (size_t n, size_t bytes)
+{
+  // consumer stays out like for clear()
+  bool expected = false;
+  while (not m_clearing.compare_exchange_weak(expected, true)) {
+    expected = false;
+    cpuRelax();
+  }
+  while (m_consumerBusy.load()) cpuRelax();
+
+  const size_t head = m_head.load(std::memory_order_relaxed);
+  const size_t tail = m_tail.load(std::memory_order_relaxed);
+  const uint64_t queued = m_bytesIn.load(std::memory_order_relaxed) - m_bytesOut.load(std::memory_order_relaxed);
+
+  // L1Accepts before end are dropped, end is after the last datagram of an event
+  size_t nDrop = 0;
+  uint64_t dropBytes = 0;
+  uint64_t events = 0;
+  uint64_t event = m_lastDropped;
+  size_t end = head;
+  bool fits = false;
+  for (; ; ++ end) {
+    fits = tail + n - (head + nDrop) <= m_maxSize and
+      (m_maxBytes == 0 or nDrop == tail - head or queued - dropBytes + bytes <= m_maxBytes);
+    if (end == tail) break;
+    const uint64_t key = l1Key(m_ring[end & m_mask]);
+    if (fits and (key == NoEvent or key != event)) break;
+    if (key == NoEvent) continue;
+    if (key != event) ++ events;
+    event = key;
+    ++ nDrop;
+    dropBytes += dgramBytes(m_ring[end & m_mask]);
+  }
+
+  if (nDrop > 0) {
+    // transitions move towards the tail in their order, new head is after the dropped slots
+    size_t keep = end;
+    for (size_t i = end; i != head; ) {
+      -- i;
+      value_type& slot = m_ring[i & m_mask];
+      if (l1Key(slot) == NoEvent and -- keep != i) m_ring[keep & m_mask] = std::move(slot);
+    }
+    for (size_t i = head; i != keep; ++ i) m_ring[i & m_mask] = value_type();
+
+    m_bytesOut.store(m_bytesOut.load(std::memory_order_relaxed) + dropBytes, std::memory_order_relaxed);
+    m_head.store(keep);
+    m_cachedTail = tail;    // consumer's cached tail may be before the new head
+    m_lastDropped = event;
+    m_droppedEvents.fetch_add(events, std::memory_order_relaxed);
+    m_droppedDgrams.fetch_add(nDrop, std::memory_order_relaxed);
+  }
+  m_clearing.store(false);
+
+  return nDrop > 0 or fits;
+}
+
+// producer: true if dg belongs to the event which was dropped last
+bool
+DgramQueue::restOfDropped (const value_type& dg) const
+{
+  return m_lastDropped != NoEvent and l1Key(dg) == m_lastDropped;
+}
+
+// consumer: wait until the queue is not empty or there is an exception
+bool
+DgramQueue::waitForData (int timeoutMs)
+{
+  const uint64_t deadline = timeoutMs > 0 ? monotonicNsec() + uint64_t(timeoutMs)*1000000 : 0;
+  for (int spin = 0; ; ++ spin) {
+    enterConsumer();
+    const size_t head = m_head.load(std::memory_order_acquire);
+    if (head != m_cachedTail) return true;
+    m_cachedTail = m_tail.load(std::memory_order_acquire);
+    if (head != m_cachedTail or m_hasException.load()) return true;
+    m_consumerBusy.store(false, std::memory_order_release);
+
+    if (timeoutMs == 0) return false;
+    if (spin < spinCount()) {
+      cpuRelax();
+      continue;
+    }
+
+    long sleepFor = sleepNsec;
+    if (timeoutMs > 0) {
+      const uint64_t now = monotonicNsec();
+      if (now >= deadline) return false;
+      sleepFor = std::min(uint64_t(sleepFor), deadline - now);
+    }
+
+    // sleep, producer wakes us up if it sees the flag after adding data
+    boost::this_thread::interruption_point();
+    const int seq = m_dataSeq.load();
+    m_consumerWaiting.store(1);
+    if (m_tail.load() == m_head.load() and not m_hasException.load()) futexWait(m_dataSeq, seq, sleepFor);
+    m_consumerWaiting.store(0);
+  }
+}
+
+// consumer: set m_consumerBusy unless clear() is running
+void
+DgramQueue::enterConsumer ()
+{
+  while (true) {
+    m_consumerBusy.store(true);
+    if (not m_clearing.load()) return;
+    m_consumerBusy.store(false);
+    while (m_clearing.load()) cpuRelax();
+  }
+}
+
+// consumer: throw exception from push_exception(), reset exception message
+void
+DgramQueue::throwException ()
+{
+  std::string msg;
+  {
+    boost::mutex::scoped_lock elock(m_exceptionMutex);
+    msg.swap(m_exception);
+    m_hasException.store(false);
+  }
+  throw std::runtime_error(msg);
 }
 
 } // namespace XtcInput
@@ -20,6 +20,7 @@
 //-----------------
 #include <algorithm>
 #include <iterator>
+#include <boost/bind.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/regex.hpp>
 #include <boost/format.hpp>
@@ -35,6 +36,7 @@
 #include "XtcInput/DgramQueue.h"
 #include "XtcInput/RunFileIterList.h"
 #include "XtcInput/RunFileIterLive.h"
+#include "XtcInput/TaskScheduler.h"
 #include "XtcInput/XtcFileName.h"
 #include "XtcInput/XtcMergeIterator.h"
 #include "pdsdata/xtc/Dgram.hh"
@@ -49,6 +51,17 @@ namespace {
 
   const char* logger = "XtcInput.DgramReader";
 
+  // removes a memory gauge when the reading loop exits
+  class GaugeGuard : boost::noncopyable {
+  public:
+    GaugeGuard(XtcInput::MemoryGovernor& memory, XtcInput::MemoryGovernor::GaugeId id)
+      : m_memory(memory), m_id(id) {}
+    ~GaugeGuard() { m_memory.removeGauge(m_id); }
+  private:
+    XtcInput::MemoryGovernor& m_memory;
+    XtcInput::MemoryGovernor::GaugeId m_id;
+  };
+
   void splitIntoXtcFilesAndDatasets(const XtcInput::DgramReader::FileList &fileList,
                                     std::vector<XtcInput::XtcFileName> &files,
                                     std::vector<std::string> &datasets) {
@@ -125,6 +138,15 @@ DgramReader::~DgramReader ()
 void
 DgramReader::operator() ()
 try {
+  // buffers are allocated by the threads which read them: this thread and
+  // pool threads while they run tasks of this reader
+  boost::shared_ptr<const NumaPlacement> numa;
+  if (m_numa.active()) {
+    numa = boost::make_shared<NumaPlacement>(m_numa);
+    MsgLog(logger, info, "NUMA placement: " << m_numa);
+  }
+  TaskScheduler::PlacementScope placement(numa);
+
   std::vector<XtcFileName> filenames;
   std::vector<std::string> datasets;
   splitIntoXtcFilesAndDatasets(m_files, filenames, datasets);
@@ -198,15 +220,38 @@ try {
 
   void DgramReader::moveDgramsThroughQueue(boost::shared_ptr<RunFileIterI> runFileIter, bool liveMode) {
 
+  // all buffers of this reader and the queue share one budget
+  boost::shared_ptr<MemoryGovernor> memory = m_memory;
+  if (not memory) memory = boost::make_shared<MemoryGovernor>(MemoryGovernor::defaultBudget());
+  GaugeGuard queueGauge(*memory, memory->addGauge(MemoryGovernor::OutputQueue,
+                                                  boost::bind(&DgramQueue::bytes, &m_queue)));
+  if (memory->budget() > 0) {
+    MsgLog(logger, trace, "reader memory budget: " << memory->budget()/(1024*1024) << " MB");
+  }
+
   if (runFileIter) {
 
     XtcMergeIterator iter(runFileIter, m_l1OffsetSec, m_firstControlStream,
-                          m_maxStreamClockDiffSec, m_thirdEvent);
+                          m_maxStreamClockDiffSec, m_thirdEvent,
+                          XtcStreamMerger::PriorityQueueEngine, m_prefetchChunks,
+                          not liveMode, m_shard, m_cycleThreads,
+                          liveMode ? 0 : m_concurrentRuns, false, memory, m_segmentedDgrams);
     if (liveMode) {
       m_liveAvail = boost::make_shared<XtcInput::LiveAvail>(&iter);
     }
     Dgram dg;
-    while ( not boost::this_thread::interruption_requested() ) {
+    while ( m_eventBuilding and not boost::this_thread::interruption_requested() ) {
+
+      DgramList event = iter.nextEvent();
+
+      // stop if no more events
+      if (event.size() == 0) break;
+
+      // move all datagrams of this event to the queue
+      m_queue.pushEvent ( std::move(event) ) ;
+
+    }
+    while ( not m_eventBuilding and not boost::this_thread::interruption_requested() ) {
 
       dg = iter.next();
 
@@ -214,7 +259,7 @@ try {
       if (dg.empty()) break;
 
       // move it to the queue
-      m_queue.push ( dg ) ;
+      m_queue.push ( std::move(dg) ) ;
 
     }
 
@@ -224,6 +269,11 @@ try {
 
   }
   if (liveMode) m_liveAvail->mergerAboutToBeDestroyed();
+  MsgLog(logger, trace, "reader memory: " << *memory);
+  if (m_queue.droppedDgrams() > 0) {
+    MsgLog(logger, info, "output queue dropped " << m_queue.droppedEvents() << " L1Accept events ("
+           << m_queue.droppedDgrams() << " datagrams) to keep up with live data");
+  }
   // tell all we are done
   m_queue.push ( Dgram() ) ;
 }
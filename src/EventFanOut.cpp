@@ -0,0 +1,255 @@
+//--------------------------------------------------------------------------
+// File and Version Information:
+// 	$Id$
+//
+// Description:
+//	Class EventFanOut...
+//
+//------------------------------------------------------------------------
+
+//-----------------------
+// This Class's Header --
+//-----------------------
+#include "XtcInput/EventFanOut.h"
+
+//-----------------
+// C/C++ Headers --
+//-----------------
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+//-------------------------------
+// Collaborating Class Headers --
+//-------------------------------
+#include "MsgLogger/MsgLogger.h"
+#include "pdsdata/xtc/Dgram.hh"
+#include "pdsdata/xtc/TransitionId.hh"
+
+//-----------------------------------------------------------------------
+// Local Macros, Typedefs, Structures, Unions and Forward Declarations --
+//-----------------------------------------------------------------------
+
+namespace {
+
+  const char* logger = "XtcInput.EventFanOut";
+
+  // max. number of datagrams taken from DgramQueue at once
+  const size_t BatchSize = 64;
+
+  // datagrams from different streams which DgramReader puts next to each other
+  bool sameEvent(const XtcInput::Dgram& a, const XtcInput::Dgram& b)
+  {
+    const Pds::Sequence& seqa = a.dg()->seq;
+    const Pds::Sequence& seqb = b.dg()->seq;
+    if (seqa.service() != seqb.service()) return false;
+    if (seqa.service() != Pds::TransitionId::L1Accept) return true;
+    return seqa.stamp().fiducials() == seqb.stamp().fiducials();
+  }
+
+}
+
+//		----------------------------------------
+// 		-- Public Function Member Definitions --
+//		----------------------------------------
+
+namespace XtcInput {
+
+//----------------
+// Constructors --
+//----------------
+EventFanOut::EventFanOut(DgramQueue& queue, unsigned nWorkers, const Worker& worker, size_t maxQueued)
+  : m_queue(queue)
+  , m_nWorkers(std::max(nWorkers, 1U))
+  , m_worker(worker)
+  , m_maxQueued(maxQueued > 0 ? maxQueued : 2*m_nWorkers)
+  , m_batch()
+  , m_batchPos(0)
+  , m_events()
+  , m_busy(0)
+  , m_transition()
+  , m_transitionSeq(0)
+  , m_transitionCount(0)
+  , m_transitionLeft(0)
+  , m_done(false)
+  , m_error()
+  , m_mutex()
+  , m_condWork()
+  , m_condDispatch()
+{
+}
+
+//--------------
+// Destructor --
+//--------------
+EventFanOut::~EventFanOut()
+{
+}
+
+// process all events, returns number of events
+uint64_t
+EventFanOut::run()
+{
+  MsgLog(logger, trace, "starting " << m_nWorkers << " workers");
+  boost::thread_group workers;
+  for (unsigned i = 0; i != m_nWorkers; ++ i) {
+    workers.create_thread(boost::bind(&EventFanOut::work, this, i));
+  }
+
+  uint64_t seq = 0;
+  try {
+    while (true) {
+      DgramList event = nextEvent();
+      if (event.size() == 0) break;
+      if (event.frontDg()->seq.service() == Pds::TransitionId::L1Accept) {
+        dispatch(std::move(event), seq);
+      } else {
+        barrier(std::move(event), seq);
+      }
+      ++ seq;
+
+      boost::mutex::scoped_lock lock(m_mutex);
+      if (m_error) break;
+    }
+  } catch (...) {
+    boost::mutex::scoped_lock lock(m_mutex);
+    fail(std::current_exception());
+  }
+
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_done = true;
+    m_condWork.notify_all();
+  }
+  workers.join_all();
+
+  if (m_error) std::rethrow_exception(m_error);
+  return seq;
+}
+
+// read one event from the queue, empty list at the end of data
+DgramList
+EventFanOut::nextEvent()
+{
+  DgramList event;
+  const Dgram dg = std::move(nextDgram());
+  if (dg.empty()) {
+    -- m_batchPos;
+    return event;
+  }
+  event.push_back(dg);
+
+  // end of data stays in m_batch for the next call, datagrams of the
+  // event are moved out of it
+  while (true) {
+    Dgram& next = nextDgram();
+    if (next.empty() or not sameEvent(dg, next)) {
+      -- m_batchPos;
+      break;
+    }
+    event.push_back(std::move(next));
+  }
+  return event;
+}
+
+// next datagram from m_batch, refills it from the queue when it is used up
+Dgram&
+EventFanOut::nextDgram()
+{
+  if (m_batchPos == m_batch.size()) {
+    m_queue.popBatch(m_batch, BatchSize);
+    m_batchPos = 0;
+  }
+  return m_batch[m_batchPos ++];
+}
+
+// give event to one worker
+void
+EventFanOut::dispatch(DgramList&& event, uint64_t seq)
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  while (not m_error and m_events.size() >= m_maxQueued) m_condDispatch.wait(lock);
+  if (m_error) return;
+  m_events.push_back(std::make_pair(seq, std::move(event)));
+  m_condWork.notify_one();
+}
+
+// wait until all workers are idle and call all of them with the transition
+void
+EventFanOut::barrier(DgramList&& event, uint64_t seq)
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  while (not m_error and (not m_events.empty() or m_busy > 0)) m_condDispatch.wait(lock);
+  if (m_error) return;
+
+  m_transition = std::move(event);
+  m_transitionSeq = seq;
+  m_transitionLeft = m_nWorkers;
+  ++ m_transitionCount;
+  m_condWork.notify_all();
+
+  while (not m_error and m_transitionLeft > 0) m_condDispatch.wait(lock);
+  m_transition = DgramList();
+}
+
+// body of a worker thread
+void
+EventFanOut::work(unsigned worker)
+{
+  uint64_t transitions = 0;   // transitions processed by this worker
+
+  boost::mutex::scoped_lock lock(m_mutex);
+  while (true) {
+
+    while (not m_error and not m_done and m_events.empty() and m_transitionCount == transitions) {
+      m_condWork.wait(lock);
+    }
+    if (m_error) return;
+
+    bool transition = m_transitionCount != transitions;
+    DgramList event;
+    uint64_t seq;
+    if (transition) {
+      transitions = m_transitionCount;
+      event = m_transition;
+      seq = m_transitionSeq;
+    } else if (not m_events.empty()) {
+      event = std::move(m_events.front().second);
+      seq = m_events.front().first;
+      m_events.pop_front();
+      ++ m_busy;
+      m_condDispatch.notify_all();
+    } else {
+      // no more events
+      return;
+    }
+
+    lock.unlock();
+    try {
+      m_worker(event, seq, worker);
+    } catch (...) {
+      lock.lock();
+      fail(std::current_exception());
+      return;
+    }
+    lock.lock();
+
+    if (transition) {
+      -- m_transitionLeft;
+    } else {
+      -- m_busy;
+    }
+    m_condDispatch.notify_all();
+  }
+}
+
+// stop workers after an error, caller holds the lock
+void
+EventFanOut::fail(const std::exception_ptr& error)
+{
+  if (not m_error) m_error = error;
+  m_condWork.notify_all();
+  m_condDispatch.notify_all();
+}
+
+} // namespace XtcInput
@@ -0,0 +1,241 @@
+//--------------------------------------------------------------------------
+// File and Version Information:
+// 	$Id$
+//
+// Description:
+//	Class EventJoinTable...
+//
+//------------------------------------------------------------------------
+
+//-----------------------
+// This Class's Header --
+//-----------------------
+#include "XtcInput/EventJoinTable.h"
+
+//-----------------
+// C/C++ Headers --
+//-----------------
+#include <cmath>
+#include <limits>
+#include <boost/functional/hash.hpp>
+
+//-------------------------------
+// Collaborating Class Headers --
+//-------------------------------
+#include "MsgLogger/MsgLogger.h"
+#include "pdsdata/xtc/TimeStamp.hh"
+#include "pdsdata/xtc/TransitionId.hh"
+
+//-----------------------------------------------------------------------
+// Local Macros, Typedefs, Structures, Unions and Forward Declarations --
+//-----------------------------------------------------------------------
+
+namespace {
+
+  const char* logger = "XtcInput.EventJoinTable";
+
+  // fiducials run at 360Hz
+  const int64_t FiducialsPerSecond = 360;
+
+}
+
+//		----------------------------------------
+// 		-- Public Function Member Definitions --
+//		----------------------------------------
+
+namespace XtcInput {
+
+bool
+EventJoinTable::EventKey::operator<(const EventKey& o) const
+{
+  if (run != o.run) return run < o.run;
+  if (block != o.block) return block < o.block;
+  if (phase != o.phase) return phase < o.phase;
+  return id < o.id;
+}
+
+bool
+EventJoinTable::EventKey::operator==(const EventKey& o) const
+{
+  return run == o.run and block == o.block and phase == o.phase and id == o.id;
+}
+
+std::size_t
+hash_value(const EventJoinTable::EventKey& key)
+{
+  std::size_t seed = 0;
+  boost::hash_combine(seed, key.run);
+  boost::hash_combine(seed, key.block);
+  boost::hash_combine(seed, key.phase);
+  boost::hash_combine(seed, key.id);
+  return seed;
+}
+
+//----------------
+// Constructors --
+//----------------
+EventJoinTable::EventJoinTable()
+  : m_table()
+  , m_order()
+  , m_lastKey()
+  , m_started()
+  , m_done()
+  , m_haveRef(false)
+  , m_refSeconds(0)
+  , m_refId(0)
+  , m_haveEmitted(false)
+  , m_lastEmitted()
+{
+}
+
+// add a stream, returns its slot number
+unsigned
+EventJoinTable::addStream()
+{
+  m_lastKey.push_back(EventKey());
+  m_started.push_back(false);
+  m_done.push_back(false);
+  return m_lastKey.size() - 1;
+}
+
+// add non-empty datagram read from the stream in given slot
+void
+EventJoinTable::add(unsigned slot, const StreamDgram& dg)
+{
+  EventKey key = makeKey(dg);
+  if (m_started[slot] and key < m_lastKey[slot]) {
+    MsgLog(logger, warning, "datagram out of order in stream " << dg.streamId()
+           << ": " << StreamDgram::dumpStr(dg));
+  }
+  if (m_haveEmitted and not (m_lastEmitted < key)) {
+    MsgLog(logger, warning, "datagram arrived after its event was emitted: "
+           << StreamDgram::dumpStr(dg));
+  }
+  m_lastKey[slot] = key;
+  m_started[slot] = true;
+
+  Table::iterator it = m_table.find(key);
+  if (it == m_table.end()) {
+    it = m_table.insert(Table::value_type(key, DgramList())).first;
+    m_order.push(key);
+  }
+  it->second.push_back(dg);
+}
+
+// mark stream in given slot as finished
+void
+EventJoinTable::streamDone(unsigned slot)
+{
+  m_done[slot] = true;
+}
+
+// slot of unfinished stream with the smallest key, -1 if all streams are finished
+int
+EventJoinTable::laggard() const
+{
+  int slot = -1;
+  for (unsigned i = 0; i != m_lastKey.size(); ++ i) {
+    if (m_done[i]) continue;
+    if (not m_started[i]) return i;
+    if (slot < 0 or m_lastKey[i] < m_lastKey[slot]) slot = i;
+  }
+  return slot;
+}
+
+// true if the earliest pending event can be emitted
+bool
+EventJoinTable::ready() const
+{
+  if (m_order.empty()) return false;
+  EventKey mark;
+  if (not watermark(mark)) return true;
+  return not (mark < m_order.top());
+}
+
+// remove and return earliest pending event
+DgramList
+EventJoinTable::pop()
+{
+  DgramList event;
+  if (m_order.empty()) return event;
+  EventKey key = m_order.top();
+  m_order.pop();
+  Table::iterator it = m_table.find(key);
+  event = std::move(it->second);
+  m_table.erase(it);
+  m_lastEmitted = key;
+  m_haveEmitted = true;
+  return event;
+}
+
+// make key for a non-empty datagram
+EventJoinTable::EventKey
+EventJoinTable::makeKey(const StreamDgram& dg)
+{
+  const StreamDgram::MergeKey& mkey = dg.mergeKey();
+  EventKey key;
+  key.run = mkey.run;
+  key.block = mkey.block;
+  if (dg.isL1Accept()) {
+    key.phase = 1;
+    key.id = unwrapFiducials(mkey.seconds, mkey.fiducials);
+  } else {
+    key.phase = 0;
+    key.id = transitionRank(mkey.service);
+  }
+  return key;
+}
+
+// unwrap fiducials into a count which is continuous across the 17-bit wrap
+int64_t
+EventJoinTable::unwrapFiducials(uint32_t seconds, unsigned fiducials)
+{
+  const int64_t cycle = Pds::TimeStamp::MaxFiducials;
+  int64_t id = fiducials;
+  if (m_haveRef) {
+    // pick the wrap which puts fiducials closest to where the clock says they should be,
+    // reference moves with the data so slow drift of the 360Hz rate does not accumulate
+    int64_t expected = m_refId + (int64_t(seconds) - int64_t(m_refSeconds)) * FiducialsPerSecond;
+    int64_t wraps = int64_t(std::floor(double(expected - id) / cycle + 0.5));
+    id += wraps * cycle;
+  }
+  m_haveRef = true;
+  m_refSeconds = seconds;
+  m_refId = id;
+  return id;
+}
+
+// position of a transition in the L1Block, EndCalibCycle starts a new block
+int64_t
+EventJoinTable::transitionRank(unsigned service)
+{
+  switch (service) {
+  case Pds::TransitionId::Configure: return 0;
+  case Pds::TransitionId::BeginRun: return 1;
+  case Pds::TransitionId::EndCalibCycle: return 2;
+  case Pds::TransitionId::BeginCalibCycle: return 3;
+  case Pds::TransitionId::EndRun: return 4;
+  case Pds::TransitionId::Unconfigure: return 5;
+  default: return 6 + service;
+  }
+}
+
+// smallest key among the unfinished streams, false if all streams are finished
+bool
+EventJoinTable::watermark(EventKey& key) const
+{
+  int slot = laggard();
+  if (slot < 0) return false;
+  if (not m_started[slot]) {
+    // nothing is known about this stream yet, nothing can be emitted
+    key.run = 0;
+    key.block = std::numeric_limits<int64_t>::min();
+    key.phase = 0;
+    key.id = std::numeric_limits<int64_t>::min();
+    return true;
+  }
+  key = m_lastKey[slot];
+  return true;
+}
+
+} // namespace XtcInput
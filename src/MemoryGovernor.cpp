@@ -0,0 +1,206 @@
+//--------------------------------------------------------------------------
+// File and Version Information:
+// 	$Id$
+//
+// Description:
+//	Class MemoryGovernor...
+//
+//------------------------------------------------------------------------
+
+//-----------------------
+// This Class's Header --
+//-----------------------
+#include "XtcInput/MemoryGovernor.h"
+
+//-----------------
+// C/C++ Headers --
+//-----------------
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <cstdlib>
+
+//-------------------------------
+// Collaborating Class Headers --
+//-------------------------------
+
+//-----------------------------------------------------------------------
+// Local Macros, Typedefs, Structures, Unions and Forward Declarations --
+//-----------------------------------------------------------------------
+
+namespace {
+
+  const char* useNames[] = { "prefetch", "cycle buffers", "run buffers", "output queue" };
+
+  // cgroup v1 reports a huge number when there is no limit
+  const size_t noLimitV1 = size_t(1) << 60;
+
+}
+
+//		----------------------------------------
+// 		-- Public Function Member Definitions --
+//		----------------------------------------
+
+namespace XtcInput {
+
+// memory limit of the process cgroup (v2 or v1), 0 if there is no limit
+size_t
+MemoryGovernor::cgroupMemoryLimit()
+{
+  std::ifstream memoryMax("/sys/fs/cgroup/memory.max");
+  std::string limit;
+  if (memoryMax >> limit) {
+    if (limit == "max") return 0;
+    return std::strtoull(limit.c_str(), 0, 10);
+  }
+
+  std::ifstream limitFile("/sys/fs/cgroup/memory/memory.limit_in_bytes");
+  unsigned long long bytes = 0;
+  if (limitFile >> bytes and bytes < noLimitV1) return bytes;
+  return 0;
+}
+
+// budget used by DgramReader
+size_t
+MemoryGovernor::defaultBudget()
+{
+  // the rest is for the analysis code
+  return cgroupMemoryLimit() / 2;
+}
+
+//----------------
+// Constructors --
+//----------------
+MemoryGovernor::MemoryGovernor(size_t budget)
+  : m_budget(budget)
+  , m_reserved(0)
+  , m_peak(0)
+  , m_gaugeMutex()
+  , m_gauges()
+  , m_nextGaugeId(0)
+{
+  for (unsigned i = 0; i != NumUses; ++ i) m_used[i].store(0);
+}
+
+// count bytes kept in memory by a stage
+void
+MemoryGovernor::reserve(Use use, size_t bytes)
+{
+  m_used[use].fetch_add(bytes);
+  updatePeak(total(m_reserved.fetch_add(bytes) + bytes));
+}
+
+// return bytes counted by reserve()
+void
+MemoryGovernor::release(Use use, size_t bytes)
+{
+  m_used[use].fetch_sub(bytes);
+  m_reserved.fetch_sub(bytes);
+}
+
+// true if speculative read-ahead may continue
+bool
+MemoryGovernor::speculativeAllowed() const
+{
+  return m_budget == 0 or used() < m_budget / 4 * 3;
+}
+
+// buffer limit scaled by memory pressure
+size_t
+MemoryGovernor::scaleLimit(size_t wanted) const
+{
+  if (m_budget == 0) return wanted;
+
+  const size_t half = m_budget / 2;
+  const size_t now = used();
+  if (now <= half) return wanted;
+  if (now >= m_budget) return wanted / 8;
+
+  // linear from wanted at half of the budget to wanted/8 at the budget
+  const double fraction = double(now - half) / (m_budget - half);
+  return wanted - size_t((wanted - wanted / 8) * fraction);
+}
+
+// add memory which is counted by somebody else
+MemoryGovernor::GaugeId
+MemoryGovernor::addGauge(Use use, const Gauge& gauge)
+{
+  boost::mutex::scoped_lock lock(m_gaugeMutex);
+  GaugeEntry entry = { m_nextGaugeId ++, use, gauge };
+  m_gauges.push_back(entry);
+  return entry.id;
+}
+
+// remove gauge added by addGauge()
+void
+MemoryGovernor::removeGauge(GaugeId id)
+{
+  boost::mutex::scoped_lock lock(m_gaugeMutex);
+  for (std::vector<GaugeEntry>::iterator it = m_gauges.begin(); it != m_gauges.end(); ++ it) {
+    if (it->id == id) {
+      m_gauges.erase(it);
+      break;
+    }
+  }
+}
+
+// total bytes now, including gauges
+size_t
+MemoryGovernor::used() const
+{
+  return total(m_reserved.load());
+}
+
+// bytes of one stage now
+size_t
+MemoryGovernor::used(Use use) const
+{
+  size_t bytes = m_used[use].load();
+  boost::mutex::scoped_lock lock(m_gaugeMutex);
+  for (unsigned i = 0; i != m_gauges.size(); ++ i) {
+    if (m_gauges[i].use == use) bytes += m_gauges[i].gauge();
+  }
+  return bytes;
+}
+
+// print usage of all stages
+void
+MemoryGovernor::print(std::ostream& out) const
+{
+  const double MB = 1024.*1024.;
+  out << "used " << used()/MB << " MB";
+  if (m_budget > 0) out << " of " << m_budget/MB << " MB";
+  out << ", peak " << peak()/MB << " MB (";
+  for (unsigned i = 0; i != NumUses; ++ i) {
+    if (i > 0) out << ", ";
+    out << useNames[i] << " " << used(Use(i))/MB << " MB";
+  }
+  out << ")";
+}
+
+// total of reserved bytes and gauges
+size_t
+MemoryGovernor::total(size_t reserved) const
+{
+  boost::mutex::scoped_lock lock(m_gaugeMutex);
+  for (unsigned i = 0; i != m_gauges.size(); ++ i) reserved += m_gauges[i].gauge();
+  return reserved;
+}
+
+// update peak with total
+void
+MemoryGovernor::updatePeak(size_t total)
+{
+  size_t peak = m_peak.load(std::memory_order_relaxed);
+  while (total > peak and not m_peak.compare_exchange_weak(peak, total, std::memory_order_relaxed)) {}
+}
+
+// insertion operator for MemoryGovernor usage
+std::ostream&
+operator<<(std::ostream& out, const MemoryGovernor& memory)
+{
+  memory.print(out);
+  return out;
+}
+
+} // namespace XtcInput
@@ -0,0 +1,261 @@
+//--------------------------------------------------------------------------
+// File and Version Information:
+// 	$Id$
+//
+// Description:
+//	Class NumaPlacement...
+//
+//------------------------------------------------------------------------
+
+//-----------------------
+// This Class's Header --
+//-----------------------
+#include "XtcInput/NumaPlacement.h"
+
+//-----------------
+// C/C++ Headers --
+//-----------------
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#include <boost/lexical_cast.hpp>
+
+//-------------------------------
+// Collaborating Class Headers --
+//-------------------------------
+#include "MsgLogger/MsgLogger.h"
+#include "XtcInput/Exceptions.h"
+
+//-----------------------------------------------------------------------
+// Local Macros, Typedefs, Structures, Unions and Forward Declarations --
+//-----------------------------------------------------------------------
+
+namespace {
+
+  const char* logger = "XtcInput.NumaPlacement";
+
+  const char* nodeDir = "/sys/devices/system/node";
+
+  // size of node mask given to set_mempolicy
+  const unsigned MaxNodes = 1024;   // also size of the mask in NumaPlacement::Scope
+  const unsigned MaskBits = sizeof(unsigned long) * CHAR_BIT;
+
+  // first line of a sysfs file, empty if it cannot be read
+  std::string readLine(const std::string& path)
+  {
+    std::ifstream in(path.c_str());
+    std::string line;
+    std::getline(in, line);
+    return line;
+  }
+
+  // set memory policy of the calling thread, mask has MaxNodes bits
+  bool setMemPolicy(int mode, const unsigned long* mask)
+  {
+    // kernel ignores the last bit of maxnode
+    return syscall(SYS_set_mempolicy, mode, mask, (unsigned long)(MaxNodes + 1)) == 0;
+  }
+
+  // set memory policy of the calling thread for the given nodes
+  bool setMemPolicy(int mode, const std::vector<unsigned>& nodes)
+  {
+    unsigned long mask[MaxNodes / MaskBits] = { 0 };
+    for (std::vector<unsigned>::const_iterator it = nodes.begin(); it != nodes.end(); ++ it) {
+      if (*it < MaxNodes) mask[*it / MaskBits] |= 1UL << (*it % MaskBits);
+    }
+    return setMemPolicy(mode, mask);
+  }
+
+}
+
+//		----------------------------------------
+// 		-- Public Function Member Definitions --
+//		----------------------------------------
+
+namespace XtcInput {
+
+// make policy from string
+NumaPlacement::Policy
+NumaPlacement::policy(const std::string& str)
+{
+  if (str == "none") {
+    return None;
+  } else if (str == "consumer") {
+    return ConsumerNode;
+  } else if (str == "interleave") {
+    return Interleave;
+  } else {
+    throw ArgumentException(ERR_LOC, "NumaPlacement: unknown policy \"" + str +
+                            "\", expect none, consumer or interleave");
+  }
+}
+
+// parse list like "0-3,8-11"
+std::vector<unsigned>
+NumaPlacement::parseList(const std::string& str)
+{
+  std::vector<unsigned> result;
+  std::istringstream in(str);
+  std::string range;
+  while (std::getline(in, range, ',')) {
+    char* end = 0;
+    const unsigned long first = std::strtoul(range.c_str(), &end, 10);
+    if (end == range.c_str()) continue;
+    unsigned long last = first;
+    if (*end == '-') {
+      const char* begin = end + 1;
+      last = std::strtoul(begin, &end, 10);
+      if (end == begin or last < first) continue;
+    }
+    for (unsigned long i = first; i <= last; ++ i) result.push_back(i);
+  }
+  return result;
+}
+
+// number of online nodes
+unsigned
+NumaPlacement::numNodes()
+{
+  const std::vector<unsigned> nodes = parseList(readLine(std::string(nodeDir) + "/online"));
+  return nodes.empty() ? 1 : nodes.size();
+}
+
+// CPUs of a node
+std::vector<unsigned>
+NumaPlacement::nodeCpus(unsigned node)
+{
+  return parseList(readLine(std::string(nodeDir) + "/node" +
+                            boost::lexical_cast<std::string>(node) + "/cpulist"));
+}
+
+// node of the calling thread
+int
+NumaPlacement::currentNode()
+{
+  unsigned cpu = 0, node = 0;
+  if (syscall(SYS_getcpu, &cpu, &node, 0) != 0) return -1;
+  return node;
+}
+
+//----------------
+// Constructors --
+//----------------
+NumaPlacement::NumaPlacement(Policy policy, int node)
+  : m_policy(policy)
+  , m_node(node < 0 ? currentNode() : node)
+  , m_active(policy != None and numNodes() > 1)
+  , m_cpus()
+{
+  // read once, placement may be applied for every task
+  if (m_active and m_policy == ConsumerNode and m_node >= 0) m_cpus = nodeCpus(m_node);
+}
+
+// apply the policy to the calling thread
+bool
+NumaPlacement::applyToThread() const
+{
+  if (not active()) return true;
+
+  if (m_policy == Interleave) {
+    const std::vector<unsigned> nodes = parseList(readLine(std::string(nodeDir) + "/online"));
+    if (not setMemPolicy(MPOL_INTERLEAVE, nodes)) {
+      MsgLog(logger, warning, "failed to interleave memory: " << strerror(errno));
+      return false;
+    }
+    return true;
+  }
+
+  // ConsumerNode: run on CPUs of the node which are allowed for this thread
+  cpu_set_t allowed;
+  cpu_set_t cpuSet;
+  CPU_ZERO(&cpuSet);
+  if (sched_getaffinity(0, sizeof allowed, &allowed) == 0) {
+    for (std::vector<unsigned>::const_iterator it = m_cpus.begin(); it != m_cpus.end(); ++ it) {
+      if (*it < CPU_SETSIZE and CPU_ISSET(*it, &allowed)) CPU_SET(*it, &cpuSet);
+    }
+  }
+  if (CPU_COUNT(&cpuSet) == 0) {
+    MsgLog(logger, warning, "no usable CPUs on node " << m_node << ", thread is not pinned");
+    return false;
+  }
+  if (sched_setaffinity(0, sizeof cpuSet, &cpuSet) != 0) {
+    MsgLog(logger, warning, "failed to pin thread to node " << m_node << ": " << strerror(errno));
+    return false;
+  }
+
+  // memory from the consumer's node, other nodes when it is full
+  if (not setMemPolicy(MPOL_PREFERRED, std::vector<unsigned>(1, m_node))) {
+    MsgLog(logger, warning, "failed to set memory policy for node " << m_node << ": " << strerror(errno));
+    return false;
+  }
+  return true;
+}
+
+// save thread placement and apply the given one
+NumaPlacement::Scope::Scope(const NumaPlacement* placement)
+  : m_restoreAffinity(false)
+  , m_restorePolicy(false)
+  , m_mode(0)
+{
+  if (not placement or not placement->active()) return;
+
+  m_restoreAffinity = placement->policy() == ConsumerNode and
+      sched_getaffinity(0, sizeof m_affinity, &m_affinity) == 0;
+  m_restorePolicy = syscall(SYS_get_mempolicy, &m_mode, m_nodeMask, (unsigned long)MaxNodes, 0, 0) == 0;
+  placement->applyToThread();
+}
+
+// restore thread placement
+NumaPlacement::Scope::~Scope()
+{
+  if (m_restoreAffinity and sched_setaffinity(0, sizeof m_affinity, &m_affinity) != 0) {
+    MsgLog(logger, warning, "failed to restore thread affinity: " << strerror(errno));
+  }
+  if (m_restorePolicy and not setMemPolicy(m_mode, m_nodeMask)) {
+    MsgLog(logger, warning, "failed to restore memory policy: " << strerror(errno));
+  }
+}
+
+// print policy and nodes
+void
+NumaPlacement::print(std::ostream& out) const
+{
+  out << m_policy;
+  if (m_policy == ConsumerNode) out << " (node " << m_node << ")";
+  out << ", " << numNodes() << " node(s)";
+}
+
+std::ostream&
+operator<<(std::ostream& out, NumaPlacement::Policy policy)
+{
+  const char* str = "*ERROR*";
+  switch(policy) {
+  case NumaPlacement::None:
+    str = "none";
+    break;
+  case NumaPlacement::ConsumerNode:
+    str = "consumer";
+    break;
+  case NumaPlacement::Interleave:
+    str = "interleave";
+    break;
+  }
+  return out << str;
+}
+
+std::ostream&
+operator<<(std::ostream& out, const NumaPlacement& placement)
+{
+  placement.print(out);
+  return out;
+}
+
+} // namespace XtcInput
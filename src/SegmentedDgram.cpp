@@ -0,0 +1,97 @@
+//--------------------------------------------------------------------------
+// File and Version Information:
+// 	$Id$
+//
+// Description:
+//	Class SegmentedDgram...
+//
+//------------------------------------------------------------------------
+
+//-----------------------
+// This Class's Header --
+//-----------------------
+#include "XtcInput/SegmentedDgram.h"
+
+//-----------------
+// C/C++ Headers --
+//-----------------
+#include <algorithm>
+
+//-------------------------------
+// Collaborating Class Headers --
+//-------------------------------
+
+//-----------------------------------------------------------------------
+// Local Macros, Typedefs, Structures, Unions and Forward Declarations --
+//-----------------------------------------------------------------------
+
+namespace {
+
+  // deleter of the header-only datagram, keeps segments alive
+  struct SegmentOwner {
+    explicit SegmentOwner(const boost::shared_ptr<const XtcInput::SegmentedDgram>& dg) : segments(dg) {}
+    void operator()(Pds::Dgram* dg) const { delete [] (char*)dg; }
+    boost::shared_ptr<const XtcInput::SegmentedDgram> segments;
+  };
+
+}
+
+//		----------------------------------------
+// 		-- Public Function Member Definitions --
+//		----------------------------------------
+
+namespace XtcInput {
+
+// segments of a datagram made by wrap()
+boost::shared_ptr<const SegmentedDgram>
+SegmentedDgram::find(const Dgram::ptr& dg)
+{
+  const SegmentOwner* owner = boost::get_deleter<SegmentOwner>(dg);
+  return owner ? owner->segments : boost::shared_ptr<const SegmentedDgram>();
+}
+
+// make datagram pointer without payload which owns segments
+Dgram::ptr
+SegmentedDgram::wrap(const boost::shared_ptr<const SegmentedDgram>& dg)
+{
+  char* buf = new char[sizeof(Pds::Dgram)];
+  const Pds::Dgram& header = dg->header();
+  std::copy((const char*)&header, ((const char*)&header)+sizeof header, buf);
+  Pds::Dgram* stub = (Pds::Dgram*)buf;
+  stub->xtc.extent = sizeof(Pds::Xtc);
+  return Dgram::ptr(stub, SegmentOwner(dg));
+}
+
+//----------------
+// Constructors --
+//----------------
+SegmentedDgram::SegmentedDgram(const Pds::Dgram& header)
+  : m_header()
+  , m_children()
+  , m_payloadSize(0)
+{
+  std::copy((const char*)&header, ((const char*)&header)+sizeof header, (char*)&m_header);
+}
+
+// add next child XTC
+void
+SegmentedDgram::push_back(const XtcPtr& child)
+{
+  m_children.push_back(child);
+  m_payloadSize += child->extent;
+}
+
+// copy into one contiguous datagram
+Dgram::ptr
+SegmentedDgram::contiguous() const
+{
+  Dgram::ptr dg = Dgram::allocate(bytes());
+  char* out = std::copy((const char*)&m_header, ((const char*)&m_header)+sizeof m_header, (char*)dg.get());
+  for (const_iterator it = begin(); it != end(); ++ it) {
+    out = std::copy((const char*)it->get(), ((const char*)it->get())+(*it)->extent, out);
+  }
+  dg->xtc.extent = sizeof(Pds::Xtc) + m_payloadSize;
+  return dg;
+}
+
+} // namespace XtcInput
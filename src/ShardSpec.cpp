@@ -0,0 +1,62 @@
+//--------------------------------------------------------------------------
+// File and Version Information:
+// 	$Id$
+//
+// Description:
+//	Class ShardSpec...
+//
+//------------------------------------------------------------------------
+
+//-----------------------
+// This Class's Header --
+//-----------------------
+#include "XtcInput/ShardSpec.h"
+
+//-----------------
+// C/C++ Headers --
+//-----------------
+#include <iostream>
+#include <boost/lexical_cast.hpp>
+
+//-------------------------------
+// Collaborating Class Headers --
+//-------------------------------
+#include "XtcInput/Exceptions.h"
+
+//		----------------------------------------
+// 		-- Public Function Member Definitions --
+//		----------------------------------------
+
+namespace XtcInput {
+
+//----------------
+// Constructors --
+//----------------
+ShardSpec::ShardSpec(unsigned rank, unsigned size, Mode mode, unsigned blockSize)
+  : m_rank(rank)
+  , m_size(size)
+  , m_mode(mode)
+  , m_blockSize(blockSize)
+{
+  if (m_rank >= m_size) {
+    throw ArgumentException(ERR_LOC, "ShardSpec: rank " + boost::lexical_cast<std::string>(m_rank) +
+                            " is not below size " + boost::lexical_cast<std::string>(m_size));
+  }
+  if (m_blockSize == 0) {
+    throw ArgumentException(ERR_LOC, "ShardSpec: block size is zero");
+  }
+}
+
+std::ostream&
+operator<<(std::ostream& out, const ShardSpec& shard)
+{
+  out << shard.rank() << '/' << shard.size();
+  if (shard.mode() == ShardSpec::ByCalibCycle) {
+    out << " by calib cycle";
+  } else {
+    out << " by blocks of " << shard.blockSize() << " fiducials";
+  }
+  return out;
+}
+
+} // namespace XtcInput
@@ -68,6 +68,7 @@ namespace XtcInput {
 SharedFile::SharedFileImpl::SharedFileImpl (const XtcFileName& argPath,
     unsigned argLiveTimeout)
   : path(argPath)
+  , fileId(XtcFileTable::EmptyId)
   , liveTimeout(argLiveTimeout)
   , fd(-1)
   , lastFileLength(-1)
@@ -90,6 +91,8 @@ SharedFile::SharedFileImpl::SharedFileImpl (const XtcFileName& argPath,
     MsgLog( logger, error, "failed to open input XTC file: " << path );
     throw FileOpenException(ERR_LOC, path.path()) ;
   } else {
+    // datagrams from this file refer to the name by id
+    fileId = XtcFileTable::instance().intern(path);
     lastFileLength = getFileLength(fd);
     MsgLog( logger, trace, "opened input XTC file: " << path << " fd=" << fd 
             << " initial size from fstat: " << lastFileLength);
@@ -195,6 +198,43 @@ SharedFile::read(char* buf, size_t size)
   return size-left;
 }
 
+// true if size bytes starting at offset can be read without waiting for live data
+bool
+SharedFile::ready(off_t offset, size_t size)
+{
+  if (not m_impl->liveTimeout) return true;
+
+  off_t end = offset + off_t(size);
+  if (m_impl->lastFileLength < end) m_impl->lastFileLength = getFileLength(m_impl->fd);
+  if (m_impl->lastFileLength >= end) return true;
+
+  // file that was closed by the writer does not grow, read will return immediately
+  struct stat statFinal;
+  return writerDone(statFinal);
+}
+
+// read size bytes at given offset if they are already in the file, does not wait
+ssize_t
+SharedFile::peek(char* buf, size_t size, off_t offset)
+{
+  if (not ready(offset, size)) return 0;
+  ssize_t nread = 0;
+  do {
+    nread = ::pread(m_impl->fd, buf, size, offset);
+  } while (nread < 0 and errno == EINTR);
+  return nread;
+}
+
+// size of the file if it does not grow any more, negative otherwise
+off_t
+SharedFile::finalSize()
+{
+  if (not m_impl->liveTimeout) return getFileLength(m_impl->fd);
+  struct stat statFinal;
+  if (writerDone(statFinal)) return statFinal.st_size;
+  return -1;
+}
+
 // check that we reached EOF while reading live data
 bool
 SharedFile::eof()
@@ -203,6 +243,22 @@ SharedFile::eof()
   // name, but is still the same file (same inode) and it's size is
   // exactly the same as the current offset.
 
+  struct stat statFinal;
+  if (not writerDone(statFinal)) return false;
+
+  // check current position
+  off_t offset = ::lseek(m_impl->fd, 0, SEEK_CUR);
+  if (offset == (off_t)-1) {
+    MsgLog(logger, error, "error returned from lseek: " << errno << " -- " << strerror(errno));
+    return false;
+  }
+  return offset == statFinal.st_size;
+}
+
+// check that live file has been renamed to its final name, fills stat of the final file
+bool
+SharedFile::writerDone(struct stat& statFinal)
+{
   // strip file extension
   std::string path = m_impl->path.path();
   std::string::size_type p = path.rfind('.');
@@ -214,23 +270,11 @@ SharedFile::eof()
   const std::string pathFinal(path, 0, p);
 
   // check final file, get its info
-  struct stat statFinal;
   if (::stat(pathFinal.c_str(), &statFinal) < 0) {
     // no such file, means no EOF yet
     return false;
   }
 
-  // check current position
-  off_t offset = ::lseek(m_impl->fd, 0, SEEK_CUR);
-  if (offset == (off_t)-1) {
-    MsgLog(logger, error, "error returned from lseek: " << errno << " -- " << strerror(errno));
-    return false;
-  }
-  if (offset != statFinal.st_size) {
-    // final has size different from our current position
-    return false;
-  }
-
   // info for current file
   struct stat statCurrent;
   if (::fstat(m_impl->fd, &statCurrent) < 0) {
@@ -51,92 +51,75 @@ std::string StreamDgram::dumpStr(const StreamDgram & dg) {
   return msg.str();
 }
 
-StreamDgramGreater::StreamDgramGreater(unsigned maxClockDriftSeconds) 
-  : m_fidCompare(maxClockDriftSeconds) {
-  DgramCategory LD(L1Accept, StreamDgram::DAQ);
-  DgramCategory LC(L1Accept, StreamDgram::controlUnderDAQ);
-  DgramCategory LI(L1Accept, StreamDgram::controlIndependent);
-  DgramCategory TD(otherTrans, StreamDgram::DAQ);
-  DgramCategory TC(otherTrans, StreamDgram::controlUnderDAQ);
-  DgramCategory TI(otherTrans, StreamDgram::controlIndependent);
-
-  /* -------------------------------------------------------------------
-     Below we encode the 21 cases for comparing the 6 Dgram catagorires (LD, LC, LI, TD, TC, TI) 
-     defined above, against one another (there are 36 pairs from these 6 categories, but the
-     compare method does not depend on the order of the pair: TD vs TI is the same as TI vs TD.
-
-     The 21 cases cover all combinations we may see when merging dgrams from streams. 
-     Issues that go into the merging rules:
-     *  There may be multiple C streams (s80, s81)
-     *  Not all L1Accepts in a C stream will have a matching L1Accept in the DAQ stream. 
-     *  We do not want to throw away L1Accepts from the s80, if they do not match a 
-        DAQ stream, we want to order them correctly.
-     *  Comparing a C stream L1 accept against D or C stream Transitions requires history.
-        The clocks are different and fiducials in both are not available. The C stream
-        L1 accept need not have a matching L1 in the Daq stream. This is when the block number 
-        is used.
-     *  Comparing a DAQ L1 accept against a DAQ Transition also requires history. We are not
-        guaranteed that the clock for an L1 accept following a DAQ transition has a later time
-        than the clock for the transition. This is most always the case, but there has been 
-        data where it is not true. We assume that all L1 accepts before the transition 
-        should appear earlier, and likewise all L1 accepts after should appear after. The
-        block is used in these cases.
-     *  At this point, the C and I streams are not supposed to have anything useful in their
-        Transition dgrams (other than the Configure transition). 
-     *  We cannot compare anything from independent streams. One the one hand, a LD vs. an LI is
-        fiducials based, but we first check the run and L1Block count. Before we compare anything
-        from an independent stream, we need a process that assigns L1Block numbers to Dgrams from
-        the Independent streams that are synchronized with those of the DAQ/Control streams. 
-        Hence all comparisions involving a TI or LI (even against themselves) are presently marked
-        badGreater.
-     ------------------------------------------------------------------- */
-  m_LUT[makeDgramCategoryAB(LD,LD)] = fidGreater;
-  m_LUT[makeDgramCategoryAB(LD,LC)] = fidGreater;
-  m_LUT[makeDgramCategoryAB(LD,LI)] = badGreater;
-  m_LUT[makeDgramCategoryAB(LD,TD)] = blockGreater;
-  m_LUT[makeDgramCategoryAB(LD,TC)] = blockGreater;
-  m_LUT[makeDgramCategoryAB(LD,TI)] = badGreater; 
-
-  m_LUT[makeDgramCategoryAB(LC,LC)] = fidGreater;
-  m_LUT[makeDgramCategoryAB(LC,LI)] = badGreater;
-  m_LUT[makeDgramCategoryAB(LC,TD)] = blockGreater;
-  m_LUT[makeDgramCategoryAB(LC,TC)] = blockGreater;
-  m_LUT[makeDgramCategoryAB(LC,TI)] = badGreater; 
-
-  m_LUT[makeDgramCategoryAB(LI,LI)] = badGreater;
-  m_LUT[makeDgramCategoryAB(LI,TD)] = badGreater;
-  m_LUT[makeDgramCategoryAB(LI,TC)] = badGreater;
-  m_LUT[makeDgramCategoryAB(LI,TI)] = badGreater;
-
-  m_LUT[makeDgramCategoryAB(TD,TD)] = clockGreater;
-  m_LUT[makeDgramCategoryAB(TD,TC)] = clockGreater;
-  m_LUT[makeDgramCategoryAB(TD,TI)] = badGreater;
-
-  m_LUT[makeDgramCategoryAB(TC,TC)] = clockGreater;
-  m_LUT[makeDgramCategoryAB(TC,TI)] = badGreater;
-
-  m_LUT[makeDgramCategoryAB(TI,TI)] = badGreater;
+StreamDgram::MergeKey StreamDgram::makeMergeKey(const Dgram &dgram, StreamType streamType, int64_t L1block) {
+  MergeKey key;
+  key.run = 0;
+  key.block = L1block;
+  key.category = 0;
+  key.service = Pds::TransitionId::Unknown;
+  key.clock = 0;
+  key.seconds = 0;
+  key.fiducials = 0;
+  if (dgram.empty()) return key;
+
+  const Pds::Sequence & seq = dgram.dg()->seq;
+  key.run = dgram.file().run();
+  key.category = unsigned(streamType);
+  if (seq.service() != Pds::TransitionId::L1Accept) key.category += NumStreamTypes;
+  key.service = seq.service();
+  key.clock = (uint64_t(seq.clock().seconds()) << 32) | seq.clock().nanoseconds();
+  key.seconds = seq.clock().seconds();
+  key.fiducials = seq.stamp().fiducials();
+  return key;
 }
-  
-StreamDgramGreater::DgramCategory StreamDgramGreater::getDgramCategory(const StreamDgram &dg) {
-  if (dg.empty()) {
-    MsgLog(logger, warning, "getDgramCategory called on empty dgram");
-    return StreamDgramGreater::DgramCategory(L1Accept, StreamDgram::DAQ);
-  }
 
-  TransitionType trans;
-  if (dg.dg()->seq.service() == Pds::TransitionId::L1Accept) {
-    trans = L1Accept;
-  } else {
-    trans = otherTrans;
-  }
-  return StreamDgramGreater::DgramCategory(trans, dg.streamType());
-}
+/* -------------------------------------------------------------------
+   Below we encode the 21 cases for comparing the 6 Dgram catagorires (LD, LC, LI, TD, TC, TI) 
+   against one another (there are 36 pairs from these 6 categories, but the
+   compare method does not depend on the order of the pair: TD vs TI is the same as TI vs TD,
+   so the table is symmetric). The row and column index is StreamDgram::MergeKey::category.
+
+   The 21 cases cover all combinations we may see when merging dgrams from streams. 
+   Issues that go into the merging rules:
+   *  There may be multiple C streams (s80, s81)
+   *  Not all L1Accepts in a C stream will have a matching L1Accept in the DAQ stream. 
+   *  We do not want to throw away L1Accepts from the s80, if they do not match a 
+      DAQ stream, we want to order them correctly.
+   *  Comparing a C stream L1 accept against D or C stream Transitions requires history.
+      The clocks are different and fiducials in both are not available. The C stream
+      L1 accept need not have a matching L1 in the Daq stream. This is when the block number 
+      is used.
+   *  Comparing a DAQ L1 accept against a DAQ Transition also requires history. We are not
+      guaranteed that the clock for an L1 accept following a DAQ transition has a later time
+      than the clock for the transition. This is most always the case, but there has been 
+      data where it is not true. We assume that all L1 accepts before the transition 
+      should appear earlier, and likewise all L1 accepts after should appear after. The
+      block is used in these cases.
+   *  At this point, the C and I streams are not supposed to have anything useful in their
+      Transition dgrams (other than the Configure transition). 
+   *  We cannot compare anything from independent streams. One the one hand, a LD vs. an LI is
+      fiducials based, but we first check the run and L1Block count. Before we compare anything
+      from an independent stream, we need a process that assigns L1Block numbers to Dgrams from
+      the Independent streams that are synchronized with those of the DAQ/Control streams. 
+      Hence all comparisions involving a TI or LI (even against themselves) are presently marked
+      badGreater.
+   ------------------------------------------------------------------- */
+const StreamDgramGreater::CompareMethod 
+StreamDgramGreater::s_compareTable[NumCategories][NumCategories] = {
+  //               LD            LC            LI            TD            TC            TI
+  /* LD */ { fidGreater,   fidGreater,   badGreater,   blockGreater, blockGreater, badGreater },
+  /* LC */ { fidGreater,   fidGreater,   badGreater,   blockGreater, blockGreater, badGreater },
+  /* LI */ { badGreater,   badGreater,   badGreater,   badGreater,   badGreater,   badGreater },
+  /* TD */ { blockGreater, blockGreater, badGreater,   clockGreater, clockGreater, badGreater },
+  /* TC */ { blockGreater, blockGreater, badGreater,   clockGreater, clockGreater, badGreater },
+  /* TI */ { badGreater,   badGreater,   badGreater,   badGreater,   badGreater,   badGreater },
+};
 
-StreamDgramGreater::DgramCategoryAB StreamDgramGreater::makeDgramCategoryAB(DgramCategory a, DgramCategory b) {
-  return StreamDgramGreater::DgramCategoryAB(a,b);
+StreamDgramGreater::StreamDgramGreater(unsigned maxClockDriftSeconds) 
+  : m_fidCompare(maxClockDriftSeconds) 
+{
 }
-
+  
 // implement greater than, 
 bool StreamDgramGreater::operator()(const StreamDgram &a, const StreamDgram &b) const {
   // two empty datagrams are equal to one another
@@ -147,26 +130,19 @@ bool StreamDgramGreater::operator()(const StreamDgram &a, const StreamDgram &b)
   if (a.empty()) return true;
   if (b.empty()) return false;
 
-  StreamDgramGreater::DgramCategory dgramCategA = getDgramCategory(a);
-  StreamDgramGreater::DgramCategory dgramCategB = getDgramCategory(b);
-  StreamDgramGreater::DgramCategoryAB dgramCategAB = makeDgramCategoryAB(dgramCategA, dgramCategB);
-  std::map<DgramCategoryAB, CompareMethod>::const_iterator pos = m_LUT.find(dgramCategAB);
-  if (pos == m_LUT.end()) {
-    StreamDgramGreater::DgramCategoryAB dgramCategBA = makeDgramCategoryAB(dgramCategB, dgramCategA);
-    pos = m_LUT.find(dgramCategBA);
-    if (pos == m_LUT.end()) throw UnknownGreater(ERR_LOC);
-  }
-  StreamDgramGreater::CompareMethod compareMethod = pos->second;
+  const StreamDgram::MergeKey & keyA = a.mergeKey();
+  const StreamDgram::MergeKey & keyB = b.mergeKey();
+  StreamDgramGreater::CompareMethod compareMethod = s_compareTable[keyA.category][keyB.category];
   
   switch (compareMethod) {
   case clockGreater:
-    return doClockGreater(a,b);
+    return doClockGreater(keyA, keyB);
   case fidGreater:
-    return doFidGreater(a,b);
+    return doFidGreater(keyA, keyB);
   case blockGreater:
-    return doBlockGreater(a,b);
+    return doBlockGreater(keyA, keyB);
   case badGreater:
-    return doBadGreater(a,b);
+    return doBadGreater(keyA, keyB);
   }
 
   MsgLog(logger, fatal, "StreamDgramGreater: unexpected error. compare method in look up table = " 
@@ -174,43 +150,27 @@ bool StreamDgramGreater::operator()(const StreamDgram &a, const StreamDgram &b)
   return false;
 }
 
-bool StreamDgramGreater::doClockGreater(const StreamDgram &a, const StreamDgram &b) const
+// The run and L1Block are compared first for both clock and fiducial compares.
+bool StreamDgramGreater::doClockGreater(const StreamDgram::MergeKey &a, const StreamDgram::MergeKey &b) const
 { 
-  if (a.empty() or b.empty()) throw psana::Exception(ERR_LOC, "StreamDgramGreater: empty dgs");
-  int runResult = runLessGreater(a,b);
-  if (runResult > 0) return true;
-  if (runResult < 0) return false;
-  int blockResult = blockLessGreater(a,b);
-  if (blockResult > 0) return true;
-  if (blockResult < 0) return false;
-  const Pds::ClockTime & clockA = a.dg()->seq.clock();
-  const Pds::ClockTime & clockB = b.dg()->seq.clock();
-  bool res = clockA > clockB;
-  return res;
+  if (a.run != b.run) return a.run > b.run;
+  if (a.block != b.block) return a.block > b.block;
+  return a.clock > b.clock;
 }
 
-bool StreamDgramGreater::doFidGreater(const StreamDgram &a, const StreamDgram &b) const
+bool StreamDgramGreater::doFidGreater(const StreamDgram::MergeKey &a, const StreamDgram::MergeKey &b) const
 { 
-  if (a.empty() or b.empty()) throw psana::Exception(ERR_LOC, "StreamDgramGreater: empty dgs");
-  int runResult = runLessGreater(a,b);
-  if (runResult > 0) return true;
-  if (runResult < 0) return false;
-  int blockResult = blockLessGreater(a,b);
-  if (blockResult > 0) return true;
-  if (blockResult < 0) return false;
-  bool res = m_fidCompare.fiducialsGreater(*a.dg(), *b.dg());
-  return res;
+  if (a.run != b.run) return a.run > b.run;
+  if (a.block != b.block) return a.block > b.block;
+  return m_fidCompare.fiducialsGreater(a.seconds, a.fiducials, b.seconds, b.fiducials);
 }
 
-bool StreamDgramGreater::doBlockGreater(const StreamDgram &a, const StreamDgram &b) const
+bool StreamDgramGreater::doBlockGreater(const StreamDgram::MergeKey &a, const StreamDgram::MergeKey &b) const
 { 
-  if (a.empty() or b.empty()) throw psana::Exception(ERR_LOC, "StreamDgramGreater: empty dgs");
+  bool l1AcceptA = a.category < unsigned(StreamDgram::NumStreamTypes);
+  bool l1AcceptB = b.category < unsigned(StreamDgram::NumStreamTypes);
 
-  TransitionType transA = getDgramCategory(a).first;
-  TransitionType transB = getDgramCategory(b).first;
-
-  if (((transA == L1Accept) and (transB == L1Accept)) or
-      ((transA == otherTrans) and (transB == otherTrans))) {
+  if (l1AcceptA == l1AcceptB) {
     throw psana::Exception(ERR_LOC, "DoBlockGreater: both datagrams are "
                            "either L1Accept or otherTrans. They must be mixed");
   }
@@ -221,49 +181,20 @@ bool StreamDgramGreater::doBlockGreater(const StreamDgram &a, const StreamDgram
   // number across all the runs would get out of sync. Also sometimes runs are brought to an
   // end because of DAQ problems with synchronizing the non L1Accept transitions accross the
   // streams - so a block count they may not be synchronized accross streams at the very end of a run.
-
-  // compare runs
-  unsigned runA = a.file().run();
-  unsigned runB = b.file().run();
-
-  if (runA < runB) return false;
-  if (runA > runB) return true;
+  if (a.run < b.run) return false;
+  if (a.run > b.run) return true;
 
   // same run, compare block number.
-
-  if ((transA == L1Accept) and (transB == otherTrans)) {
-    bool res = a.L1Block() >= b.L1Block();
-    return res;
-  } 
+  if (l1AcceptA) return a.block >= b.block;
   // (transA == otherTrans) and (transB == L1Accept)
-  bool res = a.L1Block() > b.L1Block();
-  return res;
+  return a.block > b.block;
 }
 
-bool StreamDgramGreater::doBadGreater(const StreamDgram &a, const StreamDgram &b) const
+bool StreamDgramGreater::doBadGreater(const StreamDgram::MergeKey &a, const StreamDgram::MergeKey &b) const
 { 
   throw psana::Exception(ERR_LOC, "doBadGreater called");
 }
 
-int StreamDgramGreater::runLessGreater(const StreamDgram &a, const StreamDgram &b) const 
-{
-  unsigned runA = a.file().run();
-  unsigned runB = b.file().run();
-  if (runA < runB) return -1;
-  if (runA > runB) return 1;
-  return 0;
-}
-
-int StreamDgramGreater::blockLessGreater(const StreamDgram &a, const StreamDgram &b) const
-{
-  int64_t blockA = a.L1Block();
-  int64_t blockB = b.L1Block();
-
-  if (blockA < blockB) return -1;
-  if (blockA > blockB) return 1;
-  return 0;
-}
-
 bool StreamDgramGreater::sameEvent(const StreamDgram &a, const StreamDgram &b) const {
   if (a.empty() and b.empty()) {
     MsgLog(logger, warning, "sameEvent: comparing two empty dgrams");
@@ -273,7 +204,18 @@ bool StreamDgramGreater::sameEvent(const StreamDgram &a, const StreamDgram &b) c
     MsgLog(logger, warning, "sameEvent: comparing an empty dgram to a non-empty dgram");
     return false;
   }
-  throw psana::Exception(ERR_LOC, "sameEvent: not implmented");
+  if ((a.streamType() == StreamDgram::controlIndependent) or 
+      (b.streamType() == StreamDgram::controlIndependent)) {
+    throw psana::Exception(ERR_LOC, "sameEvent: controlIndependent streams not supported");
+  }
+  const StreamDgram::MergeKey & keyA = a.mergeKey();
+  const StreamDgram::MergeKey & keyB = b.mergeKey();
+  if ((keyA.run != keyB.run) or (keyA.block != keyB.block)) return false;
+  if (keyA.service != keyB.service) return false;
+  if (a.isL1Accept()) {
+    return m_fidCompare.fiducialsEqual(keyA.seconds, keyA.fiducials, keyB.seconds, keyB.fiducials);
+  }
+  return true;
 }
   
 };
@@ -0,0 +1,312 @@
+//--------------------------------------------------------------------------
+// File and Version Information:
+// 	$Id$
+//
+// Description:
+//	Class TaskScheduler...
+//
+//------------------------------------------------------------------------
+
+//-----------------------
+// This Class's Header --
+//-----------------------
+#include "XtcInput/TaskScheduler.h"
+
+//-----------------
+// C/C++ Headers --
+//-----------------
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <sched.h>
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/thread/tss.hpp>
+
+//-------------------------------
+// Collaborating Class Headers --
+//-------------------------------
+#include "MsgLogger/MsgLogger.h"
+
+//-----------------------------------------------------------------------
+// Local Macros, Typedefs, Structures, Unions and Forward Declarations --
+//-----------------------------------------------------------------------
+
+namespace {
+
+  const char* logger = "XtcInput.TaskScheduler";
+
+  // scheduler and queue of the pool thread, not set in other threads
+  typedef std::pair<const XtcInput::TaskScheduler*, unsigned> PoolThread;
+  boost::thread_specific_ptr<PoolThread> poolThread;
+
+  // placement of the thread set by PlacementScope
+  typedef boost::shared_ptr<const XtcInput::NumaPlacement> PlacementPtr;
+  boost::thread_specific_ptr<PlacementPtr> threadPlacement;
+
+  void setThreadPlacement(const PlacementPtr& placement)
+  {
+    if (not threadPlacement.get()) {
+      if (not placement) return;
+      threadPlacement.reset(new PlacementPtr());
+    }
+    *threadPlacement = placement;
+  }
+
+  // CPU limit of the cgroup (v2 or v1), 0 if there is no limit
+  double cgroupCpuLimit()
+  {
+    std::ifstream cpuMax("/sys/fs/cgroup/cpu.max");
+    std::string quota;
+    double period = 0;
+    if (cpuMax >> quota >> period) {
+      if (quota == "max" or period <= 0) return 0;
+      return std::atof(quota.c_str()) / period;
+    }
+
+    std::ifstream quotaFile("/sys/fs/cgroup/cpu/cpu.cfs_quota_us");
+    std::ifstream periodFile("/sys/fs/cgroup/cpu/cpu.cfs_period_us");
+    double quotaUs = 0, periodUs = 0;
+    if (quotaFile >> quotaUs and periodFile >> periodUs and quotaUs > 0 and periodUs > 0) {
+      return quotaUs / periodUs;
+    }
+    return 0;
+  }
+
+}
+
+//		----------------------------------------
+// 		-- Public Function Member Definitions --
+//		----------------------------------------
+
+namespace XtcInput {
+
+TaskScheduler::Task::Task(const Function& fun, Priority priority)
+  : m_fun(fun)
+  , m_priority(priority)
+  , m_placement(placement())
+  , m_state(Pending)
+  , m_error()
+  , m_mutex()
+  , m_cond()
+{
+}
+
+// run in this thread if nobody has started it
+bool
+TaskScheduler::Task::tryRun()
+{
+  if (not claim()) return false;
+  execute();
+  return true;
+}
+
+// wait until finished, re-throw its exception
+void
+TaskScheduler::Task::wait()
+{
+  tryRun();
+  boost::mutex::scoped_lock lock(m_mutex);
+  while (m_state == Running) m_cond.wait(lock);
+  if (m_error) std::rethrow_exception(m_error);
+}
+
+// make sure it never runs or wait for the end
+bool
+TaskScheduler::Task::cancel()
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  if (m_state == Pending) {
+    m_state = Cancelled;
+    m_fun = Function();
+    m_cond.notify_all();
+    return true;
+  }
+  while (m_state == Running) m_cond.wait(lock);
+  return false;
+}
+
+bool
+TaskScheduler::Task::done() const
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  return m_state == Finished or m_state == Cancelled;
+}
+
+// change state from Pending to Running
+bool
+TaskScheduler::Task::claim()
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  if (m_state != Pending) return false;
+  m_state = Running;
+  return true;
+}
+
+// call function after successful claim()
+void
+TaskScheduler::Task::execute()
+{
+  std::exception_ptr error;
+  try {
+    PlacementScope placement(m_placement);
+    m_fun();
+  } catch (...) {
+    error = std::current_exception();
+  }
+
+  boost::mutex::scoped_lock lock(m_mutex);
+  m_error = error;
+  m_state = Finished;
+  m_fun = Function();   // release whatever function holds
+  m_cond.notify_all();
+}
+
+// apply placement to the calling thread and its tasks
+TaskScheduler::PlacementScope::PlacementScope(const boost::shared_ptr<const NumaPlacement>& placement)
+  : m_previous(TaskScheduler::placement())
+  , m_scope(placement == m_previous ? 0 : placement.get())   // nested task of the same reader
+{
+  setThreadPlacement(placement);
+}
+
+// restore previous placement
+TaskScheduler::PlacementScope::~PlacementScope()
+{
+  setThreadPlacement(m_previous);
+}
+
+// placement of the calling thread
+boost::shared_ptr<const NumaPlacement>
+TaskScheduler::placement()
+{
+  const PlacementPtr* placement = threadPlacement.get();
+  return placement ? *placement : PlacementPtr();
+}
+
+// scheduler shared by all XtcInput classes
+TaskScheduler&
+TaskScheduler::instance()
+{
+  static TaskScheduler scheduler(cpuQuota());
+  return scheduler;
+}
+
+// number of CPUs which the process can use
+unsigned
+TaskScheduler::cpuQuota()
+{
+  unsigned ncpu = boost::thread::hardware_concurrency();
+  cpu_set_t cpuSet;
+  if (sched_getaffinity(0, sizeof cpuSet, &cpuSet) == 0) ncpu = CPU_COUNT(&cpuSet);
+
+  const double limit = cgroupCpuLimit();
+  if (limit > 0 and std::ceil(limit) < ncpu) ncpu = unsigned(std::ceil(limit));
+  return ncpu > 0 ? ncpu : 1;
+}
+
+//----------------
+// Constructors --
+//----------------
+TaskScheduler::TaskScheduler(unsigned nThreads)
+  : m_queues()
+  , m_nextQueue(0)
+  , m_pending(0)
+  , m_stop(false)
+  , m_mutex()
+  , m_cond()
+  , m_threads()
+{
+  if (nThreads == 0) nThreads = 1;
+  for (unsigned i = 0; i != nThreads; ++ i) m_queues.push_back(boost::make_shared<Queue>());
+  for (unsigned i = 0; i != nThreads; ++ i) m_threads.create_thread(boost::bind(&TaskScheduler::work, this, i));
+  MsgLog(logger, trace, "started " << nThreads << " threads");
+}
+
+//--------------
+// Destructor --
+//--------------
+TaskScheduler::~TaskScheduler()
+{
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_stop = true;
+    m_cond.notify_all();
+  }
+  m_threads.join_all();
+}
+
+// queue function for one of the threads
+boost::shared_ptr<TaskScheduler::Task>
+TaskScheduler::submit(const Function& fun, Priority priority)
+{
+  boost::shared_ptr<Task> task = boost::make_shared<Task>(fun, priority);
+
+  boost::mutex::scoped_lock lock(m_mutex);
+  unsigned index;
+  PoolThread* current = poolThread.get();
+  if (current and current->first == this) {
+    index = current->second;
+  } else {
+    index = m_nextQueue;
+    m_nextQueue = (m_nextQueue + 1) % m_queues.size();
+  }
+  {
+    boost::mutex::scoped_lock qlock(m_queues[index]->mutex);
+    m_queues[index]->tasks[priority].push_back(task);
+  }
+  ++ m_pending;
+  m_cond.notify_one();
+  return task;
+}
+
+// body of a pool thread
+void
+TaskScheduler::work(unsigned index)
+{
+  poolThread.reset(new PoolThread(this, index));
+  while (true) {
+    {
+      boost::mutex::scoped_lock lock(m_mutex);
+      while (m_pending == 0 and not m_stop) m_cond.wait(lock);
+      if (m_pending == 0) return;
+      -- m_pending;
+    }
+
+    // one task is reserved for this thread, it may be in any queue
+    boost::shared_ptr<Task> task;
+    while (not task) task = take(index);
+
+    // task may have been run by a waiting thread or cancelled
+    if (task->claim()) task->execute();
+  }
+}
+
+// remove one task from the queues, own queue first
+boost::shared_ptr<TaskScheduler::Task>
+TaskScheduler::take(unsigned index)
+{
+  const unsigned n = m_queues.size();
+  for (unsigned priority = 0; priority != NumPriorities; ++ priority) {
+    for (unsigned i = 0; i != n; ++ i) {
+      Queue& queue = *m_queues[(index + i) % n];
+      boost::mutex::scoped_lock qlock(queue.mutex);
+      std::deque<boost::shared_ptr<Task> >& tasks = queue.tasks[priority];
+      if (tasks.empty()) continue;
+      boost::shared_ptr<Task> task;
+      if (i == 0) {
+        task = tasks.front();
+        tasks.pop_front();
+      } else {
+        task = tasks.back();
+        tasks.pop_back();
+      }
+      return task;
+    }
+  }
+  return boost::shared_ptr<Task>();
+}
+
+} // namespace XtcInput
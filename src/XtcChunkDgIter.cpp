@@ -18,6 +18,7 @@
 //-----------------
 // C/C++ Headers --
 //-----------------
+#include <vector>
 #include <boost/make_shared.hpp>
 
 //-------------------------------
@@ -50,6 +51,16 @@ namespace XtcInput {
 XtcChunkDgIter::XtcChunkDgIter (const XtcFileName& path, unsigned liveTimeout)
   : m_file(path, liveTimeout)
   , m_off(0)
+  , m_prefetch()
+  , m_finalSize(-1)
+{
+}
+
+XtcChunkDgIter::XtcChunkDgIter (const boost::shared_ptr<ChunkPrefetcher>& prefetch)
+  : m_file(prefetch->path())
+  , m_off(0)
+  , m_prefetch(prefetch)
+  , m_finalSize(-1)
 {
 }
 
@@ -63,12 +74,20 @@ XtcChunkDgIter::~XtcChunkDgIter ()
 boost::shared_ptr<DgHeader>
 XtcChunkDgIter::next()
 {
+  if (m_prefetch) {
+    boost::shared_ptr<DgHeader> hptr = m_prefetch->next();
+    if (hptr) m_off = hptr->nextOffset();
+    return hptr;
+  }
   return nextAtOffset(m_off);
 }
 
 boost::shared_ptr<DgHeader>
 XtcChunkDgIter::nextAtOffset(off64_t offset)
 {
+  // jump is done on the file directly, reading thread is not needed any more
+  m_prefetch.reset();
+
   if (m_file.seek(offset, SEEK_SET) == (off_t)-1) {
     throw XTCReadException(ERR_LOC, m_file.path().path());
   }
@@ -120,5 +139,48 @@ XtcChunkDgIter::nextAtOffset(off64_t offset)
   
   return hptr;
 }
+
+// true if next() will not wait for live data
+bool
+XtcChunkDgIter::nextReady()
+{
+  if (m_prefetch or not m_file.liveTimeout()) return true;
+
+  Pds::Dgram header;
+  const size_t headerSize = sizeof header;
+  if (not m_file.ready(m_off, headerSize)) return false;
+  if (m_file.peek((char*)&header, headerSize, m_off) != ssize_t(headerSize)) {
+    // file was closed by the writer, next() sees EOF right away
+    return true;
+  }
+  if (header.xtc.extent < sizeof(Pds::Xtc)) {
+    // corrupted header, let next() report it
+    return true;
+  }
+  return m_file.ready(m_off, headerSize + (header.xtc.extent - sizeof(Pds::Xtc)));
+}
+
+// number of bytes after the next datagram to read, negative if not known
+off_t
+XtcChunkDgIter::bytesLeft()
+{
+  // final size does not change once known
+  if (m_finalSize < 0) m_finalSize = m_file.finalSize();
+  if (m_finalSize < 0) return m_finalSize;
+  return m_finalSize - m_off;
+}
+
+// read first bytes of the file so that they are in the page cache
+void
+XtcChunkDgIter::warm(size_t bytes)
+{
+  m_file.advise(0, bytes, POSIX_FADV_WILLNEED);
+
+  const size_t blockSize = 1024*1024;
+  std::vector<char> buf(blockSize);
+  for (size_t off = 0; off < bytes; off += blockSize) {
+    if (m_file.peek(&buf[0], blockSize, off) <= 0) break;
+  }
+}
   
 } // namespace XtcInput
@@ -0,0 +1,100 @@
+//--------------------------------------------------------------------------
+// File and Version Information:
+// 	$Id$
+//
+// Description:
+//	Class XtcFileTable...
+//
+//------------------------------------------------------------------------
+
+//-----------------------
+// This Class's Header --
+//-----------------------
+#include "XtcInput/XtcFileTable.h"
+
+//-----------------
+// C/C++ Headers --
+//-----------------
+
+//-------------------------------
+// Collaborating Class Headers --
+//-------------------------------
+#include "XtcInput/Exceptions.h"
+
+//-----------------------------------------------------------------------
+// Local Macros, Typedefs, Structures, Unions and Forward Declarations --
+//-----------------------------------------------------------------------
+
+//		----------------------------------------
+// 		-- Public Function Member Definitions --
+//		----------------------------------------
+
+namespace XtcInput {
+
+//----------------
+// Constructors --
+//----------------
+XtcFileTable::XtcFileTable()
+  : m_ids()
+  , m_size(1)
+  , m_mutex()
+{
+  for (unsigned i = 0; i != MaxBlocks; ++ i) m_blocks[i].store(0, std::memory_order_relaxed);
+  // first entry of the first block is the empty name
+  m_blocks[0].store(new XtcFileName[BlockSize], std::memory_order_release);
+}
+
+//--------------
+// Destructor --
+//--------------
+XtcFileTable::~XtcFileTable()
+{
+  for (unsigned i = 0; i != MaxBlocks; ++ i) delete [] m_blocks[i].load(std::memory_order_relaxed);
+}
+
+// Returns the instance used by everybody
+XtcFileTable&
+XtcFileTable::instance()
+{
+  static XtcFileTable table;
+  return table;
+}
+
+// Returns id for a file name, adds the name if it is new
+XtcFileTable::FileId
+XtcFileTable::intern(const XtcFileName& file)
+{
+  if (file.empty()) return EmptyId;
+
+  boost::mutex::scoped_lock lock(m_mutex);
+
+  std::map<std::string, FileId>::const_iterator it = m_ids.find(file.path());
+  if (it != m_ids.end()) return it->second;
+
+  const FileId id = m_size;
+  if (id >> BlockBits == MaxBlocks) {
+    throw XTCGenException(ERR_LOC, "too many distinct file names, cannot add " + file.path());
+  }
+
+  // entry is complete before the id is returned, readers get the id only
+  // through something which synchronizes with this thread
+  XtcFileName* block = m_blocks[id >> BlockBits].load(std::memory_order_relaxed);
+  if (not block) {
+    block = new XtcFileName[BlockSize];
+    m_blocks[id >> BlockBits].store(block, std::memory_order_release);
+  }
+  block[id & BlockMask] = file;
+  m_ids.insert(std::make_pair(file.path(), id));
+  ++ m_size;
+  return id;
+}
+
+// Returns number of names in the table, including the empty one
+size_t
+XtcFileTable::size() const
+{
+  boost::mutex::scoped_lock lock(m_mutex);
+  return m_size;
+}
+
+} // namespace XtcInput
@@ -65,11 +65,11 @@ boost::shared_ptr<XtcFilesPosition> XtcFilesPosition::makeSharedPtrFromEvent(PSE
   if (not dgListPtr) {
     return boost::shared_ptr<XtcFilesPosition>();
   }
-  DgramList &dgList = *dgListPtr;
-  std::vector<off64_t> offsets = dgList.getOffsets();
+  const DgramList &dgList = *dgListPtr;
+  const DgramList::Offsets& offsets = dgList.offsets();
   bool allOffsetsValid = true;
   for (unsigned idx = 0; idx < offsets.size(); ++idx) {
-    if (offsets.at(idx) < 0) {
+    if (offsets[idx] < 0) {
       allOffsetsValid = false;
       break;
     }
@@ -77,10 +77,9 @@ boost::shared_ptr<XtcFilesPosition> XtcFilesPosition::makeSharedPtrFromEvent(PSE
   if (not allOffsetsValid) return boost::shared_ptr<XtcFilesPosition>();
 
   std::list<off64_t> offsetsAsList(offsets.begin(), offsets.end());
-  std::vector<XtcInput::XtcFileName> xtcFileNames = dgList.getFileNames();
   std::list<std::string> fileNames;
-  for (unsigned idx = 0; idx < xtcFileNames.size(); ++idx) {
-    fileNames.push_back(xtcFileNames.at(idx).path());
+  for (unsigned idx = 0; idx < dgList.size(); ++idx) {
+    fileNames.push_back(dgList.file(idx).path());
   }
   return boost::make_shared<XtcInput::XtcFilesPosition>(fileNames, offsetsAsList);
 }
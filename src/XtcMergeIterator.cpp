@@ -18,6 +18,8 @@
 //-----------------
 // C/C++ Headers --
 //-----------------
+#include <vector>
+#include <boost/bind.hpp>
 #include <boost/make_shared.hpp>
 
 //-------------------------------
@@ -25,6 +27,8 @@
 //-------------------------------
 #include "MsgLogger/MsgLogger.h"
 #include "XtcInput/Exceptions.h"
+#include "XtcInput/ResumableBuffer.h"
+#include "pdsdata/xtc/Dgram.hh"
 
 //-----------------------------------------------------------------------
 // Local Macros, Typedefs, Structures, Unions and Forward Declarations --
@@ -34,6 +38,17 @@ namespace {
 
   const char* logger = "XtcInput.XtcMergeIterator";
 
+  // merging of a concurrent run pauses when this many bytes are not yet returned
+  const size_t runBufferBytes = 32*1024*1024;
+
+  // memory used by all datagrams of an event
+  size_t eventSize(const XtcInput::DgramList& event) {
+    size_t size = 0;
+    const XtcInput::DgramList::Dgrams& dgs = event.dgrams();
+    for (unsigned i = 0; i != dgs.size(); ++ i) size += sizeof(Pds::Dgram) + dgs[i]->xtc.sizeofPayload();
+    return size;
+  }
+
 }
 
 //		----------------------------------------
@@ -42,20 +57,66 @@ namespace {
 
 namespace XtcInput {
 
+// One run merged by a TaskScheduler task when concurrentRuns > 1, events are
+// kept in its buffer until they are returned, up to runBufferBytes.
+struct XtcMergeIterator::RunSegment : boost::noncopyable {
+  RunSegment(XtcMergeIterator* owner, unsigned _run, const boost::shared_ptr<StreamFileIterI>& _files,
+             const boost::shared_ptr<XtcFilesPosition>& _position,
+             const boost::shared_ptr<MemoryGovernor>& memory)
+    : run(_run), files(_files), position(_position), merger()
+    , buffer(boost::bind(&XtcMergeIterator::mergeRun, owner, this, _1), eventSize, runBufferBytes,
+             memory, MemoryGovernor::RunBuffer, TaskScheduler::Normal,
+             boost::bind(&XtcMergeIterator::runChanged, owner)) {}
+
+  unsigned run;                   ///< run number
+  boost::shared_ptr<StreamFileIterI> files;      ///< files of the run
+  boost::shared_ptr<XtcFilesPosition> position;  ///< thirdEvent for the first run
+  boost::shared_ptr<XtcStreamMerger> merger;     ///< used by the task only
+  ResumableBuffer<DgramList> buffer;             ///< merged events, destroyed first
+};
+
 //----------------
 // Constructors --
 //----------------
 XtcMergeIterator::XtcMergeIterator (const boost::shared_ptr<RunFileIterI>& runIter, 
                                     double l1OffsetSec, int firstControlStream, 
                                     unsigned maxStreamClockDiffSec,
-				    boost::shared_ptr<XtcFilesPosition> thirdEvent)
+				    boost::shared_ptr<XtcFilesPosition> thirdEvent,
+                                    XtcStreamMerger::MergeEngine engine,
+                                    unsigned prefetchChunks,
+                                    bool pipelineRuns,
+                                    const ShardSpec& shard,
+                                    unsigned cycleThreads,
+                                    unsigned concurrentRuns,
+                                    bool completionOrder,
+                                    const boost::shared_ptr<MemoryGovernor>& memory,
+                                    bool segmentedDgrams)
   : m_runIter(runIter)
   , m_l1OffsetSec(l1OffsetSec)
   , m_firstControlStream(firstControlStream)
   , m_maxStreamClockDiffSec(maxStreamClockDiffSec)
   , m_thirdEvent(thirdEvent)
   , m_firstRun(true)
-
+  , m_engine(engine)
+  , m_prefetchChunks(prefetchChunks)
+  , m_pipelineRuns(pipelineRuns)
+  , m_shard(shard)
+  , m_cycleThreads(cycleThreads)
+  , m_memory(memory ? memory : boost::make_shared<MemoryGovernor>(0))
+  , m_segmentedDgrams(segmentedDgrams)
+  , m_nextRunTask()
+  , m_nextMerger()
+  , m_nextRun(0)
+  , m_nextRunError()
+  , m_concurrentRuns(concurrentRuns)
+  , m_completionOrder(completionOrder)
+  , m_noMoreRuns(false)
+  , m_runs()
+  , m_currentRun()
+  , m_runOutput()
+  , m_runMutex()
+  , m_runCond()
+  , m_runChanges(0)
 {
 }
   
@@ -64,44 +125,35 @@ XtcMergeIterator::XtcMergeIterator (const boost::shared_ptr<RunFileIterI>& runIt
 //--------------
 XtcMergeIterator::~XtcMergeIterator ()
 {
+  // merger for the next run is dropped if nobody has read it
+  if (m_nextRunTask) m_nextRunTask->cancel();
+
+  // same for the concurrent runs, their tasks use this object
+  m_currentRun.reset();
+  m_runs.clear();
 }
 
 // Return next datagram.
 Dgram 
 XtcMergeIterator::next()
 {
+  if (m_concurrentRuns > 1) {
+    // datagrams come out of the runs one event at a time
+    if (m_runOutput.empty()) {
+      DgramList event = nextRunEvent();
+      for (unsigned i = 0; i != event.size(); ++ i) m_runOutput.push_back(event.take(i));
+    }
+    if (m_runOutput.empty()) return Dgram();
+    Dgram dgram = std::move(m_runOutput.front());
+    m_runOutput.pop_front();
+    return dgram;
+  }
+
   Dgram dgram;
   while (not dgram.dg()) {
     
-    if (not m_dgiter) {
-      
-      // get next file name
-      boost::shared_ptr<StreamFileIterI> fileNameIter = m_runIter->next();
-      
-      boost::shared_ptr<XtcFilesPosition> xtcFilesPos;
-      if (m_firstRun) {
-        m_firstRun = false;
-        if (m_thirdEvent) {
-          if (unsigned(m_thirdEvent->run()) != m_runIter->run()) {
-            MsgLog(logger, error, "run mismatch: thirdEvent.run=" 
-                   << m_thirdEvent->run()
-                   << " != runIter.run=" << m_runIter->run());
-            throw JumpToDifferentRun(ERR_LOC);
-          }
-          xtcFilesPos = m_thirdEvent;
-        }
-      }
-      
-      // if no more files then stop
-      if (not fileNameIter) break ;
-      
-      // open next xtc file if there is none open
-      MsgLog(logger, trace, "processing run #" << m_runIter->run()) ;
-      m_dgiter = boost::make_shared<XtcStreamMerger>(fileNameIter, m_l1OffsetSec, 
-                                                     m_firstControlStream,
-                                                     m_maxStreamClockDiffSec,
-                                                     xtcFilesPos);
-    }
+    // open next run if there is none open, stop if no more runs
+    if (not m_dgiter and not openNextRun()) break;
     
     // try to read next datagram from it
     dgram = m_dgiter->next() ;
@@ -114,8 +166,246 @@ XtcMergeIterator::next()
   return dgram ;
   
 }
+
+// Return all datagrams of the next event.
+DgramList
+XtcMergeIterator::nextEvent()
+{
+  if (m_concurrentRuns > 1) {
+    // rest of the event if next() was used before
+    if (not m_runOutput.empty()) {
+      DgramList event;
+      for (unsigned i = 0; i != m_runOutput.size(); ++ i) event.push_back(std::move(m_runOutput[i]));
+      m_runOutput.clear();
+      return event;
+    }
+    return nextRunEvent();
+  }
+
+  DgramList event;
+  while (event.size() == 0) {
+
+    // open next run if there is none open, stop if no more runs
+    if (not m_dgiter and not openNextRun()) break;
+
+    event = m_dgiter->nextEvent();
+
+    // if failed to read go to next run
+    if (event.size() == 0) m_dgiter.reset();
+  }
+
+  return event;
+}
+
+// make merger for the next run, returns false if there are no more runs
+bool
+XtcMergeIterator::openNextRun()
+{
+  boost::shared_ptr<XtcStreamMerger> merger;
+  unsigned run = 0;
+
+  if (m_nextRunTask) {
+
+    // merger for this run has been made in the background (or is made here
+    // if no pool thread has started it)
+    m_nextRunTask->wait();
+    m_nextRunTask.reset();
+    if (m_nextRunError) {
+      std::exception_ptr error = m_nextRunError;
+      m_nextRunError = std::exception_ptr();
+      std::rethrow_exception(error);
+    }
+    merger.swap(m_nextMerger);
+    run = m_nextRun;
+
+  } else {
+
+    // get next file name
+    boost::shared_ptr<StreamFileIterI> fileNameIter = m_runIter->next();
+    boost::shared_ptr<XtcFilesPosition> xtcFilesPos = runStartPosition();
+  
+    // if no more files then stop
+    if (not fileNameIter) return false;
+
+    run = m_runIter->run();
+    merger = makeMerger(fileNameIter, xtcFilesPos);
+  }
+
+  // no more runs
+  if (not merger) return false;
+  
+  MsgLog(logger, trace, "processing run #" << run) ;
+  m_dgiter = merger;
+
+  // make merger for the following run while this one is being read
+  if (m_pipelineRuns) {
+    m_nextRunTask = TaskScheduler::instance().submit(boost::bind(&XtcMergeIterator::makeNextRunMerger, this),
+                                                     TaskScheduler::Normal);
+  }
+  return true;
+}
+
+// make merger for the run, reads first datagram in every stream
+boost::shared_ptr<XtcStreamMerger>
+XtcMergeIterator::makeMerger(const boost::shared_ptr<StreamFileIterI>& fileNameIter,
+                             const boost::shared_ptr<XtcFilesPosition>& xtcFilesPos)
+{
+  return boost::make_shared<XtcStreamMerger>(fileNameIter, m_l1OffsetSec, 
+                                             m_firstControlStream,
+                                             m_maxStreamClockDiffSec,
+                                             xtcFilesPos, m_engine,
+                                             m_prefetchChunks, m_shard,
+                                             m_cycleThreads, m_memory,
+                                             m_segmentedDgrams);
+}
+
+// body of the task which makes merger for the next run
+void
+XtcMergeIterator::makeNextRunMerger()
+try {
+  boost::shared_ptr<StreamFileIterI> fileNameIter = m_runIter->next();
+  if (not fileNameIter) return;
+  m_nextRun = m_runIter->run();
+  MsgLog(logger, trace, "preparing run #" << m_nextRun) ;
+  m_nextMerger = makeMerger(fileNameIter, boost::shared_ptr<XtcFilesPosition>());
+} catch (...) {
+  // reported when the consumer gets to this run
+  m_nextRunError = std::current_exception();
+}
+
+// position for the run which runIter has just returned, thirdEvent for the first run
+boost::shared_ptr<XtcFilesPosition>
+XtcMergeIterator::runStartPosition()
+{
+  if (not m_firstRun) return boost::shared_ptr<XtcFilesPosition>();
+  m_firstRun = false;
+  if (m_thirdEvent and unsigned(m_thirdEvent->run()) != m_runIter->run()) {
+    MsgLog(logger, error, "run mismatch: thirdEvent.run=" 
+           << m_thirdEvent->run()
+           << " != runIter.run=" << m_runIter->run());
+    throw JumpToDifferentRun(ERR_LOC);
+  }
+  return m_thirdEvent;
+}
+
+// start merging next run from runIter, false if there are no more runs
+bool
+XtcMergeIterator::startRun()
+{
+  boost::shared_ptr<StreamFileIterI> fileNameIter = m_runIter->next();
+  boost::shared_ptr<XtcFilesPosition> xtcFilesPos = runStartPosition();
+  if (not fileNameIter) {
+    m_noMoreRuns = true;
+    return false;
+  }
+
+  MsgLog(logger, trace, "preparing run #" << m_runIter->run()) ;
+  boost::shared_ptr<RunSegment> segment = 
+    boost::make_shared<RunSegment>(this, m_runIter->run(), fileNameIter, xtcFilesPos, m_memory);
+  m_runs.push_back(segment);
+  segment->buffer.start();
+  return true;
+}
+
+// next event of the run, false at its end, called by the merging task
+bool
+XtcMergeIterator::mergeRun(RunSegment* segment, DgramList& event)
+{
+  if (not segment->merger) segment->merger = makeMerger(segment->files, segment->position);
+  event = segment->merger->nextEvent();
+  if (event.size() > 0) return true;
+
+  // files are closed as soon as the run is merged
+  segment->merger.reset();
+  return false;
+}
+
+// buffer of a run has new events or its task has returned
+void
+XtcMergeIterator::runChanged()
+{
+  boost::mutex::scoped_lock lock(m_runMutex);
+  ++ m_runChanges;
+  m_runCond.notify_one();
+}
+
+// remove run which is returned next from m_runs
+boost::shared_ptr<XtcMergeIterator::RunSegment>
+XtcMergeIterator::takeRun()
+{
+  boost::shared_ptr<RunSegment> segment;
+  if (not m_completionOrder) {
+    segment = m_runs.front();
+    m_runs.pop_front();
+    return segment;
+  }
+
+  // first run which has finished or filled its memory
+  boost::mutex::scoped_lock lock(m_runMutex);
+  while (true) {
+    for (unsigned i = 0; i != m_runs.size(); ++ i) {
+      if (m_runs[i]->buffer.ready()) {
+        segment = m_runs[i];
+        m_runs.erase(m_runs.begin() + i);
+        return segment;
+      }
+    }
+
+    // nothing is ready, merge the oldest run here if no pool thread has started it,
+    // otherwise wait for a change which was not seen above
+    const unsigned changes = m_runChanges;
+    boost::shared_ptr<RunSegment> oldest = m_runs.front();
+    lock.unlock();
+    bool ranHere = oldest->buffer.tryRun();
+    lock.lock();
+    while (not ranHere and changes == m_runChanges) m_runCond.wait(lock);
+  }
+}
+
+// next event from the runs merged concurrently
+DgramList
+XtcMergeIterator::nextRunEvent()
+{
+  while (true) {
+
+    if (not m_currentRun) {
+      // keep concurrentRuns runs in progress, fewer when memory is tight
+      while (not m_noMoreRuns and m_runs.size() < m_concurrentRuns and 
+             (m_runs.empty() or m_memory->speculativeAllowed())) startRun();
+      if (m_runs.empty()) return DgramList();
+      boost::shared_ptr<RunSegment> run = takeRun();
+      MsgLog(logger, trace, "processing run #" << run->run) ;
+      {
+        boost::mutex::scoped_lock lock(m_runMutex);
+        m_currentRun = run;
+      }
+      // current run counts as one of them
+      while (not m_noMoreRuns and m_runs.size() + 1 < m_concurrentRuns and m_memory->speculativeAllowed()) startRun();
+    }
+
+    DgramList event;
+    std::exception_ptr error;
+    try {
+      if (m_currentRun->buffer.next(event)) return event;
+    } catch (...) {
+      error = std::current_exception();
+    }
+
+    // this run is finished, go to the next one
+    boost::shared_ptr<RunSegment> finished;
+    {
+      boost::mutex::scoped_lock lock(m_runMutex);
+      finished.swap(m_currentRun);
+    }
+    if (error) std::rethrow_exception(error);
+  }
+}
   
 bool XtcMergeIterator::availEventsIsAtLeast(unsigned numEvents) {
+  if (m_concurrentRuns > 1) {
+    boost::mutex::scoped_lock lock(m_runMutex);
+    return m_currentRun and m_currentRun->buffer.size() >= numEvents;
+  }
   if (not m_dgiter) return false;
   unsigned count = m_dgiter->countAvailDgramsStopAt(numEvents);
   return count >= numEvents;
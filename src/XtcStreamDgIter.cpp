@@ -48,6 +48,15 @@ namespace {
   const unsigned daqReadAheadSize = 20;
   const unsigned controlReadAheadSize = 40;
 
+  // memory for datagrams read ahead by each ChunkPrefetcher
+  const size_t prefetchBytes = 64*1024*1024;
+
+  // next chunk is opened when there is less than this left in current chunk,
+  // and this many bytes at its start are read into the page cache
+  const size_t preopenBytesLeft = 64*1024*1024;
+  const size_t warmBytes = 4*1024*1024;
+  const unsigned preopenLiveCheckInterval = 100;
+
   // functor to match header against specified clock time
   struct MatchClock {
     MatchClock(const Pds::ClockTime& clock) : m_clock(clock) {}
@@ -87,13 +96,22 @@ namespace XtcInput {
 // Constructors --
 //----------------
 XtcStreamDgIter::XtcStreamDgIter(const boost::shared_ptr<ChunkFileIterI>& chunkIter,
-                                 bool controlStream)
+                                 bool controlStream,
+                                 unsigned prefetchChunks,
+                                 const boost::shared_ptr<MemoryGovernor>& memory,
+                                 bool segmentedDgrams)
   : m_chunkIter(chunkIter)
   , m_dgiter()
   , m_chunkCount(0)
   , m_streamCount(0)
   , m_headerQueue()
   , m_controlStream(controlStream)
+  , m_prefetchChunks(prefetchChunks)
+  , m_memory(memory ? memory : boost::make_shared<MemoryGovernor>(0))
+  , m_segmentedDgrams(segmentedDgrams)
+  , m_otherStreams(false)
+  , m_prefetch()
+  , m_preopen()
 {
   if (controlStream) {
     m_headerQueue.reserve(::controlReadAheadSize);
@@ -104,7 +122,10 @@ XtcStreamDgIter::XtcStreamDgIter(const boost::shared_ptr<ChunkFileIterI>& chunkI
 
 XtcStreamDgIter::XtcStreamDgIter(const boost::shared_ptr<ChunkFileIterI>& chunkIter,
                                  const boost::shared_ptr<ThirdDatagram> & thirdDatagram,
-                                 bool controlStream)
+                                 bool controlStream,
+                                 unsigned prefetchChunks,
+                                 const boost::shared_ptr<MemoryGovernor>& memory,
+                                 bool segmentedDgrams)
   : m_chunkIter(chunkIter)
   , m_dgiter()
   , m_chunkCount(0)
@@ -112,7 +133,13 @@ XtcStreamDgIter::XtcStreamDgIter(const boost::shared_ptr<ChunkFileIterI>& chunkI
   , m_headerQueue()
   , m_controlStream(controlStream)
   , m_thirdDatagram(thirdDatagram)
-    
+  , m_prefetchChunks(prefetchChunks)
+  , m_memory(memory ? memory : boost::make_shared<MemoryGovernor>(0))
+  , m_segmentedDgrams(segmentedDgrams)
+  , m_otherStreams(false)
+  , m_prefetch()
+  , m_preopen()
+
 {
   if (controlStream) {
     m_headerQueue.reserve(::controlReadAheadSize);
@@ -131,32 +158,54 @@ XtcStreamDgIter::~XtcStreamDgIter ()
 // throws exception for errors.
 Dgram
 XtcStreamDgIter::next()
+{
+  while (true) {
+    boost::shared_ptr<DgHeader> hptr = nextHeader();
+    if (not hptr) return Dgram();
+    Dgram::ptr dg = hptr->dgram(m_segmentedDgrams);
+    if (dg) return Dgram(std::move(dg), hptr->fileId(), hptr->offset());
+
+    // header failed to read datagram, this is likely due to non-fatal
+    // error like premature EOF. Skip this one and try to go to the next
+  }
+}
+
+// header of the next datagram, payload is not read
+boost::shared_ptr<DgHeader>
+XtcStreamDgIter::nextHeader()
 {
   // call other method to fill up and sort the queue
-  readAhead();
+  readAhead(true);
 
-  // pop one datagram if queue is not empty
-  Dgram dgram;
-  while (not m_headerQueue.empty()) {
-    boost::shared_ptr<DgHeader> hptr = m_headerQueue.front();
+  boost::shared_ptr<DgHeader> hptr;
+  if (not m_headerQueue.empty()) {
+    hptr = m_headerQueue.front();
     m_headerQueue.erase(m_headerQueue.begin());
-    Dgram::ptr dg = hptr->dgram();
-    if (dg) {
-      dgram = Dgram(dg, hptr->path(), hptr->offset());
-      break;
-    } else {
-      // header failed to read datagram, this is likely due to non-fatal
-      // error like premature EOF. Skip this one and try to go to the next
-      readAhead();
-    }
   }
+  return hptr;
+}
+
+// true if next() will return without waiting for live data
+bool
+XtcStreamDgIter::ready()
+{
+  readAhead(false);
 
-  return dgram ;
+  // with no open chunk next() has to look for the next chunk file, that
+  // cannot be checked without waiting
+  return not m_headerQueue.empty() or not m_dgiter;
+}
+
+// name of the chunk file being read
+XtcFileName
+XtcStreamDgIter::chunkName() const
+{
+  return m_dgiter ? m_dgiter->path() : XtcFileName();
 }
 
 // fill the read-ahead queue
 void
-XtcStreamDgIter::readAhead()
+XtcStreamDgIter::readAhead(bool wait)
 {
   unsigned readAheadSize;
   if (m_controlStream) {
@@ -167,17 +216,24 @@ XtcStreamDgIter::readAhead()
   
   while (m_headerQueue.size() < readAheadSize) {
 
+    // For live data do not wait for a slow writer to fill the read-ahead
+    // queue while the merger has other streams to use, it only needs the
+    // first datagram of this one. We wait if asked to and the queue is empty,
+    // or if there is nothing else to do and sorting needs the full queue.
+    if (m_chunkIter->liveTimeout() > 0 and not (wait and (m_headerQueue.empty() or not m_otherStreams))) {
+      if (not m_dgiter) break;
+      if (m_streamCount == 2 and m_thirdDatagram) break;
+      if (not m_dgiter->nextReady()) break;
+    }
+
     if (not m_dgiter) {
 
-      // get next file name
-      const XtcFileName& file = m_chunkIter->next();
+      // open next xtc file if there is none open
+      m_dgiter = openNextChunk();
 
       // if no more file then stop
-      if (file.path().empty()) break ;
+      if (not m_dgiter) break ;
 
-      // open next xtc file if there is none open
-      MsgLog(logger, trace, "processing file: " << file) ;
-      m_dgiter = boost::make_shared<XtcChunkDgIter>(file, m_chunkIter->liveTimeout());
       m_chunkCount = 0 ;
     }
 
@@ -194,16 +250,14 @@ XtcStreamDgIter::readAhead()
         while (xtcFilesNotEqual(m_dgiter->path(), xtcFileForThirdDgram)) {
           MsgLog(logger,debug,"third datagram jump, jmpFile != currentFile - "
                  << xtcFileForThirdDgram << " != " << m_dgiter->path());
-          // get next file name
-          const XtcFileName& file = m_chunkIter->next();
+          // open next file
+          m_dgiter = openNextChunk();
           
-          if (file.path().empty()) {
+          if (not m_dgiter) {
 	    // we went through all the files in the chunkIter
             throw FileNotInStream(ERR_LOC, xtcFileForThirdDgram.path());
           }
-          // open file
-          MsgLog(logger, trace, " looking for third dgram - opening file: " << file) ;
-          m_dgiter = boost::make_shared<XtcChunkDgIter>(file, m_chunkIter->liveTimeout());
+          MsgLog(logger, trace, " looking for third dgram - opened file: " << m_dgiter->path()) ;
           m_chunkCount = 0;
         }
         hptr = m_dgiter->nextAtOffset(offsetForThirdDgram);
@@ -225,6 +279,24 @@ XtcStreamDgIter::readAhead()
       queueHeader(hptr);
       ++ m_chunkCount ;
       ++ m_streamCount ;
+
+      // close to the end of this chunk, start opening the next one so that
+      // open and first reads are not in the way when we get there
+      // (live files are checked less often as it needs stat() of the final name)
+      if (not m_preopen and m_prefetch.empty() and 
+          (m_prefetchChunks == 0 or m_chunkIter->liveTimeout() > 0) and
+          (m_chunkIter->liveTimeout() == 0 or m_chunkCount % ::preopenLiveCheckInterval == 0)) {
+        off_t left = m_dgiter->bytesLeft();
+        if (left >= 0 and left < off_t(::preopenBytesLeft)) {
+          m_preopen = boost::make_shared<ChunkPreopener>(m_chunkIter, ::warmBytes);
+        }
+      }
+
+      // first datagram of the stream can be returned before the queue is
+      // full if it is a transition, nothing is sorted ahead of a transition
+      const boost::shared_ptr<DgHeader>& front = m_headerQueue.front();
+      if (m_streamCount == 1 and front->transition() != Pds::TransitionId::L1Accept and
+          not (front->damage().value() & (1 << Pds::Damage::DroppedContribution))) break;
     }
 
   }
@@ -233,6 +305,42 @@ XtcStreamDgIter::readAhead()
 
 }
 
+// open iterator for the next chunk, zero pointer after the last chunk
+boost::shared_ptr<XtcChunkDgIter>
+XtcStreamDgIter::openNextChunk()
+{
+  // chunk which was opened in the background
+  if (m_preopen) {
+    boost::shared_ptr<ChunkPreopener> preopen = m_preopen;
+    m_preopen.reset();
+    boost::shared_ptr<XtcChunkDgIter> dgiter = preopen->get();
+    if (dgiter) MsgLog(logger, trace, "processing pre-opened file: " << dgiter->path()) ;
+    return dgiter;
+  }
+
+  // live files are still being written, they are never prefetched
+  if (m_prefetchChunks == 0 or m_chunkIter->liveTimeout() > 0) {
+    const XtcFileName& file = m_chunkIter->next();
+    if (file.path().empty()) return boost::shared_ptr<XtcChunkDgIter>();
+    MsgLog(logger, trace, "processing file: " << file) ;
+    return boost::make_shared<XtcChunkDgIter>(file, m_chunkIter->liveTimeout());
+  }
+
+  // keep m_prefetchChunks chunks of this stream reading at the same time,
+  // only the next one when memory is tight
+  while (m_prefetch.size() < m_prefetchChunks and (m_prefetch.empty() or m_memory->speculativeAllowed())) {
+    const XtcFileName& file = m_chunkIter->next();
+    if (file.path().empty()) break;
+    m_prefetch.push_back(boost::make_shared<ChunkPrefetcher>(file, ::prefetchBytes, m_memory, m_segmentedDgrams));
+  }
+  if (m_prefetch.empty()) return boost::shared_ptr<XtcChunkDgIter>();
+
+  boost::shared_ptr<ChunkPrefetcher> prefetch = m_prefetch.front();
+  m_prefetch.pop_front();
+  MsgLog(logger, trace, "processing prefetched file: " << prefetch->path()) ;
+  return boost::make_shared<XtcChunkDgIter>(prefetch);
+}
+
 // add one header to the queue
 void
 XtcStreamDgIter::queueHeader(const boost::shared_ptr<DgHeader>& header)
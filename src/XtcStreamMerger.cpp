@@ -18,9 +18,15 @@
 //-----------------
 // C/C++ Headers --
 //-----------------
+#include <algorithm>
+#include <ctime>
+#include <exception>
+#include <list>
 #include <map>
+#include <unistd.h>
 #include <iomanip>
 #include <sstream>
+#include <boost/bind.hpp>
 #include <boost/make_shared.hpp>
 //-------------------------------
 // Collaborating Class Headers --
@@ -28,6 +34,10 @@
 #include "MsgLogger/MsgLogger.h"
 #include "XtcInput/ChunkFileIterList.h"
 #include "XtcInput/Exceptions.h"
+#include "XtcInput/ResumableBuffer.h"
+#include "XtcInput/StreamFileIterList.h"
+#include "XtcInput/TaskScheduler.h"
+#include "XtcInput/XtcChunkDgIter.h"
 #include "pdsdata/xtc/TransitionId.hh"
 
 //-----------------------------------------------------------------------
@@ -42,6 +52,70 @@ namespace {
 
 const char* logger = "XtcInput.XtcStreamMerger" ;
 
+// how often streams are polled while waiting for live data
+const unsigned livePollIntervalUsec = 20000;
+
+// merged calib cycle waits when this many bytes are not yet returned
+const size_t cycleBufferBytes = 64*1024*1024;
+
+typedef std::vector<std::pair<XtcFileName, off64_t> > CycleStarts;
+
+// Header pass over one stream, finds positions of all BeginCalibCycle
+// transitions. Jumping to a calib cycle needs Configure and BeginRun as
+// the first two datagrams, no positions are returned otherwise.
+void findCalibCycles(const std::vector<XtcFileName>& files, CycleStarts& starts, 
+                     std::exception_ptr& error)
+try {
+  unsigned count = 0;
+  for (std::vector<XtcFileName>::const_iterator file = files.begin(); file != files.end(); ++ file) {
+    XtcChunkDgIter iter(*file);
+    while (boost::shared_ptr<DgHeader> hptr = iter.next()) {
+      Pds::TransitionId::Value trans = hptr->transition();
+      if ((count == 0 and trans != Pds::TransitionId::Configure) or
+          (count == 1 and trans != Pds::TransitionId::BeginRun)) {
+        starts.clear();
+        return;
+      }
+      if (trans == Pds::TransitionId::BeginCalibCycle) starts.push_back(std::make_pair(*file, hptr->offset()));
+      ++ count;
+    }
+  }
+} catch (...) {
+  error = std::current_exception();
+}
+
+// Stream with its first datagram, made by initStream()
+struct StreamInit {
+  boost::shared_ptr<XtcInput::XtcStreamDgIter> stream;
+  XtcInput::Dgram first;
+  boost::shared_ptr<XtcInput::TaskScheduler::Task> fill;  ///< fills read-ahead queue of closed files
+};
+
+// Open the stream and read its first datagram, then fill the rest of its
+// read-ahead queue in the background.
+void initStream(const boost::shared_ptr<XtcInput::ChunkFileIterI>& chunkIter,
+                const boost::shared_ptr<XtcInput::XtcStreamDgIter::ThirdDatagram>& thirdDatagram,
+                bool controlStream, unsigned prefetchChunks,
+                const boost::shared_ptr<XtcInput::MemoryGovernor>& memory, bool segmentedDgrams,
+                StreamInit& init)
+{
+  init.stream = boost::make_shared<XtcInput::XtcStreamDgIter>(chunkIter, thirdDatagram, controlStream,
+                                                              prefetchChunks, memory, segmentedDgrams);
+  init.first = init.stream->next();
+  if (chunkIter->liveTimeout() == 0) {
+    init.fill = XtcInput::TaskScheduler::instance().submit(boost::bind(&XtcInput::XtcStreamDgIter::fill, init.stream),
+                                                          XtcInput::TaskScheduler::Prefetch);
+  }
+}
+
+// memory used by all datagrams of an event
+size_t eventSize(const DgramList& event) {
+  size_t size = 0;
+  const DgramList::Dgrams& dgs = event.dgrams();
+  for (unsigned i = 0; i != dgs.size(); ++ i) size += sizeof(Pds::Dgram) + dgs[i]->xtc.sizeofPayload();
+  return size;
+}
+
 bool isDisable(const XtcInput::Dgram &dg) {
   if (dg.empty()) return false;
   Pds::TransitionId::Value nextService = dg.dg()->seq.service();
@@ -75,59 +149,143 @@ checkForThirdDatagram(int stream, boost::shared_ptr<XtcFilesPosition> thirdEvent
 
 namespace XtcInput {
 
+// One calib cycle merged by a TaskScheduler task, events are kept in its
+// buffer until nextCycleEvent() takes them, up to cycleBufferBytes.
+struct XtcStreamMerger::CycleSegment : boost::noncopyable {
+  CycleSegment(XtcStreamMerger* owner, size_t _index, bool _last, const boost::shared_ptr<MemoryGovernor>& memory)
+    : index(_index), last(_last), merger(), cycleEnded(false)
+    , buffer(boost::bind(&XtcStreamMerger::mergeCycle, owner, this, _1), eventSize, cycleBufferBytes,
+             memory, MemoryGovernor::CycleBuffer, TaskScheduler::Normal) {}
+
+  size_t index;                   ///< calib cycle number in the run
+  bool last;                      ///< last calib cycle, merged until the end of the run
+  boost::shared_ptr<XtcStreamMerger> merger;  ///< used by the task only
+  bool cycleEnded;                ///< EndCalibCycle seen, used by the task only
+  ResumableBuffer<DgramList> buffer;          ///< merged events, destroyed first
+};
+
 //----------------
 // Constructors --
 //----------------
 XtcStreamMerger::XtcStreamMerger(const boost::shared_ptr<StreamFileIterI>& streamIter,
                                  double l1OffsetSec, int firstControlStream,
                                  unsigned maxStreamClockDiffSec,
-                                 boost::shared_ptr<XtcFilesPosition> thirdEvent) 
+                                 boost::shared_ptr<XtcFilesPosition> thirdEvent,
+                                 MergeEngine engine,
+                                 unsigned prefetchChunks,
+                                 const ShardSpec& shard,
+                                 unsigned cycleThreads,
+                                 const boost::shared_ptr<MemoryGovernor>& memory,
+                                 bool segmentedDgrams) 
   : m_streams()
   , m_priorTransBlock()
+  , m_fillTasks()
   , m_processingDAQ(false)
   , m_l1OffsetSec(int(l1OffsetSec))
   , m_l1OffsetNsec(int((l1OffsetSec-m_l1OffsetSec)*1e9))
   , m_firstControlStream(firstControlStream)
   , m_streamDgramGreater(maxStreamClockDiffSec)
   , m_thirdEvent(thirdEvent)
+  , m_engine(engine)
   , m_outputQueue(m_streamDgramGreater)
-    
+  , m_outputTree(m_streamDgramGreater)
+  , m_joinTable()
+  , m_joinStreams()
+  , m_joinOutput()
+  , m_shard(shard)
+  , m_blockOffset(0)
+  , m_cycleMode(false)
+  , m_cycleThreads(cycleThreads)
+  , m_cycleL1OffsetSec(l1OffsetSec)
+  , m_maxStreamClockDiffSec(maxStreamClockDiffSec)
+  , m_cycleFiles()
+  , m_cycleStarts()
+  , m_nextCycle(0)
+  , m_memory(memory ? memory : boost::make_shared<MemoryGovernor>(0))
+  , m_segmentedDgrams(segmentedDgrams)
+  , m_cycles()
+  , m_singleStream()
+  , m_singleIndex()
+  , m_singlePrior(0)
+  , m_singleFirst()
+  , m_singleEnd(false)
+  , m_liveStreams(0)
 {
-
-  // create all streams
-  int idxDAQ = 0;
-  int idxCtrl = 0;
+  // chunk iterators for all streams
+  ChunkIters chunkIters;
   while (true) {
     const boost::shared_ptr<ChunkFileIterI>& chunkFileIter = streamIter->next();
     if (not chunkFileIter) break;
+    chunkIters.push_back(std::make_pair(streamIter->stream(), chunkFileIter));
+  }
+
+  if (m_cycleThreads > 1 and not m_thirdEvent and initCycles(chunkIters)) return;
+
+  // open all streams and read their first datagrams in parallel, file open
+  // latency is paid once and not once per stream
+  std::vector<boost::shared_ptr<XtcStreamDgIter::ThirdDatagram> > thirdDatagrams;
+  for (unsigned i = 0; i != chunkIters.size(); ++ i) {
+    thirdDatagrams.push_back(checkForThirdDatagram(chunkIters[i].first, m_thirdEvent));
+  }
+  std::vector<StreamInit> inits(chunkIters.size());
+  std::vector<boost::shared_ptr<TaskScheduler::Task> > initTasks;
+  for (unsigned i = 0; i != chunkIters.size(); ++ i) {
+    bool controlStream = int(chunkIters[i].first) >= m_firstControlStream;
+    initTasks.push_back(TaskScheduler::instance().submit(boost::bind(&initStream, chunkIters[i].second, thirdDatagrams[i], 
+                                                                     controlStream, prefetchChunks, m_memory,
+                                                                     m_segmentedDgrams,
+                                                                     boost::ref(inits[i])),
+                                                         TaskScheduler::Live));
+  }
+  // all tasks have to finish before the first error is re-thrown
+  std::exception_ptr initError;
+  for (unsigned i = 0; i != initTasks.size(); ++ i) {
+    try {
+      initTasks[i]->wait();
+    } catch (...) {
+      if (not initError) initError = std::current_exception();
+    }
+  }
+  if (initError) {
+    for (unsigned i = 0; i != inits.size(); ++ i) {
+      if (inits[i].fill) inits[i].fill->cancel();
+    }
+    std::rethrow_exception(initError);
+  }
 
-    bool controlStream = int(streamIter->stream()) >= m_firstControlStream;
+  // add all streams
+  int idxDAQ = 0;
+  int idxCtrl = 0;
+  for (unsigned i = 0; i != chunkIters.size(); ++ i) {
 
-    boost::shared_ptr<XtcStreamDgIter::ThirdDatagram> thirdDatagram = 
-      checkForThirdDatagram(streamIter->stream(), m_thirdEvent);
+    bool controlStream = int(chunkIters[i].first) >= m_firstControlStream;
+    const boost::shared_ptr<XtcStreamDgIter>& stream = inits[i].stream;
 
-    // create new stream
-    const boost::shared_ptr<XtcStreamDgIter>& stream = 
-      boost::make_shared<XtcStreamDgIter>(chunkFileIter, thirdDatagram, controlStream);
     if (controlStream) {
-      StreamDgram dg(stream->next(), StreamDgram::controlUnderDAQ, 0, idxCtrl);
+      // time must be updated before the merge key is made in StreamDgram
+      Dgram firstDg = inits[i].first;
+      if (not firstDg.empty()) updateDgramTime(*firstDg.dg());
+      StreamDgram dg(firstDg, StreamDgram::controlUnderDAQ, 0, idxCtrl);
       StreamIndex streamIndex(StreamDgram::controlUnderDAQ, idxCtrl);
       ++idxCtrl;
       m_streams[streamIndex] = stream;
+      if (inits[i].fill) m_fillTasks[streamIndex] = inits[i].fill;
       m_priorTransBlock[streamIndex] = getInitialTransBlock(dg);
-      if (not dg.empty()) updateDgramTime(*dg.dg());
-      m_outputQueue.push(dg);
+      pushInitial(dg);
       MsgLog(logger, DBGMSG, "XtcStreamMerger initialization. Added " 
              << StreamDgram::dumpStr(dg)); 
     } else {
       // this is a DAQ stream
-      StreamDgram dg(stream->next(), StreamDgram::DAQ, 0, idxDAQ);
+      // time must be updated before the merge key is made in StreamDgram
+      Dgram firstDg = inits[i].first;
+      if (not firstDg.empty()) updateDgramTime(*firstDg.dg());
+      StreamDgram dg(firstDg, StreamDgram::DAQ, 0, idxDAQ);
       StreamIndex streamIndex(StreamDgram::DAQ, idxDAQ);
       ++idxDAQ;
       m_streams[streamIndex] = stream;
+      if (inits[i].fill) m_fillTasks[streamIndex] = inits[i].fill;
       m_priorTransBlock[streamIndex] = getInitialTransBlock(dg);
-      if (not dg.empty()) updateDgramTime(*dg.dg());
-      m_outputQueue.push(dg);
+      pushInitial(dg);
       MsgLog(logger, DBGMSG, "XtcStreamMerger initialization. Added " 
              << StreamDgram::dumpStr(dg));
     }
@@ -135,6 +293,29 @@ XtcStreamMerger::XtcStreamMerger(const boost::shared_ptr<StreamFileIterI>& strea
   if (idxDAQ > 0) {
     m_processingDAQ = true;
   }
+
+  // live streams need not wait for their full read-ahead while others can be used
+  for (unsigned i = 0; i != inits.size(); ++ i) {
+    if (inits[i].stream->liveTimeout() > 0 and not inits[i].first.empty()) ++ m_liveStreams;
+  }
+  if (m_liveStreams > 1) {
+    for (unsigned i = 0; i != inits.size(); ++ i) inits[i].stream->setOtherStreams(true);
+  }
+
+  // with one stream there is nothing to merge, its datagrams are returned
+  // directly, skipping the same datagrams as readStreamDgram()
+  if (m_streams.size() == 1) {
+    m_singleStream = m_streams.begin()->second;
+    m_singleIndex = m_streams.begin()->first;
+    m_singlePrior = &m_priorTransBlock[m_singleIndex];
+    m_singleFirst = inits[0].first;
+    m_singleEnd = m_singleFirst.empty();
+    MsgLog(logger, DBGMSG, "XtcStreamMerger: single stream, merging is bypassed");
+  }
+
+  if (m_shard.sharded()) {
+    MsgLog(logger, trace, "XtcStreamMerger reads L1Accepts of rank " << m_shard);
+  }
   MsgLog(logger, DBGMSG, "XtcStreamMerger initialization: "
          << idxDAQ << " DAQ streams and " << idxCtrl << " control streams");
 }
@@ -144,6 +325,9 @@ XtcStreamMerger::XtcStreamMerger(const boost::shared_ptr<StreamFileIterI>& strea
 //--------------
 XtcStreamMerger::~XtcStreamMerger ()
 {
+  // cycle tasks use members of this object, stop them before anything is destroyed
+  m_cycles.clear();
+  for (FillTasks::iterator it = m_fillTasks.begin(); it != m_fillTasks.end(); ++ it) it->second->cancel();
 }
 
 // read next datagram, return zero pointer after last file has been read,
@@ -152,13 +336,103 @@ Dgram
 XtcStreamMerger::next()
 {
   MutexLock protect(m_protect);
-  if (m_outputQueue.empty()) return Dgram();
+  if (m_singleStream) return nextSingleDgram();
+  return nextStreamDgram();
+}
+
+// read all datagrams of the next event, empty list after last file has been read
+DgramList
+XtcStreamMerger::nextEvent()
+{
+  MutexLock protect(m_protect);
+
+  if (m_singleStream) {
+    // every datagram of a single stream is an event
+    DgramList event;
+    Dgram dg = nextSingleDgram();
+    if (not dg.empty()) event.push_back(std::move(dg));
+    return event;
+  }
+
+  if (m_engine == HashJoinEngine or m_cycleMode) {
+    // return rest of the event if next() was called in the middle of it
+    if (not m_joinOutput.empty()) {
+      DgramList event;
+      for (unsigned i = 0; i != m_joinOutput.size(); ++ i) event.push_back(std::move(m_joinOutput[i]));
+      m_joinOutput.clear();
+      return event;
+    }
+    return m_cycleMode ? nextCycleEvent() : nextJoinedEvent();
+  }
+
+  DgramList event;
+  StreamDgram first = nextStreamDgram();
+  if (first.empty()) return event;
+  event.push_back(first);
+
+  // streams that already contributed, a second datagram from the same
+  // stream starts a new event
+  std::vector<StreamIndex> contributed(1, StreamIndex(first.streamType(), first.streamId()));
+  while (true) {
+    const StreamDgram & head = topDgram();
+    if (head.empty() or not m_streamDgramGreater.sameEvent(first, head)) break;
+    StreamIndex headIndex(head.streamType(), head.streamId());
+    if (std::find(contributed.begin(), contributed.end(), headIndex) != contributed.end()) break;
+    contributed.push_back(headIndex);
+    event.push_back(nextStreamDgram());
+  }
+  return event;
+}
+
+StreamDgram
+XtcStreamMerger::nextStreamDgram()
+{
+  if (m_engine == HashJoinEngine or m_cycleMode) {
+    // datagrams come out of the join table or calib cycles one event at a time
+    if (m_joinOutput.empty()) {
+      DgramList event = m_cycleMode ? nextCycleEvent() : nextJoinedEvent();
+      for (unsigned i = 0; i != event.size(); ++ i) {
+        m_joinOutput.push_back(StreamDgram(event.take(i), StreamDgram::DAQ, 0, 0));
+      }
+    }
+    if (m_joinOutput.empty()) return StreamDgram();
+    StreamDgram dg = std::move(m_joinOutput.front());
+    m_joinOutput.pop_front();
+    return dg;
+  }
+
+  if (m_streams.empty()) return StreamDgram();
+
+  const StreamDgram & top = topDgram();
+  StreamIndex replaceStreamIndex(top.streamType(), top.streamId());
+
+  MsgLog(logger,DBGMSG,"next() returning: " << StreamDgram::dumpStr(top));
+
+  // datagram is moved out of the merge engine, no copy
+  return exchangeTopDgram(readStreamDgram(replaceStreamIndex));
+}
+
+// join datagrams from all streams until the earliest event is complete
+DgramList
+XtcStreamMerger::nextJoinedEvent()
+{
+  while (not m_joinTable.ready()) {
+    int slot = m_joinTable.laggard();
+    if (slot < 0) break;
+    StreamDgram dg = readStreamDgram(m_joinStreams[slot]);
+    if (dg.empty()) {
+      m_joinTable.streamDone(slot);
+    } else {
+      m_joinTable.add(slot, dg);
+    }
+  }
+  return m_joinTable.pop();
+}
 
-  StreamDgram nextStreamDg = m_outputQueue.top();
-  m_outputQueue.pop();
-  int replaceStreamId = nextStreamDg.streamId();
-  StreamIndex replaceStreamIndex(nextStreamDg.streamType(), replaceStreamId);
-    
+// next datagram from one stream with its L1Block, skipping datagrams which are not merged
+StreamDgram
+XtcStreamMerger::readStreamDgram(const StreamIndex &replaceStreamIndex)
+{
   if (m_streams.find(replaceStreamIndex) == m_streams.end()) {
     throw psana::Exception(ERR_LOC, "XtcStreamMerger::next() replacement stream index not found in m_streams");
   }
@@ -166,14 +440,46 @@ XtcStreamMerger::next()
     throw psana::Exception(ERR_LOC, "XtcStreamMerger::next() replacement stream index not found in m_priorTransBlock");
   }
 
-  MsgLog(logger,DBGMSG,"next() returning: " << StreamDgram::dumpStr(nextStreamDg));
+  uint64_t replaceBlock = 0;
+  Dgram replaceDg = readDgram(replaceStreamIndex, *m_streams[replaceStreamIndex],
+                              m_priorTransBlock[replaceStreamIndex], replaceBlock);
+  return StreamDgram(std::move(replaceDg), replaceStreamIndex.first, replaceBlock, replaceStreamIndex.second);
+}
+
+// next datagram from one stream and its L1Block, skipping datagrams which are not merged
+Dgram
+XtcStreamMerger::readDgram(const StreamIndex &replaceStreamIndex, XtcStreamDgIter& stream,
+                           TransBlock& priorTransBlock, uint64_t& replaceBlock)
+{
+  if (not m_fillTasks.empty()) waitForFill(replaceStreamIndex);
 
-  bool replaced = false;
-  while (not replaced) {
-    Dgram replaceDg = m_streams[replaceStreamIndex]->next();
-    TransBlock lastTransBlock = m_priorTransBlock[replaceStreamIndex];
-    uint64_t replaceBlock = getNextBlock(lastTransBlock, replaceDg);
-    m_priorTransBlock[replaceStreamIndex] = makeTransBlock(replaceDg, replaceBlock);
+  while (true) {
+    if (stream.liveTimeout() > 0) waitForStream(replaceStreamIndex);
+    TransBlock lastTransBlock = priorTransBlock;
+
+    // L1Accepts which belong to other ranks are dropped by their header, 
+    // payload of these datagrams is never read. L1Accept does not change 
+    // the block number.
+    boost::shared_ptr<DgHeader> header = stream.nextHeader();
+    if (header and m_shard.sharded() and header->transition() == Pds::TransitionId::L1Accept) {
+      int run = header->path().run();
+      uint64_t block = run == lastTransBlock.run ? lastTransBlock.block : 0;
+      if (not m_shard.owns(block + m_blockOffset, header->fiducials())) {
+        priorTransBlock = TransBlock(Pds::TransitionId::L1Accept, block, run);
+        continue;
+      }
+    }
+    Dgram replaceDg;
+    if (not header and stream.liveTimeout() > 0) liveStreamDone();
+    if (header) {
+      Dgram::ptr dg = header->dgram(m_segmentedDgrams);
+      // header failed to read datagram, this is likely due to non-fatal
+      // error like premature EOF. Skip this one and try to go to the next
+      if (not dg) continue;
+      replaceDg = Dgram(std::move(dg), header->fileId(), header->offset());
+    }
+    replaceBlock = getNextBlock(lastTransBlock, replaceDg);
+    priorTransBlock = makeTransBlock(replaceDg, replaceBlock);
 
     // skip over enable and disable transitions in all streams. We use EndCalibCycle for 
     // the L1Block count as its synchronization across the DAQ streams is more robust.
@@ -204,8 +510,8 @@ XtcStreamMerger::next()
         skip = true;
       }
     } else if (processingDAQ()) {
-      if ((nextStreamDg.streamType() == StreamDgram::controlUnderDAQ) or 
-          (nextStreamDg.streamType() == StreamDgram::controlIndependent)) {
+      if ((replaceStreamIndex.first == StreamDgram::controlUnderDAQ) or 
+          (replaceStreamIndex.first == StreamDgram::controlIndependent)) {
         if (not replaceDg.empty()) {
           Pds::TransitionId::Value replaceTrans = replaceDg.dg()->seq.service();
           if (replaceTrans == Pds::TransitionId::Configure) {
@@ -223,13 +529,241 @@ XtcStreamMerger::next()
         }
       }
     }
-    if (not skip) {
-      StreamDgram replaceStreamDg(replaceDg, nextStreamDg.streamType(), replaceBlock, replaceStreamId);
-      m_outputQueue.push(replaceStreamDg);
-      replaced = true;
+    if (not skip) return replaceDg;
+  }
+}
+
+// wait for the read-ahead task which the constructor started for the stream
+void
+XtcStreamMerger::waitForFill(const StreamIndex &streamIndex)
+{
+  FillTasks::iterator fill = m_fillTasks.find(streamIndex);
+  if (fill != m_fillTasks.end()) {
+    boost::shared_ptr<TaskScheduler::Task> task = fill->second;
+    m_fillTasks.erase(fill);
+    task->wait();
+  }
+}
+
+// next datagram of the only stream, merging is bypassed
+Dgram
+XtcStreamMerger::nextSingleDgram()
+{
+  if (not m_singleFirst.empty()) {
+    Dgram dg = std::move(m_singleFirst);
+    m_singleFirst = Dgram();
+    return dg;
+  }
+  if (m_singleEnd) return Dgram();
+
+  uint64_t block = 0;
+  Dgram dg = readDgram(m_singleIndex, *m_singleStream, *m_singlePrior, block);
+  if (dg.empty()) m_singleEnd = true;
+  return dg;
+}
+
+// Find calib cycles in all streams and start merging them. Chunk iterators
+// are consumed, they are replaced with new ones if streams have to be merged
+// serially.
+bool
+XtcStreamMerger::initCycles(ChunkIters &chunkIters)
+{
+  if (chunkIters.empty()) return false;
+  for (ChunkIters::const_iterator it = chunkIters.begin(); it != chunkIters.end(); ++ it) {
+    if (it->second->liveTimeout() > 0) return false;
+  }
+
+  // file names of all chunks, jump needs same stream number in file names
+  std::vector<std::vector<XtcFileName> > files(chunkIters.size());
+  bool sameStream = true;
+  for (unsigned i = 0; i != chunkIters.size(); ++ i) {
+    while (true) {
+      XtcFileName file = chunkIters[i].second->next();
+      if (file.path().empty()) break;
+      if (file.stream() != chunkIters[i].first) sameStream = false;
+      files[i].push_back(file);
+    }
+    chunkIters[i].second = boost::make_shared<ChunkFileIterList>(files[i].begin(), files[i].end());
+  }
+  if (not sameStream) return false;
+
+  // header pass, all streams in parallel
+  std::vector<CycleStarts> starts(files.size());
+  std::vector<std::exception_ptr> errors(files.size());
+  std::vector<boost::shared_ptr<TaskScheduler::Task> > tasks;
+  for (unsigned i = 0; i != files.size(); ++ i) {
+    tasks.push_back(TaskScheduler::instance().submit(boost::bind(&findCalibCycles, boost::cref(files[i]), 
+                                                                 boost::ref(starts[i]), boost::ref(errors[i])),
+                                                     TaskScheduler::Live));
+  }
+  for (unsigned i = 0; i != tasks.size(); ++ i) tasks[i]->wait();
+  for (unsigned i = 0; i != errors.size(); ++ i) {
+    if (errors[i]) std::rethrow_exception(errors[i]);
+  }
+
+  const size_t nCycles = starts[0].size();
+  for (unsigned i = 0; i != starts.size(); ++ i) {
+    if (starts[i].size() != nCycles) {
+      MsgLog(logger, trace, "streams have different number of calib cycles, merging serially");
+      return false;
+    }
+  }
+  if (nCycles < 2) return false;
+
+  // first cycle is merged from the beginning of the run, others jump to their BeginCalibCycle
+  for (unsigned i = 0; i != files.size(); ++ i) {
+    m_cycleFiles.insert(m_cycleFiles.end(), files[i].begin(), files[i].end());
+  }
+  m_cycleStarts.push_back(boost::shared_ptr<XtcFilesPosition>());
+  for (size_t cycle = 1; cycle != nCycles; ++ cycle) {
+    std::list<std::string> fileNames;
+    std::list<off64_t> offsets;
+    for (unsigned i = 0; i != starts.size(); ++ i) {
+      fileNames.push_back(starts[i][cycle].first.path());
+      offsets.push_back(starts[i][cycle].second);
+    }
+    m_cycleStarts.push_back(boost::make_shared<XtcFilesPosition>(fileNames, offsets));
+  }
+
+  MsgLog(logger, trace, "merging " << nCycles << " calib cycles, " << m_cycleThreads << " at a time");
+  m_cycleMode = true;
+  while (m_nextCycle < m_cycleStarts.size() and m_cycles.size() < m_cycleThreads) startCycle();
+  return true;
+}
+
+// start merging next calib cycle
+void
+XtcStreamMerger::startCycle()
+{
+  const size_t index = m_nextCycle ++;
+  boost::shared_ptr<CycleSegment> segment = 
+    boost::make_shared<CycleSegment>(this, index, index + 1 == m_cycleStarts.size(), m_memory);
+  m_cycles.push_back(segment);
+  segment->buffer.start();
+}
+
+// next event of the calib cycle, false at its end, called by the merging task
+bool
+XtcStreamMerger::mergeCycle(CycleSegment* segment, DgramList& event)
+{
+  if (not segment->merger) {
+    boost::shared_ptr<StreamFileIterI> streamIter = 
+      boost::make_shared<StreamFileIterList>(m_cycleFiles.begin(), m_cycleFiles.end(), MergeFileName);
+    segment->merger = boost::make_shared<XtcStreamMerger>(streamIter, m_cycleL1OffsetSec, m_firstControlStream, 
+                                                          m_maxStreamClockDiffSec, m_cycleStarts[segment->index], 
+                                                          m_engine, 0, m_shard, 0, m_memory,
+                                                          m_segmentedDgrams);
+    segment->merger->m_blockOffset = segment->index;
+  }
+
+  // Configure and BeginRun are read before the jump, only first cycle returns 
+  // them. Cycle ends before BeginCalibCycle of the next one.
+  while (true) {
+    event = segment->merger->nextEvent();
+    if (event.size() == 0) break;
+
+    const Pds::TransitionId::Value trans = event.frontDg()->seq.service();
+    if (segment->index > 0 and 
+        (trans == Pds::TransitionId::Configure or trans == Pds::TransitionId::BeginRun)) continue;
+    if (trans == Pds::TransitionId::EndCalibCycle) {
+      segment->cycleEnded = true;
+    } else if (trans == Pds::TransitionId::BeginCalibCycle and segment->cycleEnded and not segment->last) {
+      break;
+    }
+    return true;
+  }
+
+  // files are closed as soon as the cycle is merged
+  segment->merger.reset();
+  return false;
+}
+
+// next event from the calib cycles, in order of the cycles
+DgramList
+XtcStreamMerger::nextCycleEvent()
+{
+  while (not m_cycles.empty()) {
+    DgramList event;
+    if (m_cycles.front()->buffer.next(event)) return event;
+
+    // this cycle is finished, start the next one
+    m_cycles.pop_front();
+    if (m_nextCycle < m_cycleStarts.size()) startCycle();
+  }
+  return DgramList();
+}
+
+// For live data, wait until the stream has a complete datagram. While waiting
+// keep reading ahead whatever is complete in the other streams, so a slow
+// stream does not leave all others idle.
+void
+XtcStreamMerger::waitForStream(const StreamIndex &streamIndex)
+{
+  const boost::shared_ptr<XtcStreamDgIter>& stream = m_streams[streamIndex];
+  const unsigned liveTimeout = stream->liveTimeout();
+  if (liveTimeout == 0) return;
+
+  std::time_t t0 = std::time(0);
+  bool waited = false;
+  while (not stream->ready()) {
+    if (not waited) {
+      MsgLog(logger, DBGMSG, "waiting for live data in " << dumpStr(streamIndex));
+      waited = true;
+    }
+    typedef std::map<StreamIndex, boost::shared_ptr<XtcStreamDgIter> > StreamMap;
+    for (StreamMap::iterator it = m_streams.begin(); it != m_streams.end(); ++it) {
+      if (it->first != streamIndex) it->second->ready();
+    }
+    // same timeout as a blocking read, which would start over after this
+    if (std::time(0) - t0 >= std::time_t(liveTimeout)) {
+      throw XTCLiveTimeout(ERR_LOC, stream->chunkName().path(), liveTimeout);
     }
+    usleep(::livePollIntervalUsec);
   }
-  return nextStreamDg;
+}
+
+// live stream has no more datagrams
+void
+XtcStreamMerger::liveStreamDone()
+{
+  if (m_liveStreams == 0) return;
+  if (-- m_liveStreams > 1) return;
+  typedef std::map<StreamIndex, boost::shared_ptr<XtcStreamDgIter> > StreamMap;
+  for (StreamMap::iterator it = m_streams.begin(); it != m_streams.end(); ++it) {
+    it->second->setOtherStreams(false);
+  }
+}
+
+void
+XtcStreamMerger::pushInitial(const StreamDgram &dg)
+{
+  if (m_engine == HashJoinEngine) {
+    unsigned slot = m_joinTable.addStream();
+    m_joinStreams.push_back(StreamIndex(dg.streamType(), dg.streamId()));
+    if (dg.empty()) {
+      m_joinTable.streamDone(slot);
+    } else {
+      m_joinTable.add(slot, dg);
+    }
+  } else if (m_engine == LoserTreeEngine) {
+    m_outputTree.push(dg);
+  } else {
+    m_outputQueue.push(dg);
+  }
+}
+
+const StreamDgram &
+XtcStreamMerger::topDgram()
+{
+  if (m_engine == LoserTreeEngine) return m_outputTree.top();
+  return m_outputQueue.top();
+}
+
+StreamDgram
+XtcStreamMerger::exchangeTopDgram(StreamDgram &&dg)
+{
+  if (m_engine == LoserTreeEngine) return m_outputTree.exchangeTop(std::move(dg));
+  return m_outputQueue.exchangeTop(std::move(dg));
 }
 
 // updates the time for non L1 Accepts
@@ -0,0 +1,144 @@
+//--------------------------------------------------------------------------
+// File and Version Information:
+// 	$Id$
+//
+// Description:
+//	Test suite case for ChunkPrefetcher.
+//
+//------------------------------------------------------------------------
+
+//---------------
+// C++ Headers --
+//---------------
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+//-------------------------------
+// Collaborating Class Headers --
+//-------------------------------
+#include "XtcInput/ChunkPrefetcher.h"
+#include "XtcInput/Exceptions.h"
+#include "XtcInput/XtcChunkDgIter.h"
+#include "pdsdata/xtc/Dgram.hh"
+
+using namespace XtcInput ;
+
+#define BOOST_TEST_MODULE ChunkPrefetcher
+#include <boost/test/included/unit_test.hpp>
+
+/**
+ * Simple test suite for module ChunkPrefetcher.
+ * See http://www.boost.org/doc/libs/1_36_0/libs/test/doc/html/index.html
+ */
+
+namespace {
+
+  // write ndg datagrams with payloads of different size, datagram i has fiducials i
+  std::string writeChunk(int ndg)
+  {
+    char path[] = "/tmp/ChunkPrefetcherTest-XXXXXX";
+    int fd = mkstemp(path);
+    for (int i = 0; i < ndg; ++ i) {
+      size_t payloadSize = 1000*(i % 7);
+      std::vector<char> buf(sizeof(Pds::Dgram) + payloadSize, char(i));
+      Pds::Dgram* dg = (Pds::Dgram*)&buf[0];
+      dg->seq = Pds::Sequence(Pds::Sequence::Event, Pds::TransitionId::L1Accept,
+                              Pds::ClockTime(1000, i), Pds::TimeStamp(0, i, 0));
+      dg->xtc.extent = sizeof(Pds::Xtc) + payloadSize;
+      ::write(fd, &buf[0], buf.size());
+    }
+    ::close(fd);
+    return path;
+  }
+
+}
+
+// ==============================================================
+
+BOOST_AUTO_TEST_CASE( test_same_as_chunk_iter )
+{
+  const int ndg = 200;
+  std::string path = writeChunk(ndg);
+
+  // small memory limit so that the reading thread has to wait for us
+  boost::shared_ptr<ChunkPrefetcher> prefetch = boost::make_shared<ChunkPrefetcher>(XtcFileName(path), 10000);
+  XtcChunkDgIter prefetched(prefetch);
+  XtcChunkDgIter direct((XtcFileName(path)));
+
+  for (int i = 0; i < ndg; ++ i) {
+    boost::shared_ptr<DgHeader> a = prefetched.next();
+    boost::shared_ptr<DgHeader> b = direct.next();
+    BOOST_REQUIRE(a);
+    BOOST_REQUIRE(b);
+    BOOST_CHECK_EQUAL(a->offset(), b->offset());
+    BOOST_CHECK_EQUAL(a->fiducials(), unsigned(i));
+    Dgram::ptr dga = a->dgram();
+    Dgram::ptr dgb = b->dgram();
+    size_t size = sizeof(Pds::Dgram) + dgb->xtc.sizeofPayload();
+    BOOST_CHECK(std::equal((char*)dga.get(), (char*)dga.get() + size, (char*)dgb.get()));
+  }
+  BOOST_CHECK(not prefetched.next());
+  BOOST_CHECK(not direct.next());
+
+  std::remove(path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE( test_stop_early )
+{
+  std::string path = writeChunk(100);
+
+  // destructor has to stop the reading thread which waits for free memory
+  {
+    ChunkPrefetcher prefetch(XtcFileName(path), 1);
+    BOOST_CHECK(prefetch.next());
+  }
+
+  std::remove(path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE( test_memory_governor )
+{
+  const int ndg = 100;
+  std::string path = writeChunk(ndg);
+
+  // reading pauses at 3/4 of the budget unless nothing is read yet
+  boost::shared_ptr<MemoryGovernor> memory = boost::make_shared<MemoryGovernor>(2000);
+  {
+    ChunkPrefetcher prefetch(XtcFileName(path), 1000000, memory);
+    for (int i = 0; i < ndg; ++ i) {
+      boost::shared_ptr<DgHeader> hptr = prefetch.next();
+      BOOST_REQUIRE(hptr);
+      BOOST_CHECK_EQUAL(hptr->fiducials(), unsigned(i));
+      BOOST_CHECK(memory->used() < 1500 + 6000 + sizeof(Pds::Dgram));
+    }
+    BOOST_CHECK(not prefetch.next());
+  }
+  BOOST_CHECK_EQUAL(memory->used(), 0U);
+  BOOST_CHECK(memory->peak() > 0);
+
+  std::remove(path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE( test_exception_type )
+{
+  // third datagram has extent smaller than Xtc header
+  std::string path = writeChunk(5);
+  {
+    int fd = ::open(path.c_str(), O_WRONLY);
+    Pds::Dgram dg;
+    std::fill_n((char*)&dg, sizeof dg, '\0');
+    ::pwrite(fd, &dg, sizeof dg, 2*sizeof(Pds::Dgram) + 1000);
+    ::close(fd);
+  }
+
+  // good datagrams first, then the exception of the reading task
+  ChunkPrefetcher prefetch(XtcFileName(path), 1000000);
+  BOOST_CHECK(prefetch.next());
+  BOOST_CHECK(prefetch.next());
+  BOOST_CHECK_THROW(prefetch.next(), XTCExtentException);
+
+  std::remove(path.c_str());
+}
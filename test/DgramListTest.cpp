@@ -0,0 +1,146 @@
+//--------------------------------------------------------------------------
+// File and Version Information:
+// 	$Id$
+//
+// Description:
+//	Test suite case for DgramList and SmallVector.
+//
+//------------------------------------------------------------------------
+
+//---------------
+// C++ Headers --
+//---------------
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+//-------------------------------
+// Collaborating Class Headers --
+//-------------------------------
+#include "XtcInput/DgramList.h"
+#include "XtcInput/SmallVector.h"
+#include "pdsdata/xtc/Dgram.hh"
+
+using namespace XtcInput ;
+
+#define BOOST_TEST_MODULE DgramList
+#include <boost/test/included/unit_test.hpp>
+
+/**
+ * Simple test suite for module DgramList.
+ * See http://www.boost.org/doc/libs/1_36_0/libs/test/doc/html/index.html
+ */
+
+namespace {
+
+  // L1Accept from given stream
+  Dgram makeDgram(unsigned fid, unsigned stream)
+  {
+    Dgram::ptr dg = Dgram::allocate(sizeof(Pds::Dgram));
+    std::fill_n((char*)dg.get(), sizeof(Pds::Dgram), '\0');
+    dg->seq = Pds::Sequence(Pds::Sequence::Event, Pds::TransitionId::L1Accept,
+                            Pds::ClockTime(1000, fid), Pds::TimeStamp(0, fid, 0));
+    dg->xtc.extent = sizeof(Pds::Xtc);
+    return Dgram(dg, XtcFileName("/tmp", "e1", 1, stream, 0, false), 100*stream);
+  }
+
+}
+
+// ==============================================================
+
+BOOST_AUTO_TEST_CASE( test_small_vector )
+{
+  SmallVector<std::string, 2> v;
+  BOOST_CHECK(v.empty());
+  v.push_back("a");
+  v.push_back("b");
+  BOOST_CHECK(v.isInline());
+
+  // third element moves everything to the heap
+  v.push_back("c");
+  BOOST_CHECK(not v.isInline());
+  BOOST_REQUIRE_EQUAL(v.size(), 3U);
+  BOOST_CHECK_EQUAL(v[0], "a");
+  BOOST_CHECK_EQUAL(v[2], "c");
+
+  // copies are independent
+  SmallVector<std::string, 2> copy(v);
+  copy[0] = "x";
+  BOOST_CHECK_EQUAL(v[0], "a");
+  std::vector<std::string> vec = copy.toVector();
+  BOOST_CHECK_EQUAL(vec.size(), 3U);
+  BOOST_CHECK_EQUAL(vec[0], "x");
+
+  SmallVector<int, 4> r;
+  r.reserve(2);
+  BOOST_CHECK(r.isInline());
+  for (int i = 0; i != 10; ++ i) r.push_back(i);
+  BOOST_CHECK_EQUAL(r.end() - r.begin(), 10);
+  BOOST_CHECK_EQUAL(r[9], 9);
+}
+
+BOOST_AUTO_TEST_CASE( test_accessors )
+{
+  DgramList event;
+  BOOST_CHECK_THROW(event.frontDg(), std::out_of_range);
+  for (unsigned s = 0; s != 3; ++ s) event.push_back(makeDgram(5, s));
+  event.push_back(makeDgram(5, 80));
+
+  BOOST_REQUIRE_EQUAL(event.size(), 4U);
+  BOOST_CHECK(event.dgrams().isInline());
+  BOOST_CHECK_EQUAL(event.dg(1)->seq.stamp().fiducials(), 5U);
+  BOOST_CHECK_EQUAL(event.file(2).stream(), 2U);
+  BOOST_CHECK_EQUAL(event.offset(2), 200);
+  BOOST_CHECK_EQUAL(event.streams()[3], 80U);
+  BOOST_CHECK_EQUAL(event.findStream(80), 3);
+  BOOST_CHECK_EQUAL(event.findStream(1), 1);
+  BOOST_CHECK_EQUAL(event.findStream(7), -1);
+
+  // vector copies for existing users
+  DgramList::DgramListImpl dgs = event.getDgrams();
+  DgramList::FileListImpl files = event.getFileNames();
+  DgramList::OffsetImpl offsets = event.getOffsets();
+  BOOST_REQUIRE_EQUAL(dgs.size(), 4U);
+  BOOST_CHECK(dgs[3] == event.dg(3));
+  BOOST_CHECK_EQUAL(files[3].stream(), 80U);
+  BOOST_CHECK_EQUAL(offsets[1], 100);
+}
+
+BOOST_AUTO_TEST_CASE( test_large_event )
+{
+  // more datagrams than fit inline
+  DgramList event;
+  const unsigned n = DgramList::InlineSize + 3;
+  for (unsigned s = 0; s != n; ++ s) event.push_back(makeDgram(s, s));
+  BOOST_CHECK(not event.dgrams().isInline());
+  BOOST_REQUIRE_EQUAL(event.size(), n);
+  for (unsigned s = 0; s != n; ++ s) {
+    BOOST_CHECK_EQUAL(event.dg(s)->seq.stamp().fiducials(), s);
+    BOOST_CHECK_EQUAL(event.findStream(s), int(s));
+  }
+
+  // moved list keeps all datagrams
+  DgramList moved(std::move(event));
+  BOOST_CHECK_EQUAL(moved.size(), n);
+  Dgram dg = moved.take(n-1);
+  BOOST_CHECK_EQUAL(dg.dg()->seq.stamp().fiducials(), n-1);
+  BOOST_CHECK_EQUAL(dg.offset(), off64_t(100*(n-1)));
+  BOOST_CHECK(not moved.dg(n-1));
+
+  // moved-from list is empty and usable
+  BOOST_CHECK_EQUAL(event.size(), 0U);
+  BOOST_CHECK(event.dgrams().isInline());
+  BOOST_CHECK(event.dgrams().begin() == event.dgrams().end());
+  event.push_back(makeDgram(7, 1));
+  BOOST_REQUIRE_EQUAL(event.size(), 1U);
+  BOOST_CHECK_EQUAL(event.dg(0)->seq.stamp().fiducials(), 7U);
+
+  // same after moving inline elements by assignment
+  DgramList small;
+  small.push_back(makeDgram(3, 2));
+  event = std::move(small);
+  BOOST_CHECK_EQUAL(small.size(), 0U);
+  BOOST_REQUIRE_EQUAL(event.size(), 1U);
+  BOOST_CHECK_EQUAL(event.streams()[0], 2U);
+}
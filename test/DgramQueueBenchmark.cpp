@@ -0,0 +1,179 @@
+//--------------------------------------------------------------------------
+// File and Version Information:
+// 	$Id$
+//
+// Description:
+//	Class DgramQueueBenchmark...
+//
+//------------------------------------------------------------------------
+
+//-----------------
+// C/C++ Headers --
+//-----------------
+#include <algorithm>
+#include <iostream>
+#include <queue>
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/thread/condition.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+//----------------------
+// Base Class Headers --
+//----------------------
+#include "AppUtils/AppBase.h"
+
+//-------------------------------
+// Collaborating Class Headers --
+//-------------------------------
+#include "AppUtils/AppCmdOpt.h"
+#include "MsgLogger/MsgLogger.h"
+#include "XtcInput/DgramQueue.h"
+#include "pdsdata/xtc/Dgram.hh"
+
+//-----------------------------------------------------------------------
+// Local Macros, Typedefs, Structures, Unions and Forward Declarations --
+//-----------------------------------------------------------------------
+
+namespace {
+
+  // previous DgramQueue implementation, std::queue with a mutex and two conditions
+  class LockedQueue {
+  public:
+    explicit LockedQueue(size_t maxSize) : m_maxSize(maxSize) {}
+
+    void push(const XtcInput::Dgram& dg) {
+      boost::mutex::scoped_lock qlock(m_mutex);
+      while (m_queue.size() >= m_maxSize) m_condFull.wait(qlock);
+      m_queue.push(dg);
+      m_condEmpty.notify_one();
+    }
+
+    XtcInput::Dgram pop() {
+      boost::mutex::scoped_lock qlock(m_mutex);
+      while (m_queue.empty()) m_condEmpty.wait(qlock);
+      XtcInput::Dgram p = m_queue.front();
+      m_queue.pop();
+      m_condFull.notify_one();
+      return p;
+    }
+
+  private:
+    size_t m_maxSize;
+    std::queue<XtcInput::Dgram> m_queue;
+    boost::mutex m_mutex;
+    boost::condition m_condFull;
+    boost::condition m_condEmpty;
+  };
+
+  template <typename Queue>
+  void produce(Queue* queue, const std::vector<XtcInput::Dgram>* dgs)
+  {
+    for (unsigned i = 0; i != dgs->size(); ++ i) queue->push((*dgs)[i]);
+    queue->push(XtcInput::Dgram());
+  }
+
+  double elapsedSec(const boost::posix_time::ptime& start) {
+    return (boost::posix_time::microsec_clock::universal_time() - start).total_microseconds() / 1e6;
+  }
+
+}
+
+//		----------------------------------------
+// 		-- Public Function Member Definitions --
+//		----------------------------------------
+
+namespace XtcInput {
+
+//
+//  Application class
+//
+//  Compares the cost of passing datagrams from one thread to another through
+//  the mutex/condition queue which DgramQueue used before and through the
+//  current DgramQueue ring. Datagrams are made in memory, no I/O is done.
+//
+class DgramQueueBenchmark : public AppUtils::AppBase {
+public:
+
+  // Constructor
+  explicit DgramQueueBenchmark ( const std::string& appName ) ;
+
+  // destructor
+  ~DgramQueueBenchmark () {}
+
+protected :
+
+  /**
+   *  Main method which runs the whole application
+   */
+  virtual int runApp () ;
+
+private:
+
+  template <typename Queue>
+  void runQueue(const char* name, const std::vector<Dgram>& dgs);
+
+  AppUtils::AppCmdOpt<unsigned> m_sizeOpt ;
+  AppUtils::AppCmdOpt<unsigned> m_countOpt ;
+
+};
+
+//----------------
+// Constructors --
+//----------------
+DgramQueueBenchmark::DgramQueueBenchmark ( const std::string& appName )
+  : AppUtils::AppBase( appName )
+  , m_sizeOpt( parser(), "q,queue-size", "number", "queue size, def: 32", 32 )
+  , m_countOpt( parser(), "n,count", "number", "number of datagrams, def: 1000000", 1000000 )
+{
+}
+
+/**
+ *  Main method which runs the whole application
+ */
+int
+DgramQueueBenchmark::runApp ()
+{
+  // all datagrams are made before timing starts
+  std::vector<Dgram> dgs;
+  dgs.reserve(m_countOpt.value());
+  XtcFileName file("/tmp", "e0", 1, 0, 0, false);
+  for (unsigned i = 0; i != m_countOpt.value(); ++ i) {
+    unsigned fid = i % Pds::TimeStamp::MaxFiducials;
+    char* buf = new char[sizeof(Pds::Dgram)];
+    std::fill_n(buf, sizeof(Pds::Dgram), '\0');
+    Pds::Dgram* dg = (Pds::Dgram*)buf;
+    dg->seq = Pds::Sequence(Pds::Sequence::Event, Pds::TransitionId::L1Accept,
+                            Pds::ClockTime(1000 + i / 360, 0), Pds::TimeStamp(0, fid, 0));
+    dg->xtc.extent = sizeof(Pds::Xtc);
+    dgs.push_back(Dgram(Dgram::make_ptr(dg), file));
+  }
+
+  runQueue<LockedQueue>("mutex queue: ", dgs);
+  runQueue<DgramQueue>("DgramQueue:  ", dgs);
+  return 0 ;
+}
+
+// producer thread pushes all datagrams, this thread pops them
+template <typename Queue>
+void
+DgramQueueBenchmark::runQueue(const char* name, const std::vector<Dgram>& dgs)
+{
+  Queue queue(m_sizeOpt.value());
+  boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+  boost::thread producer(boost::bind(&produce<Queue>, &queue, &dgs));
+  unsigned long count = 0;
+  while (not queue.pop().empty()) ++ count;
+  producer.join();
+  double sec = elapsedSec(start);
+
+  std::cout << name << count << " datagrams, " << sec*1e9/count << " ns/datagram" << std::endl;
+}
+
+} // namespace XtcInput
+
+
+// this defines main()
+APPUTILS_MAIN(XtcInput::DgramQueueBenchmark)
@@ -0,0 +1,358 @@
+//--------------------------------------------------------------------------
+// File and Version Information:
+// 	$Id$
+//
+// Description:
+//	Test suite case for DgramQueue.
+//
+//------------------------------------------------------------------------
+
+//---------------
+// C++ Headers --
+//---------------
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+//-------------------------------
+// Collaborating Class Headers --
+//-------------------------------
+#include "XtcInput/DgramQueue.h"
+#include "pdsdata/xtc/Dgram.hh"
+
+using namespace XtcInput ;
+
+#define BOOST_TEST_MODULE DgramQueue
+#include <boost/test/included/unit_test.hpp>
+
+/**
+ * Simple test suite for module DgramQueue.
+ * See http://www.boost.org/doc/libs/1_36_0/libs/test/doc/html/index.html
+ */
+
+namespace {
+
+  // L1Accept (or other transition) with the given fiducials and clock seconds
+  Dgram makeDgram(unsigned fid, Pds::TransitionId::Value service = Pds::TransitionId::L1Accept,
+                  unsigned sec = 1000)
+  {
+    char* buf = new char[sizeof(Pds::Dgram)];
+    std::fill_n(buf, sizeof(Pds::Dgram), '\0');
+    Pds::Dgram* dg = (Pds::Dgram*)buf;
+    dg->seq = Pds::Sequence(Pds::Sequence::Event, service,
+                            Pds::ClockTime(sec, fid), Pds::TimeStamp(0, fid, 0));
+    dg->xtc.extent = sizeof(Pds::Xtc);
+    return Dgram(Dgram::make_ptr(dg), XtcFileName("/tmp", "e1", 1, 0, 0, false));
+  }
+
+  unsigned fiducials(const Dgram& dg) { return dg.dg()->seq.stamp().fiducials(); }
+
+  void produce(DgramQueue* queue, unsigned count)
+  {
+    for (unsigned i = 0; i != count; ++ i) queue->push(makeDgram(i));
+    queue->push(Dgram());
+  }
+
+  // event of size dgrams at a time, fiducials keep counting
+  void produceEvents(DgramQueue* queue, unsigned count, unsigned size)
+  {
+    unsigned fid = 0;
+    for (unsigned i = 0; i != count; ++ i) {
+      DgramList event;
+      for (unsigned d = 0; d != size; ++ d) {
+        event.push_back(makeDgram(fid ++));
+      }
+      queue->pushEvent(event);
+    }
+    queue->push(Dgram());
+  }
+
+  // batches of size dgrams, fiducials keep counting
+  void produceBatches(DgramQueue* queue, unsigned count, unsigned size)
+  {
+    unsigned fid = 0;
+    std::vector<Dgram> batch;
+    for (unsigned i = 0; i != count; ++ i) {
+      batch.clear();
+      for (unsigned d = 0; d != size; ++ d) batch.push_back(makeDgram(fid ++));
+      queue->pushBatch(batch);
+    }
+    queue->push(Dgram());
+  }
+
+  void fillAndBlock(DgramQueue* queue, bool* interrupted)
+  {
+    try {
+      for (unsigned i = 0; ; ++ i) queue->push(makeDgram(i));
+    } catch (const boost::thread_interrupted&) {
+      *interrupted = true;
+    }
+  }
+
+}
+
+// ==============================================================
+
+BOOST_AUTO_TEST_CASE( test_fifo_threads )
+{
+  // ring wraps around many times, consumer and producer both wait
+  DgramQueue queue(5);
+  const unsigned count = 100000;
+  boost::thread producer(boost::bind(&produce, &queue, count));
+
+  unsigned next = 0;
+  for (Dgram dg = queue.pop(); not dg.empty(); dg = queue.pop()) {
+    if (fiducials(dg) != next) BOOST_ERROR("datagram out of order: " << fiducials(dg) << " " << next);
+    ++ next;
+  }
+  producer.join();
+  BOOST_CHECK_EQUAL(next, count);
+}
+
+BOOST_AUTO_TEST_CASE( test_push_event )
+{
+  // events of 3 fit, events of 11 go in parts
+  unsigned sizes[] = { 3, 11 };
+  for (unsigned s = 0; s != 2; ++ s) {
+    DgramQueue queue(8);
+    const unsigned count = 10000;
+    boost::thread producer(boost::bind(&produceEvents, &queue, count, sizes[s]));
+
+    unsigned next = 0;
+    for (Dgram dg = queue.pop(); not dg.empty(); dg = queue.pop()) {
+      if (fiducials(dg) != next) BOOST_ERROR("datagram out of order: " << fiducials(dg) << " " << next);
+      ++ next;
+    }
+    producer.join();
+    BOOST_CHECK_EQUAL(next, count*sizes[s]);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( test_batch_threads )
+{
+  // batches of 4 from the producer, consumer takes up to 7 at a time
+  DgramQueue queue(16);
+  const unsigned count = 20000;
+  boost::thread producer(boost::bind(&produceBatches, &queue, count, 4));
+
+  unsigned next = 0;
+  std::vector<Dgram> batch;
+  bool eod = false;
+  while (not eod) {
+    const size_t n = queue.popBatch(batch, 7);
+    BOOST_REQUIRE(n >= 1 and n <= 7);
+    BOOST_REQUIRE_EQUAL(batch.size(), n);
+    for (size_t i = 0; i != n; ++ i) {
+      if (batch[i].empty()) {
+        eod = true;
+        break;
+      }
+      if (fiducials(batch[i]) != next) BOOST_ERROR("datagram out of order: " << fiducials(batch[i]) << " " << next);
+      ++ next;
+    }
+  }
+  producer.join();
+  BOOST_CHECK_EQUAL(next, count*4);
+}
+
+BOOST_AUTO_TEST_CASE( test_peek_and_timeout )
+{
+  DgramQueue queue(8);
+  std::vector<Dgram> window;
+  BOOST_CHECK_EQUAL(queue.peek(window, 3), 0U);
+  BOOST_CHECK_EQUAL(queue.popBatch(window, 3, 0), 0U);
+  BOOST_CHECK_EQUAL(queue.popBatch(window, 3, 20), 0U);
+
+  for (unsigned i = 0; i != 5; ++ i) queue.push(makeDgram(i));
+
+  // peek does not remove anything
+  BOOST_CHECK_EQUAL(queue.peek(window, 3), 3U);
+  BOOST_CHECK_EQUAL(fiducials(window[2]), 2U);
+  BOOST_CHECK_EQUAL(queue.peek(window, 10), 5U);
+  BOOST_CHECK_EQUAL(fiducials(queue.front()), 0U);
+
+  BOOST_CHECK_EQUAL(queue.popBatch(window, 2, 0), 2U);
+  BOOST_CHECK_EQUAL(fiducials(window[1]), 1U);
+  BOOST_CHECK_EQUAL(queue.popBatch(window, 10), 3U);
+  BOOST_CHECK_EQUAL(fiducials(window[2]), 4U);
+
+  queue.push_exception("read failed");
+  BOOST_CHECK_THROW(queue.popBatch(window, 10), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE( test_byte_limit )
+{
+  // room for three datagrams by size, ten by count
+  const size_t dgSize = sizeof(Pds::Dgram);
+  DgramQueue queue(10, 3*dgSize);
+  BOOST_CHECK_EQUAL(queue.maxBytes(), 3*dgSize);
+  for (unsigned i = 0; i != 3; ++ i) queue.push(makeDgram(i));
+  BOOST_CHECK_EQUAL(queue.bytes(), 3*dgSize);
+
+  // fourth one waits for pop()
+  boost::thread producer(boost::bind(&produce, &queue, 1));
+  boost::this_thread::sleep(boost::posix_time::milliseconds(50));
+  BOOST_CHECK_EQUAL(queue.bytes(), 3*dgSize);
+  BOOST_CHECK_EQUAL(fiducials(queue.pop()), 0U);
+  BOOST_CHECK_EQUAL(fiducials(queue.pop()), 1U);
+  producer.join();
+
+  // end of data has no size
+  BOOST_CHECK_EQUAL(queue.bytes(), 2*dgSize);
+  BOOST_CHECK_EQUAL(queue.peakBytes(), 3*dgSize);
+  std::vector<Dgram> batch;
+  BOOST_CHECK_EQUAL(queue.popBatch(batch, 10), 3U);
+  BOOST_CHECK_EQUAL(queue.bytes(), 0U);
+
+  // datagram larger than the limit goes into empty queue
+  DgramQueue small(10, 1);
+  small.push(makeDgram(5));
+  BOOST_CHECK_EQUAL(small.bytes(), dgSize);
+  small.clear();
+  BOOST_CHECK_EQUAL(small.bytes(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE( test_front_and_exception )
+{
+  DgramQueue queue(4);
+  queue.push(makeDgram(1));
+  queue.push(makeDgram(2));
+  queue.push_exception("read failed");
+
+  // datagrams before the exception are returned first
+  BOOST_CHECK_EQUAL(fiducials(queue.front()), 1U);
+  BOOST_CHECK_EQUAL(fiducials(queue.pop()), 1U);
+  BOOST_CHECK_EQUAL(fiducials(queue.pop()), 2U);
+  BOOST_CHECK_THROW(queue.pop(), std::runtime_error);
+
+  // exception is reported once
+  queue.push(makeDgram(3));
+  BOOST_CHECK_EQUAL(fiducials(queue.pop()), 3U);
+}
+
+BOOST_AUTO_TEST_CASE( test_clear_and_interrupt )
+{
+  // producer blocks on the full queue until interrupted
+  DgramQueue queue(16);
+  bool interrupted = false;
+  boost::thread producer(boost::bind(&fillAndBlock, &queue, &interrupted));
+  producer.interrupt();
+  producer.join();
+  BOOST_CHECK(interrupted);
+
+  // this is what DgramReader does after interruption, push must not block
+  queue.clear();
+  queue.push(Dgram());
+  BOOST_CHECK(queue.pop().empty());
+}
+
+BOOST_AUTO_TEST_CASE( test_move )
+{
+  // datagram and reference count in one block
+  const Dgram src = makeDgram(7);
+  Dgram::ptr buf = Dgram::allocate(sizeof(Pds::Dgram));
+  std::copy((const char*)src.dg().get(), (const char*)src.dg().get() + sizeof(Pds::Dgram), (char*)buf.get());
+  Dgram dg(buf, XtcFileName("/tmp", "e1", 1, 0, 0, false));
+  buf.reset();
+  BOOST_CHECK_EQUAL(dg.dg().use_count(), 1);
+
+  // nobody keeps a copy on the way through the queue and the event
+  DgramQueue queue(10);
+  queue.push(std::move(dg));
+  BOOST_CHECK(dg.empty());
+  Dgram out = queue.pop();
+  BOOST_CHECK_EQUAL(out.dg().use_count(), 1);
+  BOOST_CHECK_EQUAL(fiducials(out), 7U);
+
+  DgramList event;
+  event.push_back(std::move(out));
+  BOOST_CHECK(out.empty());
+  queue.pushEvent(std::move(event));
+  std::vector<Dgram> batch;
+  BOOST_CHECK_EQUAL(queue.popBatch(batch, 10), 1U);
+  BOOST_CHECK_EQUAL(batch[0].dg().use_count(), 1);
+  BOOST_CHECK_EQUAL(batch[0].file().run(), 1U);
+}
+
+BOOST_AUTO_TEST_CASE( test_drop_l1accepts )
+{
+  DgramQueue queue(4, 0, DgramQueue::DropOldL1Accepts);
+  BOOST_CHECK_EQUAL(queue.overflowPolicy(), DgramQueue::DropOldL1Accepts);
+  queue.push(makeDgram(100, Pds::TransitionId::BeginCalibCycle));
+  queue.push(makeDgram(1));
+  queue.push(makeDgram(2));
+  queue.push(makeDgram(101, Pds::TransitionId::Enable));
+
+  // full queue, oldest L1Accept goes
+  queue.push(makeDgram(3));
+  BOOST_CHECK_EQUAL(queue.droppedEvents(), 1U);
+  BOOST_CHECK_EQUAL(queue.droppedDgrams(), 1U);
+
+  // event of two datagrams needs two slots
+  DgramList event;
+  event.push_back(makeDgram(4));
+  event.push_back(makeDgram(4));
+  queue.pushEvent(std::move(event));
+  BOOST_CHECK_EQUAL(queue.droppedEvents(), 3U);
+  BOOST_CHECK_EQUAL(queue.droppedDgrams(), 3U);
+
+  // whole event is dropped for one slot
+  queue.push(makeDgram(5));
+  BOOST_CHECK_EQUAL(queue.droppedEvents(), 4U);
+  BOOST_CHECK_EQUAL(queue.droppedDgrams(), 5U);
+
+  // more of a dropped event is dropped as well
+  queue.push(makeDgram(102, Pds::TransitionId::Disable));
+  queue.push(makeDgram(103, Pds::TransitionId::EndCalibCycle));
+  queue.push(makeDgram(5));
+  BOOST_CHECK_EQUAL(queue.droppedEvents(), 5U);
+  BOOST_CHECK_EQUAL(queue.droppedDgrams(), 7U);
+  BOOST_CHECK_EQUAL(queue.bytes(), 4*sizeof(Pds::Dgram));
+
+  // only transitions in the queue, producer waits
+  void (DgramQueue::*push)(const Dgram&) = &DgramQueue::push;
+  boost::thread producer(boost::bind(push, &queue, makeDgram(6)));
+  boost::this_thread::sleep(boost::posix_time::milliseconds(50));
+  BOOST_CHECK_EQUAL(queue.droppedDgrams(), 7U);
+
+  // transitions come out in their order
+  const unsigned expected[] = { 100, 101, 102, 103, 6 };
+  for (unsigned i = 0; i != 5; ++ i) BOOST_CHECK_EQUAL(fiducials(queue.pop()), expected[i]);
+  producer.join();
+  BOOST_CHECK_EQUAL(queue.bytes(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE( test_drop_multi_stream )
+{
+  // three streams with different clocks, events are matched on fiducials
+  const Pds::TransitionId::Value L1 = Pds::TransitionId::L1Accept;
+  const unsigned clocks[] = { 1000, 1010, 990 };
+  DgramQueue queue(4, 0, DgramQueue::DropOldL1Accepts);
+  for (unsigned s = 0; s != 3; ++ s) queue.push(makeDgram(1, L1, clocks[s]));
+  queue.push(makeDgram(2, L1, clocks[0]));
+
+  // whole event goes, not only the datagram of the first stream
+  queue.push(makeDgram(2, L1, clocks[1]));
+  BOOST_CHECK_EQUAL(queue.droppedEvents(), 1U);
+  BOOST_CHECK_EQUAL(queue.droppedDgrams(), 3U);
+  queue.push(makeDgram(2, L1, clocks[2]));
+  BOOST_CHECK_EQUAL(queue.droppedDgrams(), 3U);
+
+  // rest of an event dropped to make space for it is dropped as well
+  queue.push(makeDgram(100, Pds::TransitionId::Disable));
+  queue.push(makeDgram(101, Pds::TransitionId::EndCalibCycle));
+  BOOST_CHECK_EQUAL(queue.droppedEvents(), 2U);
+  BOOST_CHECK_EQUAL(queue.droppedDgrams(), 6U);
+  for (unsigned s = 0; s != 3; ++ s) queue.push(makeDgram(3, L1, clocks[s]));
+  BOOST_CHECK_EQUAL(queue.droppedEvents(), 3U);
+  BOOST_CHECK_EQUAL(queue.droppedDgrams(), 9U);
+  queue.push(makeDgram(4, L1, clocks[0]));
+  BOOST_CHECK_EQUAL(queue.droppedDgrams(), 9U);
+
+  // consumer never sees a partial event
+  const unsigned expected[] = { 100, 101, 4 };
+  for (unsigned i = 0; i != 3; ++ i) BOOST_CHECK_EQUAL(fiducials(queue.pop()), expected[i]);
+  BOOST_CHECK_EQUAL(queue.bytes(), 0U);
+}
@@ -0,0 +1,165 @@
+//--------------------------------------------------------------------------
+// File and Version Information:
+// 	$Id$
+//
+// Description:
+//	Test suite case for EventFanOut and OrderedSink.
+//
+//------------------------------------------------------------------------
+
+//---------------
+// C++ Headers --
+//---------------
+#include <algorithm>
+#include <set>
+#include <stdexcept>
+#include <vector>
+#include <unistd.h>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+//-------------------------------
+// Collaborating Class Headers --
+//-------------------------------
+#include "XtcInput/EventFanOut.h"
+#include "XtcInput/OrderedSink.h"
+#include "pdsdata/xtc/Dgram.hh"
+
+using namespace XtcInput ;
+
+#define BOOST_TEST_MODULE EventFanOut
+#include <boost/test/included/unit_test.hpp>
+
+/**
+ * Simple test suite for module EventFanOut.
+ * See http://www.boost.org/doc/libs/1_36_0/libs/test/doc/html/index.html
+ */
+
+namespace {
+
+  Dgram makeDgram(Pds::TransitionId::Value tran, unsigned fid, int stream)
+  {
+    char* buf = new char[sizeof(Pds::Dgram)];
+    std::fill_n(buf, sizeof(Pds::Dgram), '\0');
+    Pds::Dgram* dg = (Pds::Dgram*)buf;
+    dg->seq = Pds::Sequence(Pds::Sequence::Event, tran, Pds::ClockTime(1000, fid), Pds::TimeStamp(0, fid, 0));
+    dg->xtc.extent = sizeof(Pds::Xtc);
+    return Dgram(Dgram::make_ptr(dg), XtcFileName("/tmp", "e1", 1, stream, 0, false));
+  }
+
+  void append(std::vector<uint64_t>* vec, uint64_t value) { vec->push_back(value); }
+
+  // two streams, two calib cycles with nL1 events each, end of data at the end
+  void produce(DgramQueue* queue, int nL1)
+  {
+    Pds::TransitionId::Value before[] = { Pds::TransitionId::Configure, Pds::TransitionId::BeginRun };
+    for (int i = 0; i != 2; ++ i) {
+      queue->push(makeDgram(before[i], 0, 0));
+      queue->push(makeDgram(before[i], 0, 1));
+    }
+    unsigned fid = 0;
+    for (int cycle = 0; cycle != 2; ++ cycle) {
+      queue->push(makeDgram(Pds::TransitionId::BeginCalibCycle, 0, 0));
+      queue->push(makeDgram(Pds::TransitionId::BeginCalibCycle, 0, 1));
+      for (int i = 0; i != nL1; ++ i, fid += 3) {
+        queue->push(makeDgram(Pds::TransitionId::L1Accept, fid, 0));
+        queue->push(makeDgram(Pds::TransitionId::L1Accept, fid, 1));
+      }
+      queue->push(makeDgram(Pds::TransitionId::EndCalibCycle, 0, 0));
+      queue->push(makeDgram(Pds::TransitionId::EndCalibCycle, 0, 1));
+    }
+    queue->push(Dgram());
+  }
+
+  struct Analysis {
+    Analysis() : mutex(), l1Done(), transitions(), barrierOk(true), sink(boost::bind(&Analysis::write, this, _1, _2)), written() {}
+
+    void process(const DgramList& event, uint64_t seq, unsigned worker) {
+      if (event.size() != 2) throw std::runtime_error("event is not complete");
+      if (event.frontDg()->seq.service() == Pds::TransitionId::L1Accept) {
+        usleep((seq * 7919) % 500);
+        {
+          boost::mutex::scoped_lock lock(mutex);
+          l1Done.insert(seq);
+        }
+        sink.put(seq, seq);
+      } else {
+        // exactly the L1Accepts before the transition are finished
+        boost::mutex::scoped_lock lock(mutex);
+        transitions.insert(seq);
+        if (l1Done.size() != seq + 1 - transitions.size()) barrierOk = false;
+        if (not l1Done.empty() and *l1Done.rbegin() > seq) barrierOk = false;
+        lock.unlock();
+        if (worker == 0) sink.skip(seq);
+      }
+    }
+
+    void write(uint64_t seq, uint64_t value) { written.push_back(value); }
+
+    boost::mutex mutex;
+    std::set<uint64_t> l1Done;
+    std::set<uint64_t> transitions;
+    bool barrierOk;
+    OrderedSink<uint64_t> sink;
+    std::vector<uint64_t> written;
+  };
+
+}
+
+// ==============================================================
+
+BOOST_AUTO_TEST_CASE( test_ordered_sink )
+{
+  std::vector<uint64_t> written;
+  OrderedSink<uint64_t> sink(boost::bind(&append, &written, _2));
+  sink.put(2, 2);
+  sink.put(1, 1);
+  BOOST_CHECK(written.empty());
+  BOOST_CHECK_EQUAL(sink.pending(), 2U);
+  sink.skip(0);
+  sink.put(4, 4);
+  sink.skip(3);
+  BOOST_REQUIRE_EQUAL(written.size(), 3U);
+  BOOST_CHECK_EQUAL(written[0], 1U);
+  BOOST_CHECK_EQUAL(written[2], 4U);
+  BOOST_CHECK_EQUAL(sink.next(), 5U);
+}
+
+BOOST_AUTO_TEST_CASE( test_fan_out )
+{
+  const int nL1 = 300;
+  DgramQueue queue(16);
+  boost::thread producer(boost::bind(&produce, &queue, nL1));
+
+  Analysis analysis;
+  EventFanOut fanOut(queue, 4, boost::bind(&Analysis::process, &analysis, _1, _2, _3));
+  uint64_t nEvents = fanOut.run();
+  producer.join();
+
+  // Configure, BeginRun, 2 * (BeginCalibCycle, nL1, EndCalibCycle)
+  BOOST_CHECK_EQUAL(nEvents, uint64_t(2 + 2*(nL1+2)));
+  BOOST_CHECK_EQUAL(analysis.l1Done.size(), size_t(2*nL1));
+  BOOST_CHECK(analysis.barrierOk);
+  BOOST_REQUIRE_EQUAL(analysis.written.size(), size_t(2*nL1));
+  BOOST_CHECK(std::adjacent_find(analysis.written.begin(), analysis.written.end(), 
+                                 std::greater_equal<uint64_t>()) == analysis.written.end());
+}
+
+namespace {
+  void failAt(const DgramList& event, uint64_t seq, unsigned worker) {
+    if (seq == 50) throw std::runtime_error("worker failed");
+  }
+}
+
+BOOST_AUTO_TEST_CASE( test_worker_error )
+{
+  DgramQueue queue(16);
+  boost::thread producer(boost::bind(&produce, &queue, 100));
+
+  EventFanOut fanOut(queue, 3, &failAt);
+  BOOST_CHECK_THROW(fanOut.run(), std::runtime_error);
+
+  // let producer finish
+  while (not queue.pop().empty()) {}
+  producer.join();
+}
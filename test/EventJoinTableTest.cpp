@@ -0,0 +1,126 @@
+//--------------------------------------------------------------------------
+// File and Version Information:
+// 	$Id$
+//
+// Description:
+//	Test suite case for EventJoinTable.
+//
+//------------------------------------------------------------------------
+
+//---------------
+// C++ Headers --
+//---------------
+#include <algorithm>
+#include <vector>
+
+//-------------------------------
+// Collaborating Class Headers --
+//-------------------------------
+#include "XtcInput/EventJoinTable.h"
+#include "pdsdata/xtc/Dgram.hh"
+
+using namespace XtcInput ;
+
+#define BOOST_TEST_MODULE EventJoinTable
+#include <boost/test/included/unit_test.hpp>
+
+/**
+ * Simple test suite for module EventJoinTable.
+ * See http://www.boost.org/doc/libs/1_36_0/libs/test/doc/html/index.html
+ */
+
+namespace {
+
+  StreamDgram makeDgram(Pds::TransitionId::Value tran, unsigned sec, unsigned fid, int64_t block, int stream)
+  {
+    char* buf = new char[sizeof(Pds::Dgram)];
+    std::fill_n(buf, sizeof(Pds::Dgram), '\0');
+    Pds::Dgram* dg = (Pds::Dgram*)buf;
+    dg->seq = Pds::Sequence(Pds::Sequence::Event, tran, Pds::ClockTime(sec, 0), Pds::TimeStamp(0, fid, 0));
+    dg->xtc.extent = sizeof(Pds::Xtc);
+    return StreamDgram(Dgram(Dgram::make_ptr(dg), XtcFileName("/tmp", "e1", 1, stream, 0, false)),
+                       StreamDgram::DAQ, block, stream);
+  }
+
+  // feed streams into the table the same way XtcStreamMerger does
+  std::vector<DgramList> join(const std::vector<std::vector<StreamDgram> >& streams)
+  {
+    EventJoinTable table;
+    std::vector<unsigned> pos(streams.size(), 0);
+    for (unsigned s = 0; s != streams.size(); ++ s) table.addStream();
+
+    std::vector<DgramList> events;
+    while (true) {
+      while (not table.ready()) {
+        int slot = table.laggard();
+        if (slot < 0) break;
+        if (pos[slot] == streams[slot].size()) {
+          table.streamDone(slot);
+        } else {
+          table.add(slot, streams[slot][pos[slot]++]);
+        }
+      }
+      DgramList event = table.pop();
+      if (event.size() == 0) break;
+      events.push_back(event);
+    }
+    return events;
+  }
+
+}
+
+// ==============================================================
+
+BOOST_AUTO_TEST_CASE( test_unwrap )
+{
+  EventJoinTable table;
+  const unsigned maxFid = Pds::TimeStamp::MaxFiducials;
+
+  int64_t first = table.unwrapFiducials(1000, maxFid - 3);
+  BOOST_CHECK_EQUAL(first, int64_t(maxFid - 3));
+
+  // wraps forward
+  BOOST_CHECK_EQUAL(table.unwrapFiducials(1000, 3), int64_t(maxFid + 3));
+
+  // clock 150 seconds behind, fiducials from before the wrap
+  BOOST_CHECK_EQUAL(table.unwrapFiducials(850, maxFid - 6), int64_t(maxFid - 6));
+
+  // one full cycle later
+  BOOST_CHECK_EQUAL(table.unwrapFiducials(850 + 364, maxFid - 6), int64_t(2*maxFid - 6));
+}
+
+BOOST_AUTO_TEST_CASE( test_join_skewed )
+{
+  // two streams with clocks 100 seconds apart, events across the fiducial wrap,
+  // stream 1 misses one event
+  const unsigned maxFid = Pds::TimeStamp::MaxFiducials;
+  std::vector<std::vector<StreamDgram> > streams(2);
+  for (int s = 0; s != 2; ++ s) {
+    unsigned sec = 1000 + 100*s;
+    streams[s].push_back(makeDgram(Pds::TransitionId::Configure, sec, 0, 0, s));
+    streams[s].push_back(makeDgram(Pds::TransitionId::BeginCalibCycle, sec, 0, 0, s));
+    for (unsigned i = 0; i != 6; ++ i) {
+      if (s == 1 and i == 2) continue;
+      unsigned fid = (maxFid - 9 + 3*i) % maxFid;
+      streams[s].push_back(makeDgram(Pds::TransitionId::L1Accept, sec, fid, 0, s));
+    }
+    streams[s].push_back(makeDgram(Pds::TransitionId::EndCalibCycle, sec + 1, 0, 1, s));
+  }
+
+  std::vector<DgramList> events = join(streams);
+  BOOST_REQUIRE_EQUAL(events.size(), 9u);
+
+  BOOST_CHECK_EQUAL(events[0].frontDg()->seq.service(), Pds::TransitionId::Configure);
+  BOOST_CHECK_EQUAL(events[1].frontDg()->seq.service(), Pds::TransitionId::BeginCalibCycle);
+  for (unsigned i = 0; i != 6; ++ i) {
+    const DgramList& ev = events[2+i];
+    BOOST_CHECK_EQUAL(ev.size(), i == 2 ? 1u : 2u);
+    unsigned fid = (maxFid - 9 + 3*i) % maxFid;
+    const DgramList::DgramListImpl dgs = ev.getDgrams();
+    for (unsigned d = 0; d != dgs.size(); ++ d) {
+      BOOST_CHECK_EQUAL(dgs[d]->seq.stamp().fiducials(), fid);
+    }
+  }
+  BOOST_CHECK_EQUAL(events[8].frontDg()->seq.service(), Pds::TransitionId::EndCalibCycle);
+  BOOST_CHECK_EQUAL(events[8].size(), 2u);
+}
@@ -0,0 +1,132 @@
+//--------------------------------------------------------------------------
+// File and Version Information:
+// 	$Id$
+//
+// Description:
+//	Test suite case for the LoserTree.
+//
+//------------------------------------------------------------------------
+
+//---------------
+// C++ Headers --
+//---------------
+#include <functional>
+#include <queue>
+#include <string>
+#include <vector>
+#include <cstdlib>
+
+//-------------------------------
+// Collaborating Class Headers --
+//-------------------------------
+#include "XtcInput/LoserTree.h"
+
+using namespace XtcInput ;
+
+#define BOOST_TEST_MODULE LoserTree
+#include <boost/test/included/unit_test.hpp>
+
+/**
+ * Simple test suite for module LoserTree.
+ * See http://www.boost.org/doc/libs/1_36_0/libs/test/doc/html/index.html
+ */
+
+namespace {
+
+  // merge k sorted sequences with both a priority queue and a loser tree,
+  // value -1 marks the end of a sequence and sorts last
+  struct EndLastGreater {
+    bool operator()(const std::pair<int,int>& a, const std::pair<int,int>& b) const {
+      if (a.first < 0) return b.first >= 0;
+      if (b.first < 0) return false;
+      return a.first > b.first;
+    }
+  };
+
+  void checkMerge(unsigned k, unsigned n)
+  {
+    std::vector<std::vector<int> > inputs(k);
+    for (unsigned s = 0; s != k; ++ s) {
+      int value = 0;
+      for (unsigned i = 0; i != n; ++ i) {
+        value += std::rand() % 10;
+        inputs[s].push_back(value);
+      }
+      inputs[s].push_back(-1);
+    }
+
+    // slot value is (value, stream)
+    typedef std::pair<int,int> Item;
+    std::priority_queue<Item, std::vector<Item>, EndLastGreater> queue;
+    LoserTree<Item, EndLastGreater> tree;
+    std::vector<unsigned> posQueue(k, 1), posTree(k, 1);
+    for (unsigned s = 0; s != k; ++ s) {
+      queue.push(Item(inputs[s][0], s));
+      tree.push(Item(inputs[s][0], s));
+    }
+    BOOST_CHECK_EQUAL(tree.size(), k);
+
+    for (unsigned count = 0; count != k*n; ++ count) {
+      Item q = queue.top();
+      queue.pop();
+      Item t = tree.top();
+      BOOST_CHECK_EQUAL(tree.topSlot(), unsigned(t.second));
+      // equal values may come from different streams
+      BOOST_CHECK_EQUAL(q.first, t.first);
+      queue.push(Item(inputs[q.second][posQueue[q.second]++], q.second));
+      tree.replaceTop(Item(inputs[t.second][posTree[t.second]++], t.second));
+    }
+    BOOST_CHECK_EQUAL(queue.top().first, -1);
+    BOOST_CHECK_EQUAL(tree.top().first, -1);
+  }
+
+}
+
+// ==============================================================
+
+BOOST_AUTO_TEST_CASE( test_single )
+{
+  LoserTree<int, std::greater<int> > tree;
+  BOOST_CHECK(tree.empty());
+  tree.push(5);
+  BOOST_CHECK_EQUAL(tree.top(), 5);
+  tree.replaceTop(7);
+  BOOST_CHECK_EQUAL(tree.top(), 7);
+  BOOST_CHECK_EQUAL(tree.topSlot(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE( test_order )
+{
+  LoserTree<int, std::greater<int> > tree;
+  tree.push(30);
+  tree.push(10);
+  tree.push(20);
+  BOOST_CHECK_EQUAL(tree.top(), 10);
+  BOOST_CHECK_EQUAL(tree.topSlot(), 1u);
+  tree.replaceTop(40);
+  BOOST_CHECK_EQUAL(tree.top(), 20);
+  tree.replaceTop(25);
+  BOOST_CHECK_EQUAL(tree.top(), 25);
+  tree.replaceTop(50);
+  BOOST_CHECK_EQUAL(tree.top(), 30);
+}
+
+BOOST_AUTO_TEST_CASE( test_exchange )
+{
+  LoserTree<std::string, std::greater<std::string> > tree;
+  tree.push("c");
+  tree.push("a");
+  tree.push("b");
+  BOOST_CHECK_EQUAL(tree.exchangeTop("d"), "a");
+  BOOST_CHECK_EQUAL(tree.exchangeTop("e"), "b");
+  BOOST_CHECK_EQUAL(tree.top(), "c");
+  BOOST_CHECK_EQUAL(tree.topSlot(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE( test_merge )
+{
+  // powers of two and odd sizes
+  for (unsigned k = 1; k != 18; ++ k) {
+    checkMerge(k, 50);
+  }
+}
@@ -0,0 +1,106 @@
+//--------------------------------------------------------------------------
+// File and Version Information:
+// 	$Id$
+//
+// Description:
+//	Test suite case for MemoryGovernor.
+//
+//------------------------------------------------------------------------
+
+//---------------
+// C++ Headers --
+//---------------
+#include <sstream>
+#include <boost/bind.hpp>
+
+//-------------------------------
+// Collaborating Class Headers --
+//-------------------------------
+#include "XtcInput/MemoryGovernor.h"
+
+using namespace XtcInput ;
+
+#define BOOST_TEST_MODULE MemoryGovernor
+#include <boost/test/included/unit_test.hpp>
+
+/**
+ * Simple test suite for module MemoryGovernor.
+ * See http://www.boost.org/doc/libs/1_36_0/libs/test/doc/html/index.html
+ */
+
+namespace {
+
+  size_t value(const size_t* bytes) { return *bytes; }
+
+}
+
+// ==============================================================
+
+BOOST_AUTO_TEST_CASE( test_reserve_release )
+{
+  MemoryGovernor memory(1000);
+  memory.reserve(MemoryGovernor::Prefetch, 300);
+  memory.reserve(MemoryGovernor::RunBuffer, 200);
+  BOOST_CHECK_EQUAL(memory.used(), 500U);
+  BOOST_CHECK_EQUAL(memory.used(MemoryGovernor::Prefetch), 300U);
+  BOOST_CHECK_EQUAL(memory.used(MemoryGovernor::CycleBuffer), 0U);
+
+  memory.release(MemoryGovernor::Prefetch, 300);
+  BOOST_CHECK_EQUAL(memory.used(), 200U);
+  BOOST_CHECK_EQUAL(memory.peak(), 500U);
+
+  // reserve never fails, even above the budget
+  memory.reserve(MemoryGovernor::CycleBuffer, 2000);
+  BOOST_CHECK_EQUAL(memory.used(), 2200U);
+  BOOST_CHECK_EQUAL(memory.peak(), 2200U);
+}
+
+BOOST_AUTO_TEST_CASE( test_pressure )
+{
+  MemoryGovernor memory(800);
+  BOOST_CHECK(memory.speculativeAllowed());
+  BOOST_CHECK_EQUAL(memory.scaleLimit(80), 80U);
+
+  // full limit up to half of the budget
+  memory.reserve(MemoryGovernor::Prefetch, 400);
+  BOOST_CHECK_EQUAL(memory.scaleLimit(80), 80U);
+
+  // linear down to 1/8, no speculative reading above 3/4
+  memory.reserve(MemoryGovernor::Prefetch, 200);
+  BOOST_CHECK_EQUAL(memory.scaleLimit(80), 45U);
+  BOOST_CHECK(not memory.speculativeAllowed());
+  memory.reserve(MemoryGovernor::Prefetch, 400);
+  BOOST_CHECK_EQUAL(memory.scaleLimit(80), 10U);
+
+  memory.release(MemoryGovernor::Prefetch, 1000);
+  BOOST_CHECK(memory.speculativeAllowed());
+  BOOST_CHECK_EQUAL(memory.scaleLimit(80), 80U);
+}
+
+BOOST_AUTO_TEST_CASE( test_gauge_and_no_limit )
+{
+  MemoryGovernor memory(0);
+  size_t queueBytes = 0;
+  memory.addGauge(MemoryGovernor::OutputQueue, boost::bind(&value, &queueBytes));
+
+  // nothing is limited without a budget
+  memory.reserve(MemoryGovernor::Prefetch, size_t(1) << 40);
+  BOOST_CHECK(memory.speculativeAllowed());
+  BOOST_CHECK_EQUAL(memory.scaleLimit(80), 80U);
+
+  queueBytes = 123;
+  BOOST_CHECK_EQUAL(memory.used(MemoryGovernor::OutputQueue), 123U);
+  BOOST_CHECK_EQUAL(memory.used(), (size_t(1) << 40) + 123);
+
+  std::ostringstream str;
+  str << memory;
+  BOOST_CHECK(str.str().find("output queue") != std::string::npos);
+
+  // removed gauge is not counted
+  size_t otherBytes = 7;
+  MemoryGovernor::GaugeId other = memory.addGauge(MemoryGovernor::OutputQueue, boost::bind(&value, &otherBytes));
+  BOOST_CHECK_EQUAL(memory.used(MemoryGovernor::OutputQueue), 130U);
+  memory.removeGauge(other);
+  BOOST_CHECK_EQUAL(memory.used(MemoryGovernor::OutputQueue), 123U);
+  BOOST_CHECK_EQUAL(memory.used(), (size_t(1) << 40) + 123);
+}
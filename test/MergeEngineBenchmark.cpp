@@ -0,0 +1,201 @@
+//--------------------------------------------------------------------------
+// File and Version Information:
+// 	$Id$
+//
+// Description:
+//	Class MergeEngineBenchmark...
+//
+//------------------------------------------------------------------------
+
+//-----------------
+// C/C++ Headers --
+//-----------------
+#include <algorithm>
+#include <iostream>
+#include <queue>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+//----------------------
+// Base Class Headers --
+//----------------------
+#include "AppUtils/AppBase.h"
+
+//-------------------------------
+// Collaborating Class Headers --
+//-------------------------------
+#include "AppUtils/AppCmdOpt.h"
+#include "MsgLogger/MsgLogger.h"
+#include "XtcInput/LoserTree.h"
+#include "XtcInput/StreamDgram.h"
+#include "pdsdata/xtc/Dgram.hh"
+
+//-----------------------------------------------------------------------
+// Local Macros, Typedefs, Structures, Unions and Forward Declarations --
+//-----------------------------------------------------------------------
+
+namespace {
+
+  // StreamDgramGreater which counts how many times it was called
+  class CountingGreater {
+  public:
+    CountingGreater(unsigned long* count) : m_count(count) {}
+    bool operator()(const XtcInput::StreamDgram& a, const XtcInput::StreamDgram& b) const {
+      ++ *m_count;
+      return m_greater(a, b);
+    }
+  private:
+    XtcInput::StreamDgramGreater m_greater;
+    unsigned long* m_count;
+  };
+
+  double elapsedSec(const boost::posix_time::ptime& start) {
+    return (boost::posix_time::microsec_clock::universal_time() - start).total_microseconds() / 1e6;
+  }
+
+}
+
+//		----------------------------------------
+// 		-- Public Function Member Definitions --
+//		----------------------------------------
+
+namespace XtcInput {
+
+//
+//  Application class
+//
+//  Compares the cost of merging StreamDgram's with the std::priority_queue used
+//  by XtcStreamMerger::PriorityQueueEngine against LoserTree used by
+//  XtcStreamMerger::LoserTreeEngine. Datagrams are made in memory, no I/O is done.
+//
+class MergeEngineBenchmark : public AppUtils::AppBase {
+public:
+
+  // Constructor
+  explicit MergeEngineBenchmark ( const std::string& appName ) ;
+
+  // destructor
+  ~MergeEngineBenchmark () {}
+
+protected :
+
+  /**
+   *  Main method which runs the whole application
+   */
+  virtual int runApp () ;
+
+private:
+
+  typedef std::vector<std::vector<StreamDgram> > Streams;
+
+  void makeStreams(Streams& streams, unsigned nStreams, unsigned nEvents);
+  void runQueue(const Streams& streams);
+  void runTree(const Streams& streams);
+
+  AppUtils::AppCmdOpt<unsigned> m_streamsOpt ;
+  AppUtils::AppCmdOpt<unsigned> m_eventsOpt ;
+
+};
+
+//----------------
+// Constructors --
+//----------------
+MergeEngineBenchmark::MergeEngineBenchmark ( const std::string& appName )
+  : AppUtils::AppBase( appName )
+  , m_streamsOpt( parser(), "s,streams", "number", "number of streams, def: 6", 6 )
+  , m_eventsOpt( parser(), "n,events", "number", "number of events per stream, def: 200000", 200000 )
+{
+}
+
+/**
+ *  Main method which runs the whole application
+ */
+int
+MergeEngineBenchmark::runApp ()
+{
+  Streams streams;
+  makeStreams(streams, m_streamsOpt.value(), m_eventsOpt.value());
+  runQueue(streams);
+  runTree(streams);
+  return 0 ;
+}
+
+// streams take turns on consecutive fiducials, all datagrams are made
+// before timing starts so only the merge itself is measured
+void
+MergeEngineBenchmark::makeStreams(Streams& streams, unsigned nStreams, unsigned nEvents)
+{
+  streams.assign(nStreams, std::vector<StreamDgram>());
+  for (unsigned s = 0; s != nStreams; ++ s) {
+    XtcFileName file("/tmp", "e0", 1, s, 0, false);
+    streams[s].reserve(nEvents + 1);
+    for (unsigned i = 0; i != nEvents; ++ i) {
+      unsigned fid = (i*nStreams + s) % Pds::TimeStamp::MaxFiducials;
+      unsigned sec = 1000 + (i*nStreams + s) / 360;
+      char* buf = new char[sizeof(Pds::Dgram)];
+      std::fill_n(buf, sizeof(Pds::Dgram), '\0');
+      Pds::Dgram* dg = (Pds::Dgram*)buf;
+      dg->seq = Pds::Sequence(Pds::Sequence::Event, Pds::TransitionId::L1Accept,
+                              Pds::ClockTime(sec, 0), Pds::TimeStamp(0, fid, 0));
+      dg->xtc.extent = sizeof(Pds::Xtc);
+      streams[s].push_back(StreamDgram(Dgram(Dgram::make_ptr(dg), file), StreamDgram::DAQ, 0, s));
+    }
+    // end of stream
+    streams[s].push_back(StreamDgram());
+  }
+}
+
+void
+MergeEngineBenchmark::runQueue(const Streams& streams)
+{
+  unsigned long ncmp = 0;
+  CountingGreater greater(&ncmp);
+  std::priority_queue<StreamDgram, std::vector<StreamDgram>, CountingGreater> queue(greater);
+  std::vector<unsigned> pos(streams.size(), 1);
+  for (unsigned s = 0; s != streams.size(); ++ s) queue.push(streams[s][0]);
+
+  ncmp = 0;
+  boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+  unsigned long count = 0;
+  while (not queue.top().empty()) {
+    StreamDgram dg = queue.top();
+    queue.pop();
+    int s = dg.streamId();
+    queue.push(streams[s][pos[s]++]);
+    ++ count;
+  }
+  double sec = elapsedSec(start);
+
+  std::cout << "priority_queue: " << count << " datagrams, " << sec*1e9/count << " ns/datagram, "
+            << double(ncmp)/count << " comparisons/datagram" << std::endl;
+}
+
+void
+MergeEngineBenchmark::runTree(const Streams& streams)
+{
+  unsigned long ncmp = 0;
+  CountingGreater greater(&ncmp);
+  LoserTree<StreamDgram, CountingGreater> tree(greater);
+  std::vector<unsigned> pos(streams.size(), 1);
+  for (unsigned s = 0; s != streams.size(); ++ s) tree.push(streams[s][0]);
+
+  ncmp = 0;
+  boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+  unsigned long count = 0;
+  while (not tree.top().empty()) {
+    StreamDgram dg = tree.top();
+    int s = dg.streamId();
+    tree.replaceTop(streams[s][pos[s]++]);
+    ++ count;
+  }
+  double sec = elapsedSec(start);
+
+  std::cout << "LoserTree:      " << count << " datagrams, " << sec*1e9/count << " ns/datagram, "
+            << double(ncmp)/count << " comparisons/datagram" << std::endl;
+}
+
+} // namespace XtcInput
+
+
+// this defines main()
+APPUTILS_MAIN(XtcInput::MergeEngineBenchmark)
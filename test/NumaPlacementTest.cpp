@@ -0,0 +1,92 @@
+//--------------------------------------------------------------------------
+// File and Version Information:
+// 	$Id$
+//
+// Description:
+//	Test suite case for NumaPlacement.
+//
+//------------------------------------------------------------------------
+
+//---------------
+// C++ Headers --
+//---------------
+#include <sstream>
+#include <vector>
+#include <sched.h>
+
+//-------------------------------
+// Collaborating Class Headers --
+//-------------------------------
+#include "XtcInput/Exceptions.h"
+#include "XtcInput/NumaPlacement.h"
+
+using namespace XtcInput ;
+
+#define BOOST_TEST_MODULE NumaPlacement
+#include <boost/test/included/unit_test.hpp>
+
+/**
+ * Simple test suite for module NumaPlacement.
+ * See http://www.boost.org/doc/libs/1_36_0/libs/test/doc/html/index.html
+ */
+
+// ==============================================================
+
+BOOST_AUTO_TEST_CASE( test_parse_list )
+{
+  std::vector<unsigned> cpus = NumaPlacement::parseList("0-3,8,10-11");
+  BOOST_REQUIRE_EQUAL(cpus.size(), 7U);
+  BOOST_CHECK_EQUAL(cpus[0], 0U);
+  BOOST_CHECK_EQUAL(cpus[3], 3U);
+  BOOST_CHECK_EQUAL(cpus[4], 8U);
+  BOOST_CHECK_EQUAL(cpus[6], 11U);
+
+  BOOST_CHECK(NumaPlacement::parseList("").empty());
+  BOOST_CHECK_EQUAL(NumaPlacement::parseList("5\n").size(), 1U);
+  BOOST_CHECK_EQUAL(NumaPlacement::parseList("x,3-1,2").size(), 1U);
+}
+
+BOOST_AUTO_TEST_CASE( test_policy )
+{
+  BOOST_CHECK_EQUAL(NumaPlacement::policy("none"), NumaPlacement::None);
+  BOOST_CHECK_EQUAL(NumaPlacement::policy("consumer"), NumaPlacement::ConsumerNode);
+  BOOST_CHECK_EQUAL(NumaPlacement::policy("interleave"), NumaPlacement::Interleave);
+  BOOST_CHECK_THROW(NumaPlacement::policy("local"), ArgumentException);
+
+  std::ostringstream str;
+  str << NumaPlacement::Interleave;
+  BOOST_CHECK_EQUAL(str.str(), "interleave");
+}
+
+BOOST_AUTO_TEST_CASE( test_this_machine )
+{
+  BOOST_CHECK(NumaPlacement::numNodes() >= 1);
+
+  NumaPlacement none;
+  BOOST_CHECK(not none.active());
+  BOOST_CHECK(none.applyToThread());
+
+  // consumer is this thread, its node has CPUs if the node is known
+  NumaPlacement consumer(NumaPlacement::ConsumerNode);
+  if (consumer.node() >= 0) BOOST_CHECK(not NumaPlacement::nodeCpus(consumer.node()).empty());
+  BOOST_CHECK_EQUAL(consumer.active(), NumaPlacement::numNodes() > 1);
+  if (not consumer.active()) BOOST_CHECK(consumer.applyToThread());
+}
+
+BOOST_AUTO_TEST_CASE( test_scope )
+{
+  cpu_set_t before;
+  BOOST_REQUIRE_EQUAL(sched_getaffinity(0, sizeof before, &before), 0);
+
+  // thread is back to its affinity after the scope
+  NumaPlacement consumer(NumaPlacement::ConsumerNode);
+  {
+    NumaPlacement::Scope scope(&consumer);
+  }
+  {
+    NumaPlacement::Scope scope(0);
+  }
+  cpu_set_t after;
+  BOOST_REQUIRE_EQUAL(sched_getaffinity(0, sizeof after, &after), 0);
+  BOOST_CHECK(CPU_EQUAL(&before, &after));
+}
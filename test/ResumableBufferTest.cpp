@@ -0,0 +1,151 @@
+//--------------------------------------------------------------------------
+// File and Version Information:
+// 	$Id$
+//
+// Description:
+//	Test suite case for ResumableBuffer.
+//
+//------------------------------------------------------------------------
+
+//---------------
+// C++ Headers --
+//---------------
+#include <atomic>
+#include <stdexcept>
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/thread/thread.hpp>
+
+//-------------------------------
+// Collaborating Class Headers --
+//-------------------------------
+#include "XtcInput/ResumableBuffer.h"
+
+using namespace XtcInput ;
+
+#define BOOST_TEST_MODULE ResumableBuffer
+#include <boost/test/included/unit_test.hpp>
+
+/**
+ * Simple test suite for module ResumableBuffer.
+ * See http://www.boost.org/doc/libs/1_36_0/libs/test/doc/html/index.html
+ */
+
+namespace {
+
+  // makes numbers 0 to count-1, throws after them if asked to
+  struct Counter {
+    Counter(int _count, bool _fail) : count(_count), fail(_fail), produced(0), notified(0) {}
+    bool produce(int& item) {
+      if (produced == count) {
+        if (fail) throw std::runtime_error("producer failed");
+        return false;
+      }
+      item = produced ++;
+      return true;
+    }
+    void notify() { ++ notified; }
+    int count;
+    bool fail;
+    std::atomic<int> produced;
+    std::atomic<int> notified;
+  };
+
+  size_t itemSize(const int&) { return 10; }
+
+  typedef ResumableBuffer<int> IntBuffer;
+
+  boost::shared_ptr<IntBuffer> makeBuffer(Counter& counter, size_t maxBytes,
+                                          const boost::shared_ptr<MemoryGovernor>& memory)
+  {
+    return boost::make_shared<IntBuffer>(boost::bind(&Counter::produce, &counter, _1), itemSize, maxBytes,
+                                         memory, MemoryGovernor::Prefetch, TaskScheduler::Prefetch,
+                                         boost::bind(&Counter::notify, &counter));
+  }
+
+  void waitReady(const IntBuffer& buffer)
+  {
+    while (not buffer.ready()) boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+  }
+
+}
+
+// ==============================================================
+
+BOOST_AUTO_TEST_CASE( test_all_items )
+{
+  Counter counter(100, false);
+  boost::shared_ptr<MemoryGovernor> memory = boost::make_shared<MemoryGovernor>(0);
+  boost::shared_ptr<IntBuffer> buffer = makeBuffer(counter, 50, memory);
+  buffer->start();
+  int item = -1;
+  for (int i = 0; i != 100; ++ i) {
+    BOOST_CHECK(buffer->next(item));
+    BOOST_CHECK_EQUAL(item, i);
+  }
+  BOOST_CHECK(not buffer->next(item));
+  BOOST_CHECK(not buffer->next(item));
+  BOOST_CHECK(buffer->ready());
+  BOOST_CHECK_EQUAL(memory->used(), 0U);
+  BOOST_CHECK(counter.notified > 0);
+}
+
+BOOST_AUTO_TEST_CASE( test_pause_resume )
+{
+  Counter counter(100, false);
+  boost::shared_ptr<MemoryGovernor> memory = boost::make_shared<MemoryGovernor>(0);
+  boost::shared_ptr<IntBuffer> buffer = makeBuffer(counter, 30, memory);
+
+  // task pauses when maxBytes are queued
+  buffer->start();
+  waitReady(*buffer);
+  BOOST_CHECK_EQUAL(counter.produced, 3);
+  BOOST_CHECK_EQUAL(buffer->size(), 3U);
+  BOOST_CHECK_EQUAL(memory->used(MemoryGovernor::Prefetch), 30U);
+
+  // and resumes when half of it is free
+  int item = -1;
+  BOOST_CHECK(buffer->next(item));
+  BOOST_CHECK(buffer->ready());
+  BOOST_CHECK_EQUAL(counter.produced, 3);
+  BOOST_CHECK(buffer->next(item));
+  waitReady(*buffer);
+  BOOST_CHECK_EQUAL(counter.produced, 5);
+  BOOST_CHECK_EQUAL(memory->used(MemoryGovernor::Prefetch), 30U);
+
+  // destructor stops the task and returns the memory
+  buffer.reset();
+  BOOST_CHECK_EQUAL(memory->used(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE( test_memory_pressure )
+{
+  // with no speculative reading the task pauses after the first item
+  Counter counter(100, false);
+  boost::shared_ptr<MemoryGovernor> memory = boost::make_shared<MemoryGovernor>(1000);
+  memory->reserve(MemoryGovernor::OutputQueue, 900);
+  boost::shared_ptr<IntBuffer> buffer = makeBuffer(counter, 1000, memory);
+  int item = -1;
+  BOOST_CHECK(buffer->next(item));
+  BOOST_CHECK_EQUAL(item, 0);
+  boost::this_thread::sleep(boost::posix_time::milliseconds(20));
+  BOOST_CHECK(counter.produced <= 2);
+  memory->release(MemoryGovernor::OutputQueue, 900);
+}
+
+BOOST_AUTO_TEST_CASE( test_exception )
+{
+  Counter counter(2, true);
+  boost::shared_ptr<MemoryGovernor> memory = boost::make_shared<MemoryGovernor>(0);
+  boost::shared_ptr<IntBuffer> buffer = makeBuffer(counter, 1000, memory);
+  buffer->start();
+
+  // error comes after all good items
+  int item = -1;
+  BOOST_CHECK(buffer->next(item));
+  BOOST_CHECK_EQUAL(item, 0);
+  BOOST_CHECK(buffer->next(item));
+  BOOST_CHECK_EQUAL(item, 1);
+  BOOST_CHECK_THROW(buffer->next(item), std::runtime_error);
+  BOOST_CHECK(buffer->ready());
+}
@@ -0,0 +1,189 @@
+//--------------------------------------------------------------------------
+// File and Version Information:
+// 	$Id$
+//
+// Description:
+//	Test suite case for SegmentedDgram.
+//
+//------------------------------------------------------------------------
+
+//---------------
+// C++ Headers --
+//---------------
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+//-------------------------------
+// Collaborating Class Headers --
+//-------------------------------
+#include "XtcInput/DgramQueue.h"
+#include "XtcInput/Exceptions.h"
+#include "XtcInput/SegmentedDgram.h"
+#include "XtcInput/SharedFile.h"
+#include "XtcInput/XtcChunkDgIter.h"
+#include "pdsdata/xtc/Dgram.hh"
+
+using namespace XtcInput ;
+
+#define BOOST_TEST_MODULE SegmentedDgram
+#include <boost/test/included/unit_test.hpp>
+
+/**
+ * Simple test suite for module SegmentedDgram.
+ * See http://www.boost.org/doc/libs/1_36_0/libs/test/doc/html/index.html
+ */
+
+namespace {
+
+  // datagram with children of given payload sizes, child i is filled with 'a'+i;
+  // if badChild >= 0 then extent of that child goes past the end of datagram
+  std::vector<char> makeDgram(const std::vector<size_t>& sizes, int badChild = -1)
+  {
+    std::vector<char> buf(sizeof(Pds::Dgram), '\0');
+    for (unsigned i = 0; i != sizes.size(); ++ i) {
+      std::vector<char> child(sizeof(Pds::Xtc) + sizes[i], char('a' + i));
+      Pds::Xtc* xtc = (Pds::Xtc*)&child[0];
+      std::fill_n(&child[0], sizeof(Pds::Xtc), '\0');
+      xtc->extent = child.size() + (int(i) == badChild ? 1000 : 0);
+      buf.insert(buf.end(), child.begin(), child.end());
+    }
+    Pds::Dgram* dg = (Pds::Dgram*)&buf[0];
+    dg->seq = Pds::Sequence(Pds::Sequence::Event, Pds::TransitionId::Configure,
+                            Pds::ClockTime(1000, 1), Pds::TimeStamp(0, 1, 0));
+    dg->xtc.extent = buf.size() - sizeof(Pds::Dgram) + sizeof(Pds::Xtc);
+    return buf;
+  }
+
+  std::string writeFile(const std::vector<std::vector<char> >& dgs)
+  {
+    char path[] = "/tmp/SegmentedDgramTest-XXXXXX";
+    int fd = mkstemp(path);
+    for (unsigned i = 0; i != dgs.size(); ++ i) ::write(fd, &dgs[i][0], dgs[i].size());
+    ::close(fd);
+    return path;
+  }
+
+}
+
+// ==============================================================
+
+BOOST_AUTO_TEST_CASE( test_read_segments )
+{
+  std::vector<size_t> sizes;
+  sizes.push_back(100);
+  sizes.push_back(0);
+  sizes.push_back(5000);
+  std::vector<std::vector<char> > dgs(1, makeDgram(sizes));
+  dgs.push_back(makeDgram(std::vector<size_t>(1, 10)));
+  std::string path = writeFile(dgs);
+
+  XtcChunkDgIter iter((XtcFileName(path)));
+  boost::shared_ptr<DgHeader> header = iter.next();
+  BOOST_REQUIRE(header);
+  boost::shared_ptr<const SegmentedDgram> segments = header->segmentedDgram();
+  BOOST_REQUIRE(segments);
+  BOOST_REQUIRE_EQUAL(segments->size(), 3U);
+  BOOST_CHECK(segments->complete());
+  BOOST_CHECK_EQUAL(segments->bytes(), dgs[0].size());
+  unsigned i = 0;
+  for (SegmentedDgram::const_iterator it = segments->begin(); it != segments->end(); ++ it, ++ i) {
+    BOOST_CHECK_EQUAL((*it)->sizeofPayload(), int(sizes[i]));
+    BOOST_CHECK(std::count((*it)->payload(), (*it)->payload() + sizes[i], char('a' + i)) == int(sizes[i]));
+  }
+
+  // same bytes as contiguous datagram
+  Dgram::ptr dg = header->dgram();
+  Dgram::ptr joined = segments->contiguous();
+  BOOST_CHECK(std::equal(dgs[0].begin(), dgs[0].end(), (const char*)dg.get()));
+  BOOST_CHECK(std::equal(dgs[0].begin(), dgs[0].end(), (const char*)joined.get()));
+  BOOST_CHECK(not SegmentedDgram::find(dg));
+
+  // contiguous datagram in memory is split without copy
+  DgHeader inMemory(dg, header->file(), header->offset());
+  boost::shared_ptr<const SegmentedDgram> split = inMemory.segmentedDgram();
+  BOOST_REQUIRE_EQUAL(split->size(), 3U);
+  BOOST_CHECK_EQUAL((const char*)&split->child(2), dg->xtc.payload() + 2*sizeof(Pds::Xtc) + 100);
+
+  // next datagram is still there
+  boost::shared_ptr<DgHeader> next = iter.next();
+  BOOST_REQUIRE(next);
+  BOOST_CHECK_EQUAL(next->offset(), off_t(dgs[0].size()));
+
+  std::remove(path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE( test_wrap )
+{
+  std::vector<size_t> sizes(4, 300);
+  std::vector<std::vector<char> > dgs(1, makeDgram(sizes));
+  std::string path = writeFile(dgs);
+
+  XtcChunkDgIter iter((XtcFileName(path)));
+  boost::shared_ptr<DgHeader> header = iter.next();
+  BOOST_REQUIRE(header);
+  boost::shared_ptr<const SegmentedDgram> segments = header->segmentedDgram();
+
+  // header-only datagram which finds its segments
+  Dgram::ptr stub = SegmentedDgram::wrap(segments);
+  BOOST_CHECK_EQUAL(stub->xtc.sizeofPayload(), 0);
+  BOOST_CHECK_EQUAL(stub->seq.service(), Pds::TransitionId::Configure);
+  BOOST_CHECK(SegmentedDgram::find(stub) == segments);
+
+  // header made from it has the original size
+  DgHeader copy(stub, header->file(), header->offset());
+  BOOST_CHECK_EQUAL(copy.nextOffset(), header->nextOffset());
+  BOOST_CHECK(copy.segmentedDgram() == segments);
+
+  // queue counts all segments
+  DgramQueue queue(4);
+  queue.push(Dgram(stub, XtcFileName(path)));
+  BOOST_CHECK_EQUAL(queue.bytes(), dgs[0].size());
+  segments.reset();
+  Dgram out = queue.pop();
+  BOOST_CHECK_EQUAL(SegmentedDgram::find(out.dg())->child(3).sizeofPayload(), 300);
+
+  std::remove(path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE( test_bad_extent )
+{
+  std::vector<size_t> sizes(3, 50);
+  std::vector<std::vector<char> > dgs(1, makeDgram(sizes, 1));
+  std::string path = writeFile(dgs);
+
+  XtcChunkDgIter iter((XtcFileName(path)));
+  boost::shared_ptr<DgHeader> header = iter.next();
+  BOOST_REQUIRE(header);
+  BOOST_CHECK_THROW(header->segmentedDgram(), XTCExtentException);
+
+  std::remove(path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE( test_corrupted_header )
+{
+  std::vector<std::vector<char> > dgs(1, makeDgram(std::vector<size_t>(2, 50)));
+  std::string path = writeFile(dgs);
+  SharedFile file((XtcFileName(path)));
+
+  // above the contiguous limit only when asked for segments, extent of a
+  // closed file is checked before anything is read
+  Pds::Dgram huge = *(const Pds::Dgram*)&dgs[0][0];
+  huge.xtc.extent = 300*1024*1024;
+  DgHeader hugeHeader(huge, file, 0);
+  BOOST_CHECK_THROW(hugeHeader.dgram(), XTCSizeLimitException);
+  BOOST_CHECK_THROW(hugeHeader.dgram(true), XTCExtentException);
+  BOOST_CHECK_THROW(hugeHeader.segmentedDgram(), XTCExtentException);
+
+  // extent smaller than XTC header
+  Pds::Dgram small = huge;
+  small.xtc.extent = sizeof(Pds::Xtc) - 1;
+  DgHeader smallHeader(small, file, 0);
+  BOOST_CHECK_THROW(smallHeader.dgram(), XTCSizeLimitException);
+  BOOST_CHECK_THROW(smallHeader.dgram(true), XTCExtentException);
+  BOOST_CHECK_THROW(smallHeader.segmentedDgram(), XTCExtentException);
+
+  std::remove(path.c_str());
+}
@@ -0,0 +1,75 @@
+//--------------------------------------------------------------------------
+// File and Version Information:
+// 	$Id$
+//
+// Description:
+//	Test suite case for ShardSpec.
+//
+//------------------------------------------------------------------------
+
+//---------------
+// C++ Headers --
+//---------------
+
+//-------------------------------
+// Collaborating Class Headers --
+//-------------------------------
+#include "XtcInput/ShardSpec.h"
+#include "XtcInput/Exceptions.h"
+
+using namespace XtcInput ;
+
+#define BOOST_TEST_MODULE ShardSpec
+#include <boost/test/included/unit_test.hpp>
+
+/**
+ * Simple test suite for module ShardSpec.
+ * See http://www.boost.org/doc/libs/1_36_0/libs/test/doc/html/index.html
+ */
+
+// ==============================================================
+
+BOOST_AUTO_TEST_CASE( test_default )
+{
+  ShardSpec shard;
+  BOOST_CHECK(not shard.sharded());
+  BOOST_CHECK(shard.owns(0, 0));
+  BOOST_CHECK(shard.owns(17, 12345));
+}
+
+BOOST_AUTO_TEST_CASE( test_each_event_has_one_owner )
+{
+  const unsigned size = 4;
+  for (int mode = 0; mode < 2; ++ mode) {
+    for (uint64_t block = 0; block < 10; ++ block) {
+      for (unsigned fid = 0; fid < 3000; fid += 3) {
+        unsigned owners = 0;
+        for (unsigned rank = 0; rank < size; ++ rank) {
+          if (ShardSpec(rank, size, ShardSpec::Mode(mode), 120).owns(block, fid)) ++ owners;
+        }
+        BOOST_CHECK_EQUAL(owners, 1U);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( test_blocks )
+{
+  ShardSpec byCycle(1, 3, ShardSpec::ByCalibCycle);
+  BOOST_CHECK(not byCycle.owns(0, 5));
+  BOOST_CHECK(byCycle.owns(1, 5));
+  BOOST_CHECK(byCycle.owns(4, 100000));
+
+  ShardSpec byFid(1, 2, ShardSpec::ByFiducialBlock, 360);
+  BOOST_CHECK(not byFid.owns(1, 359));
+  BOOST_CHECK(byFid.owns(0, 360));
+  BOOST_CHECK(byFid.owns(0, 719));
+  BOOST_CHECK(not byFid.owns(0, 720));
+}
+
+BOOST_AUTO_TEST_CASE( test_invalid )
+{
+  BOOST_CHECK_THROW(ShardSpec(2, 2), ArgumentException);
+  BOOST_CHECK_THROW(ShardSpec(0, 0), ArgumentException);
+  BOOST_CHECK_THROW(ShardSpec(0, 2, ShardSpec::ByFiducialBlock, 0), ArgumentException);
+}
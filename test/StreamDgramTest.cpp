@@ -0,0 +1,129 @@
+//--------------------------------------------------------------------------
+// File and Version Information:
+// 	$Id$
+//
+// Description:
+//	Test suite case for StreamDgram and StreamDgramGreater.
+//
+//------------------------------------------------------------------------
+
+//---------------
+// C++ Headers --
+//---------------
+#include <algorithm>
+#include <vector>
+
+//-------------------------------
+// Collaborating Class Headers --
+//-------------------------------
+#include "XtcInput/StreamDgram.h"
+#include "pdsdata/xtc/Dgram.hh"
+
+using namespace XtcInput ;
+
+#define BOOST_TEST_MODULE StreamDgram
+#include <boost/test/included/unit_test.hpp>
+
+/**
+ * Simple test suite for module StreamDgram.
+ * See http://www.boost.org/doc/libs/1_36_0/libs/test/doc/html/index.html
+ */
+
+namespace {
+
+  // make a datagram without payload for the given run
+  Dgram makeDgram(Pds::TransitionId::Value tran, unsigned sec, unsigned nsec, unsigned fid, unsigned run)
+  {
+    char* buf = new char[sizeof(Pds::Dgram)];
+    std::fill_n(buf, sizeof(Pds::Dgram), '\0');
+    Pds::Dgram* dg = (Pds::Dgram*)buf;
+    dg->seq = Pds::Sequence(Pds::Sequence::Event, tran, Pds::ClockTime(sec, nsec), Pds::TimeStamp(0, fid, 0));
+    dg->xtc.extent = sizeof(Pds::Xtc);
+    return Dgram(Dgram::make_ptr(dg), XtcFileName("/tmp", "e1", run, 0, 0, false));
+  }
+
+}
+
+// ==============================================================
+
+BOOST_AUTO_TEST_CASE( test_merge_key )
+{
+  StreamDgram l1(makeDgram(Pds::TransitionId::L1Accept, 1000, 5, 30, 7), StreamDgram::controlUnderDAQ, 3, 1);
+  BOOST_CHECK(l1.isL1Accept());
+  BOOST_CHECK_EQUAL(l1.mergeKey().run, 7u);
+  BOOST_CHECK_EQUAL(l1.mergeKey().block, 3);
+  BOOST_CHECK_EQUAL(l1.mergeKey().category, unsigned(StreamDgram::controlUnderDAQ));
+  BOOST_CHECK_EQUAL(l1.mergeKey().clock, (uint64_t(1000) << 32) | 5);
+  BOOST_CHECK_EQUAL(l1.mergeKey().fiducials, 30u);
+
+  StreamDgram tr(makeDgram(Pds::TransitionId::BeginCalibCycle, 1000, 5, 30, 7), StreamDgram::DAQ, 3, 0);
+  BOOST_CHECK(not tr.isL1Accept());
+  BOOST_CHECK_EQUAL(tr.mergeKey().category, unsigned(StreamDgram::NumStreamTypes));
+}
+
+BOOST_AUTO_TEST_CASE( test_greater )
+{
+  StreamDgramGreater greater;
+  StreamDgram empty;
+
+  StreamDgram trA(makeDgram(Pds::TransitionId::BeginCalibCycle, 1000, 10, 0, 1), StreamDgram::DAQ, 0, 0);
+  StreamDgram trB(makeDgram(Pds::TransitionId::BeginCalibCycle, 1000, 20, 0, 1), StreamDgram::controlUnderDAQ, 0, 1);
+  StreamDgram l1A(makeDgram(Pds::TransitionId::L1Accept, 1000, 0, 100, 1), StreamDgram::DAQ, 0, 0);
+  StreamDgram l1B(makeDgram(Pds::TransitionId::L1Accept, 1001, 0, 99, 1), StreamDgram::controlUnderDAQ, 0, 1);
+  StreamDgram endA(makeDgram(Pds::TransitionId::EndCalibCycle, 999, 0, 0, 1), StreamDgram::DAQ, 1, 0);
+  StreamDgram nextRun(makeDgram(Pds::TransitionId::L1Accept, 10, 0, 5, 2), StreamDgram::DAQ, 0, 0);
+
+  // empty datagrams go last
+  BOOST_CHECK(greater(empty, trA));
+  BOOST_CHECK(not greater(trA, empty));
+  BOOST_CHECK(not greater(empty, empty));
+
+  // transitions by clock
+  BOOST_CHECK(greater(trB, trA));
+  BOOST_CHECK(not greater(trA, trB));
+
+  // L1Accepts by fiducials, seconds are within the clock drift
+  BOOST_CHECK(greater(l1A, l1B));
+  BOOST_CHECK(not greater(l1B, l1A));
+
+  // transition vs L1Accept by block, even when the clock says otherwise
+  BOOST_CHECK(greater(l1A, trA));
+  BOOST_CHECK(greater(endA, l1A));
+  BOOST_CHECK(not greater(l1A, endA));
+
+  // run number wins over everything else
+  BOOST_CHECK(greater(nextRun, endA));
+  BOOST_CHECK(not greater(endA, nextRun));
+
+  // independent streams cannot be compared
+  StreamDgram ind(makeDgram(Pds::TransitionId::L1Accept, 1000, 0, 100, 1), StreamDgram::controlIndependent, 0, 2);
+  BOOST_CHECK_THROW(greater(ind, l1A), psana::Exception);
+  BOOST_CHECK_THROW(greater(l1A, ind), psana::Exception);
+}
+
+BOOST_AUTO_TEST_CASE( test_same_event )
+{
+  StreamDgramGreater greater;
+
+  StreamDgram l1A(makeDgram(Pds::TransitionId::L1Accept, 1000, 0, 100, 1), StreamDgram::DAQ, 0, 0);
+  StreamDgram l1B(makeDgram(Pds::TransitionId::L1Accept, 1001, 0, 100, 1), StreamDgram::controlUnderDAQ, 0, 1);
+  StreamDgram l1C(makeDgram(Pds::TransitionId::L1Accept, 1000, 0, 103, 1), StreamDgram::DAQ, 0, 1);
+  StreamDgram trA(makeDgram(Pds::TransitionId::BeginCalibCycle, 1000, 10, 0, 1), StreamDgram::DAQ, 0, 0);
+  StreamDgram trB(makeDgram(Pds::TransitionId::BeginCalibCycle, 1000, 20, 0, 1), StreamDgram::controlUnderDAQ, 0, 1);
+  StreamDgram endB(makeDgram(Pds::TransitionId::EndCalibCycle, 1000, 20, 0, 1), StreamDgram::controlUnderDAQ, 0, 1);
+
+  // L1Accepts match on fiducials within the clock drift
+  BOOST_CHECK(greater.sameEvent(l1A, l1B));
+  BOOST_CHECK(not greater.sameEvent(l1A, l1C));
+
+  // transitions match on the transition type
+  BOOST_CHECK(greater.sameEvent(trA, trB));
+  BOOST_CHECK(not greater.sameEvent(trA, endB));
+  BOOST_CHECK(not greater.sameEvent(trA, l1A));
+
+  // different block or run is never the same event
+  StreamDgram l1NextBlock(makeDgram(Pds::TransitionId::L1Accept, 1000, 0, 100, 1), StreamDgram::DAQ, 1, 1);
+  StreamDgram l1NextRun(makeDgram(Pds::TransitionId::L1Accept, 1000, 0, 100, 2), StreamDgram::DAQ, 0, 1);
+  BOOST_CHECK(not greater.sameEvent(l1A, l1NextBlock));
+  BOOST_CHECK(not greater.sameEvent(l1A, l1NextRun));
+}
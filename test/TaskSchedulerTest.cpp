@@ -0,0 +1,198 @@
+//--------------------------------------------------------------------------
+// File and Version Information:
+// 	$Id$
+//
+// Description:
+//	Test suite case for TaskScheduler.
+//
+//------------------------------------------------------------------------
+
+//---------------
+// C++ Headers --
+//---------------
+#include <stdexcept>
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/thread/condition.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+//-------------------------------
+// Collaborating Class Headers --
+//-------------------------------
+#include "XtcInput/TaskScheduler.h"
+
+using namespace XtcInput ;
+
+#define BOOST_TEST_MODULE TaskScheduler
+#include <boost/test/included/unit_test.hpp>
+
+/**
+ * Simple test suite for module TaskScheduler.
+ * See http://www.boost.org/doc/libs/1_36_0/libs/test/doc/html/index.html
+ */
+
+namespace {
+
+  // keeps the only pool thread busy until release()
+  struct Gate {
+    Gate() : open(false), entered(false) {}
+    void block() {
+      boost::mutex::scoped_lock lock(mutex);
+      entered = true;
+      cond.notify_all();
+      while (not open) cond.wait(lock);
+    }
+    void waitEntered() {
+      boost::mutex::scoped_lock lock(mutex);
+      while (not entered) cond.wait(lock);
+    }
+    void release() {
+      boost::mutex::scoped_lock lock(mutex);
+      open = true;
+      cond.notify_all();
+    }
+    bool open;
+    bool entered;
+    boost::mutex mutex;
+    boost::condition cond;
+  };
+
+  void record(boost::mutex& mutex, std::vector<int>& order, int value)
+  {
+    boost::mutex::scoped_lock lock(mutex);
+    order.push_back(value);
+  }
+
+  // records placement of the thread which runs it
+  void see(std::vector<boost::shared_ptr<const NumaPlacement> >& seen)
+  {
+    seen.push_back(TaskScheduler::placement());
+  }
+
+  // records placement and runs one more task with it
+  void submitAndSee(TaskScheduler& scheduler, std::vector<boost::shared_ptr<const NumaPlacement> >& seen)
+  {
+    see(seen);
+    scheduler.submit(boost::bind(&see, boost::ref(seen)), TaskScheduler::Normal)->wait();
+  }
+
+  void fail()
+  {
+    throw std::runtime_error("task failed");
+  }
+
+}
+
+// ==============================================================
+
+BOOST_AUTO_TEST_CASE( test_priority )
+{
+  TaskScheduler scheduler(1);
+  Gate gate;
+  boost::shared_ptr<TaskScheduler::Task> blocker =
+    scheduler.submit(boost::bind(&Gate::block, &gate), TaskScheduler::Normal);
+  gate.waitEntered();
+
+  // queued while the pool thread is busy, Live has to run first
+  boost::mutex mutex;
+  std::vector<int> order;
+  std::vector<boost::shared_ptr<TaskScheduler::Task> > tasks;
+  tasks.push_back(scheduler.submit(boost::bind(&record, boost::ref(mutex), boost::ref(order), 2), TaskScheduler::Prefetch));
+  tasks.push_back(scheduler.submit(boost::bind(&record, boost::ref(mutex), boost::ref(order), 1), TaskScheduler::Normal));
+  tasks.push_back(scheduler.submit(boost::bind(&record, boost::ref(mutex), boost::ref(order), 0), TaskScheduler::Live));
+  gate.release();
+
+  // wait() would run the tasks here, wait for the pool thread instead
+  for (unsigned i = 0; i != tasks.size(); ++ i) {
+    while (not tasks[i]->done()) boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+  }
+  blocker->wait();
+
+  BOOST_REQUIRE_EQUAL(order.size(), 3U);
+  for (int i = 0; i != 3; ++ i) BOOST_CHECK_EQUAL(order[i], i);
+}
+
+BOOST_AUTO_TEST_CASE( test_run_here_and_cancel )
+{
+  TaskScheduler scheduler(1);
+  Gate gate;
+  boost::shared_ptr<TaskScheduler::Task> blocker =
+    scheduler.submit(boost::bind(&Gate::block, &gate), TaskScheduler::Normal);
+  gate.waitEntered();
+
+  // pool thread is busy, waiting thread runs the task itself
+  boost::mutex mutex;
+  std::vector<int> order;
+  boost::shared_ptr<TaskScheduler::Task> task =
+    scheduler.submit(boost::bind(&record, boost::ref(mutex), boost::ref(order), 1), TaskScheduler::Live);
+  task->wait();
+  BOOST_CHECK(task->done());
+  BOOST_CHECK_EQUAL(order.size(), 1U);
+  BOOST_CHECK(not task->tryRun());
+
+  // cancelled task never runs
+  boost::shared_ptr<TaskScheduler::Task> cancelled =
+    scheduler.submit(boost::bind(&record, boost::ref(mutex), boost::ref(order), 2), TaskScheduler::Live);
+  BOOST_CHECK(cancelled->cancel());
+  BOOST_CHECK(cancelled->done());
+  BOOST_CHECK(not cancelled->tryRun());
+
+  gate.release();
+  blocker->wait();
+  BOOST_CHECK(not blocker->cancel());
+  BOOST_CHECK_EQUAL(order.size(), 1U);
+}
+
+BOOST_AUTO_TEST_CASE( test_exception )
+{
+  TaskScheduler scheduler(2);
+  boost::shared_ptr<TaskScheduler::Task> task = scheduler.submit(&fail, TaskScheduler::Normal);
+  BOOST_CHECK_THROW(task->wait(), std::runtime_error);
+  BOOST_CHECK(task->done());
+}
+
+BOOST_AUTO_TEST_CASE( test_many_tasks )
+{
+  // all priorities spread over several threads
+  TaskScheduler scheduler(4);
+  boost::mutex mutex;
+  std::vector<int> order;
+  std::vector<boost::shared_ptr<TaskScheduler::Task> > tasks;
+  for (int i = 0; i != 1000; ++ i) {
+    tasks.push_back(scheduler.submit(boost::bind(&record, boost::ref(mutex), boost::ref(order), i),
+                                     TaskScheduler::Priority(i % TaskScheduler::NumPriorities)));
+  }
+  for (unsigned i = 0; i != tasks.size(); ++ i) tasks[i]->wait();
+  BOOST_CHECK_EQUAL(order.size(), 1000U);
+  BOOST_CHECK(TaskScheduler::cpuQuota() >= 1);
+}
+
+BOOST_AUTO_TEST_CASE( test_placement )
+{
+  TaskScheduler scheduler(1);
+  boost::shared_ptr<const NumaPlacement> placement = boost::make_shared<NumaPlacement>(NumaPlacement::Interleave);
+  BOOST_CHECK(not TaskScheduler::placement());
+
+  std::vector<boost::shared_ptr<const NumaPlacement> > seen;
+  boost::shared_ptr<TaskScheduler::Task> task;
+  {
+    TaskScheduler::PlacementScope scope(placement);
+    BOOST_CHECK(TaskScheduler::placement() == placement);
+
+    // task and the task which it submits run with the placement
+    task = scheduler.submit(boost::bind(&submitAndSee, boost::ref(scheduler), boost::ref(seen)), TaskScheduler::Normal);
+    task->wait();
+  }
+  BOOST_CHECK(not TaskScheduler::placement());
+  BOOST_REQUIRE_EQUAL(seen.size(), 2U);
+  BOOST_CHECK(seen[0] == placement);
+  BOOST_CHECK(seen[1] == placement);
+
+  // pool thread is back to no placement for other tasks
+  task = scheduler.submit(boost::bind(&see, boost::ref(seen)), TaskScheduler::Normal);
+  task->wait();
+  BOOST_REQUIRE_EQUAL(seen.size(), 3U);
+  BOOST_CHECK(not seen[2]);
+}
@@ -0,0 +1,106 @@
+//--------------------------------------------------------------------------
+// File and Version Information:
+// 	$Id$
+//
+// Description:
+//	Test suite case for XtcFileTable.
+//
+//------------------------------------------------------------------------
+
+//---------------
+// C++ Headers --
+//---------------
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+//-------------------------------
+// Collaborating Class Headers --
+//-------------------------------
+#include "XtcInput/Dgram.h"
+#include "XtcInput/DgramList.h"
+#include "XtcInput/XtcFileTable.h"
+
+using namespace XtcInput ;
+
+#define BOOST_TEST_MODULE XtcFileTable
+#include <boost/test/included/unit_test.hpp>
+
+/**
+ * Simple test suite for module XtcFileTable.
+ * See http://www.boost.org/doc/libs/1_36_0/libs/test/doc/html/index.html
+ */
+
+namespace {
+
+  // every thread interns the same names in a different order
+  void internAll(unsigned seed, std::vector<XtcFileTable::FileId>& ids)
+  {
+    for (unsigned i = 0; i != ids.size(); ++ i) {
+      const unsigned chunk = (i * 7 + seed) % ids.size();
+      ids[chunk] = XtcFileTable::instance().intern(XtcFileName("/tmp", "e9", 5, 1, chunk, false));
+    }
+  }
+
+}
+
+// ==============================================================
+
+BOOST_AUTO_TEST_CASE( test_intern )
+{
+  XtcFileTable& table = XtcFileTable::instance();
+  BOOST_CHECK(table.name(XtcFileTable::EmptyId).empty());
+  BOOST_CHECK_EQUAL(table.intern(XtcFileName()), XtcFileTable::FileId(XtcFileTable::EmptyId));
+
+  const XtcFileName name("/dir/e1-r2-s3-c4.smd.xtc");
+  XtcFileTable::FileId id = table.intern(name);
+  BOOST_CHECK(id != XtcFileTable::EmptyId);
+  BOOST_CHECK_EQUAL(table.intern(XtcFileName("/dir/e1-r2-s3-c4.smd.xtc")), id);
+  BOOST_CHECK(table.intern(XtcFileName("/dir/e1-r2-s3-c5.smd.xtc")) != id);
+  BOOST_CHECK_EQUAL(table.name(id).path(), name.path());
+  BOOST_CHECK_EQUAL(table.name(id).run(), 2U);
+  BOOST_CHECK_EQUAL(table.name(id).chunk(), 4U);
+
+  // more names than fit into one block, old references stay valid
+  const XtcFileName& first = table.name(id);
+  for (unsigned i = 0; i != 3000; ++ i) table.intern(XtcFileName("/tmp", "e2", 1, 0, i, false));
+  BOOST_CHECK_EQUAL(&table.name(id), &first);
+  BOOST_CHECK_EQUAL(table.name(table.intern(XtcFileName("/tmp", "e2", 1, 0, 2500, false))).chunk(), 2500U);
+  BOOST_CHECK(table.size() > 3000U);
+}
+
+BOOST_AUTO_TEST_CASE( test_dgram )
+{
+  const XtcFileName name("/tmp", "e3", 7, 2, 1, false);
+  Dgram dg(Dgram::ptr(), name, 100);
+  BOOST_CHECK_EQUAL(dg.file().path(), name.path());
+  BOOST_CHECK_EQUAL(dg.file().run(), 7U);
+  BOOST_CHECK_EQUAL(Dgram(Dgram::ptr(), dg.fileId(), 200).file().path(), name.path());
+  BOOST_CHECK(Dgram().file().empty());
+
+  DgramList list;
+  list.push_back(dg);
+  list.push_back(Dgram());
+  DgramList::FileListImpl files = list.getFileNames();
+  BOOST_REQUIRE_EQUAL(files.size(), 2U);
+  BOOST_CHECK_EQUAL(files[0].path(), name.path());
+  BOOST_CHECK(files[1].empty());
+  BOOST_CHECK_EQUAL(list.fileIds()[0], dg.fileId());
+}
+
+BOOST_AUTO_TEST_CASE( test_threads )
+{
+  const unsigned nthreads = 4;
+  std::vector<std::vector<XtcFileTable::FileId> > ids(nthreads, std::vector<XtcFileTable::FileId>(500));
+  boost::thread_group threads;
+  for (unsigned t = 0; t != nthreads; ++ t) {
+    threads.create_thread(boost::bind(&internAll, t * 13, boost::ref(ids[t])));
+  }
+  threads.join_all();
+
+  // same name has same id everywhere
+  for (unsigned t = 1; t != nthreads; ++ t) BOOST_CHECK(ids[t] == ids[0]);
+  for (unsigned i = 0; i != ids[0].size(); ++ i) {
+    BOOST_CHECK_EQUAL(XtcFileTable::instance().name(ids[0][i]).chunk(), i);
+  }
+}
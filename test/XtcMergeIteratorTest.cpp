@@ -0,0 +1,306 @@
+//--------------------------------------------------------------------------
+// File and Version Information:
+// 	$Id$
+//
+// Description:
+//	Test suite case for XtcMergeIterator.
+//
+//------------------------------------------------------------------------
+
+//---------------
+// C++ Headers --
+//---------------
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <boost/make_shared.hpp>
+
+//-------------------------------
+// Collaborating Class Headers --
+//-------------------------------
+#include "XtcInput/RunFileIterList.h"
+#include "XtcInput/XtcMergeIterator.h"
+#include "pdsdata/xtc/Dgram.hh"
+
+using namespace XtcInput ;
+
+#define BOOST_TEST_MODULE XtcMergeIterator
+#include <boost/test/included/unit_test.hpp>
+
+/**
+ * Simple test suite for module XtcMergeIterator.
+ * See http://www.boost.org/doc/libs/1_36_0/libs/test/doc/html/index.html
+ */
+
+namespace {
+
+  const unsigned nRuns = 3;
+  const unsigned nCycles = 4;
+  const unsigned nL1Accepts = 40;
+  const unsigned streams[] = { 0, 1, 2, 80 };
+  const unsigned nStreams = sizeof streams / sizeof streams[0];
+
+  void writeDgram(int fd, Pds::TransitionId::Value trans, unsigned sec, unsigned nsec, unsigned fid,
+                  size_t payloadSize = 0)
+  {
+    std::vector<char> buf(sizeof(Pds::Dgram) + payloadSize, char(fid));
+    Pds::Dgram* dg = (Pds::Dgram*)&buf[0];
+    dg->seq = Pds::Sequence(Pds::Sequence::Event, trans, Pds::ClockTime(sec, nsec), Pds::TimeStamp(0, fid, 0));
+    dg->xtc.extent = sizeof(Pds::Xtc) + payloadSize;
+    ::write(fd, &buf[0], buf.size());
+  }
+
+  // Runs of three DAQ streams and control stream s80 with several calib
+  // cycles. DAQ streams 1 and 2 miss some events, control stream has every
+  // fourth one. Stream 0 has two chunks.
+  struct DataSet {
+
+    DataSet() : files()
+    {
+      char dir[] = "/tmp/XtcMergeIteratorTest-XXXXXX";
+      BOOST_REQUIRE(mkdtemp(dir));
+      m_dir = dir;
+      for (unsigned run = 1; run <= nRuns; ++ run) {
+        for (unsigned s = 0; s != nStreams; ++ s) writeStream(run, streams[s]);
+      }
+    }
+
+    ~DataSet()
+    {
+      for (unsigned i = 0; i != files.size(); ++ i) ::unlink(files[i].path().c_str());
+      ::rmdir(m_dir.c_str());
+    }
+
+    void writeStream(unsigned run, unsigned stream)
+    {
+      unsigned chunk = 0;
+      int fd = open(run, stream, chunk);
+      unsigned sec = 1000*run;
+      unsigned fid = 3000*run;
+      writeDgram(fd, Pds::TransitionId::Configure, sec, 0, 0);
+      writeDgram(fd, Pds::TransitionId::BeginRun, sec, 1, 0);
+      for (unsigned cycle = 0; cycle != nCycles; ++ cycle) {
+        if (stream == 0 and cycle == nCycles/2) {
+          ::close(fd);
+          fd = open(run, stream, ++ chunk);
+        }
+        writeDgram(fd, Pds::TransitionId::BeginCalibCycle, sec, 2, 0);
+        writeDgram(fd, Pds::TransitionId::Enable, sec, 3, 0);
+        ++ sec;
+        for (unsigned i = 0; i != nL1Accepts; ++ i, fid += 3) {
+          if (stream == 1 and i % 7 == 3) continue;
+          if (stream == 2 and i % 11 == 5) continue;
+          if (stream == 80 and i % 4 != 0) continue;
+          writeDgram(fd, Pds::TransitionId::L1Accept, sec, i*1000000, fid, 100*(i % 5));
+        }
+        writeDgram(fd, Pds::TransitionId::Disable, sec, 900000000, 0);
+        writeDgram(fd, Pds::TransitionId::EndCalibCycle, sec, 900000001, 0);
+        ++ sec;
+      }
+      writeDgram(fd, Pds::TransitionId::EndRun, sec, 0, 0);
+      writeDgram(fd, Pds::TransitionId::Unconfigure, sec, 1, 0);
+      ::close(fd);
+    }
+
+    int open(unsigned run, unsigned stream, unsigned chunk)
+    {
+      files.push_back(XtcFileName(m_dir, "e5", run, stream, chunk, false));
+      return ::open(files.back().path().c_str(), O_CREAT|O_TRUNC|O_WRONLY, 0644);
+    }
+
+    // files of one stream
+    std::vector<XtcFileName> streamFiles(unsigned stream) const
+    {
+      std::vector<XtcFileName> result;
+      for (unsigned i = 0; i != files.size(); ++ i) {
+        if (files[i].stream() == stream) result.push_back(files[i]);
+      }
+      return result;
+    }
+
+    std::vector<XtcFileName> files;
+    std::string m_dir;
+  };
+
+  // how XtcMergeIterator is made
+  struct Mode {
+    Mode() : engine(XtcStreamMerger::PriorityQueueEngine), prefetchChunks(0), pipelineRuns(false)
+           , cycleThreads(0), concurrentRuns(0), completionOrder(false) {}
+    XtcStreamMerger::MergeEngine engine;
+    unsigned prefetchChunks;
+    bool pipelineRuns;
+    unsigned cycleThreads;
+    unsigned concurrentRuns;
+    bool completionOrder;
+  };
+
+  // event keys of each run, order of datagrams inside an event is not checked
+  typedef std::vector<std::string> Keys;
+  typedef std::map<unsigned, Keys> RunKeys;
+
+  std::string key(const Pds::Dgram& dg, size_t size)
+  {
+    char buf[64];
+    snprintf(buf, sizeof buf, "%d/%u/%u", int(dg.seq.service()), dg.seq.stamp().fiducials(), unsigned(size));
+    return buf;
+  }
+
+  // header of L1Accept with given fiducials
+  Pds::Dgram l1Accept(unsigned fid)
+  {
+    Pds::Dgram dg;
+    dg.seq = Pds::Sequence(Pds::Sequence::Event, Pds::TransitionId::L1Accept, Pds::ClockTime(0, 0),
+                           Pds::TimeStamp(0, fid, 0));
+    return dg;
+  }
+
+  // read all events, runs in the order in which they are returned
+  std::vector<unsigned> readEvents(const std::vector<XtcFileName>& files, const Mode& mode, RunKeys& keys)
+  {
+    boost::shared_ptr<RunFileIterI> runIter =
+        boost::make_shared<RunFileIterList>(files.begin(), files.end(), MergeFileName);
+    XtcMergeIterator iter(runIter, 0, 80, 85, boost::shared_ptr<XtcFilesPosition>(), mode.engine,
+                          mode.prefetchChunks, mode.pipelineRuns, ShardSpec(), mode.cycleThreads,
+                          mode.concurrentRuns, mode.completionOrder);
+    std::vector<unsigned> runs;
+    while (true) {
+      DgramList event = iter.nextEvent();
+      if (event.size() == 0) break;
+      const unsigned run = event.file(0).run();
+      if (runs.empty() or runs.back() != run) runs.push_back(run);
+      keys[run].push_back(key(*event.frontDg(), event.size()));
+    }
+    return runs;
+  }
+
+  void checkSame(const RunKeys& expected, const RunKeys& keys)
+  {
+    BOOST_REQUIRE_EQUAL(keys.size(), expected.size());
+    for (RunKeys::const_iterator it = expected.begin(); it != expected.end(); ++ it) {
+      RunKeys::const_iterator found = keys.find(it->first);
+      BOOST_REQUIRE(found != keys.end());
+      BOOST_CHECK_EQUAL_COLLECTIONS(found->second.begin(), found->second.end(),
+                                    it->second.begin(), it->second.end());
+    }
+  }
+
+  // default merge, all runs in order
+  void defaultMerge(const DataSet& data, RunKeys& keys)
+  {
+    const std::vector<unsigned> runs = readEvents(data.files, Mode(), keys);
+    BOOST_REQUIRE_EQUAL(runs.size(), nRuns);
+    for (unsigned i = 0; i != nRuns; ++ i) BOOST_CHECK_EQUAL(runs[i], i + 1);
+  }
+
+  // check one mode against the default merge, runs in order unless completionOrder
+  void checkMode(const DataSet& data, const RunKeys& expected, const Mode& mode)
+  {
+    RunKeys keys;
+    const std::vector<unsigned> runs = readEvents(data.files, mode, keys);
+    BOOST_CHECK_EQUAL(runs.size(), nRuns);
+    if (not mode.completionOrder) {
+      for (unsigned i = 0; i != runs.size(); ++ i) BOOST_CHECK_EQUAL(runs[i], i + 1);
+    }
+    checkSame(expected, keys);
+  }
+
+}
+
+// ==============================================================
+
+BOOST_AUTO_TEST_CASE( test_merge_modes )
+{
+  DataSet data;
+  RunKeys expected;
+  defaultMerge(data, expected);
+
+  // every event has the datagrams of all streams which have it
+  for (RunKeys::const_iterator it = expected.begin(); it != expected.end(); ++ it) {
+    const Keys& keys = it->second;
+    BOOST_CHECK_EQUAL(keys.front(), "4/0/4");
+    BOOST_CHECK_EQUAL(keys.back(), "5/0/4");
+    Keys l1Keys;
+    char l1[8];
+    snprintf(l1, sizeof l1, "%d/", int(Pds::TransitionId::L1Accept));
+    for (unsigned i = 0; i != keys.size(); ++ i) {
+      if (keys[i].compare(0, strlen(l1), l1) == 0) l1Keys.push_back(keys[i]);
+    }
+    BOOST_REQUIRE_EQUAL(l1Keys.size(), nCycles*nL1Accepts);
+    for (unsigned n = 0; n != l1Keys.size(); ++ n) {
+      const unsigned i = n % nL1Accepts;
+      const size_t size = 1 + (i % 7 != 3) + (i % 11 != 5) + (i % 4 == 0);
+      BOOST_CHECK_EQUAL(l1Keys[n], key(l1Accept(3000*it->first + 3*n), size));
+    }
+  }
+
+  Mode mode;
+  mode.engine = XtcStreamMerger::LoserTreeEngine;
+  checkMode(data, expected, mode);
+
+  mode = Mode();
+  mode.engine = XtcStreamMerger::HashJoinEngine;
+  checkMode(data, expected, mode);
+
+  mode = Mode();
+  mode.prefetchChunks = 2;
+  checkMode(data, expected, mode);
+
+  mode = Mode();
+  mode.pipelineRuns = true;
+  checkMode(data, expected, mode);
+
+  mode = Mode();
+  mode.cycleThreads = 3;
+  checkMode(data, expected, mode);
+
+  mode = Mode();
+  mode.concurrentRuns = 2;
+  checkMode(data, expected, mode);
+
+  mode = Mode();
+  mode.concurrentRuns = 3;
+  mode.completionOrder = true;
+  checkMode(data, expected, mode);
+
+  // everything at once
+  mode = Mode();
+  mode.engine = XtcStreamMerger::LoserTreeEngine;
+  mode.prefetchChunks = 2;
+  mode.cycleThreads = 2;
+  mode.concurrentRuns = 2;
+  checkMode(data, expected, mode);
+}
+
+BOOST_AUTO_TEST_CASE( test_single_stream )
+{
+  DataSet data;
+
+  // datagrams of stream 0 in the events of the default merge
+  RunKeys expected;
+  {
+    boost::shared_ptr<RunFileIterI> runIter =
+        boost::make_shared<RunFileIterList>(data.files.begin(), data.files.end(), MergeFileName);
+    XtcMergeIterator iter(runIter, 0, 80, 85, boost::shared_ptr<XtcFilesPosition>());
+    while (true) {
+      DgramList event = iter.nextEvent();
+      if (event.size() == 0) break;
+      const int i = event.findStream(0);
+      if (i >= 0) expected[event.file(i).run()].push_back(key(*event.dg(i), 1));
+    }
+  }
+
+  // merging is bypassed for one stream, same datagrams are skipped
+  const std::vector<XtcFileName> files = data.streamFiles(0);
+  for (unsigned prefetch = 0; prefetch <= 2; prefetch += 2) {
+    Mode mode;
+    mode.prefetchChunks = prefetch;
+    RunKeys keys;
+    readEvents(files, mode, keys);
+    checkSame(expected, keys);
+  }
+}
@@ -14,12 +14,15 @@
 // C/C++ Headers --
 //-----------------
 #include <algorithm>
+#include <cstdio>
 #include <iostream>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <boost/bind.hpp>
 #include <boost/make_shared.hpp>
+#include <boost/thread/thread.hpp>
 
 //----------------------
 // Base Class Headers --
@@ -79,6 +82,9 @@ protected :
   /// write a bunch of datagrams to a file
   void write(const std::string& fileName, const ::DgData* dgData);
 
+  /// write datagrams to fileName.inprogress one by one like DAQ does, rename at the end
+  static void writeLive(const std::string& fileName, const ::DgData* dgData, unsigned delayMs);
+
   void test(const ::DgData* in, const ::DgData* out);
   void test1();
   void test2();
@@ -86,6 +92,7 @@ protected :
   void test4();
   void test5();
   void test6();
+  void test7();
 
 private:
 
@@ -119,6 +126,7 @@ XtcReadAheadTest::runApp ()
   test4();
   test5();
   test6();
+  test7();
 
   // return 0 on success, other values for error (like main())
   return 0 ;
@@ -315,6 +323,57 @@ XtcReadAheadTest::test6()
   test(dgDataIn, dgDataOut);
 }
 
+void
+XtcReadAheadTest::test7()
+{
+  // Live data from a single stream, writer is slower than the reader.
+  // Read-ahead still waits for the writer so that datagrams are sorted.
+  MsgLog("test7", info, "running test7");
+
+  ::DgData dgDataIn[] = {
+      {10, Pds::TransitionId::L1Accept, 0},
+      {12, Pds::TransitionId::L1Accept, 0},
+      {11, Pds::TransitionId::L1Accept, 0},
+      {14, Pds::TransitionId::L1Accept, 0},
+      {13, Pds::TransitionId::L1Accept, 0},
+      // EOD
+      {0, Pds::TransitionId::Unknown, 0},
+  };
+
+  ::DgData dgDataOut[] = {
+      dgDataIn[0],
+      dgDataIn[2],
+      dgDataIn[1],
+      dgDataIn[4],
+      dgDataIn[3],
+      // EOD
+      {0, Pds::TransitionId::Unknown},
+  };
+
+  // first datagram is there when the reader opens the file
+  std::string fname = m_pathArg.value();
+  std::string inprogress = fname + ".inprogress";
+  unlink(fname.c_str());
+  ::DgData first[] = { dgDataIn[0], {0, Pds::TransitionId::Unknown, 0} };
+  write(inprogress, first);
+  boost::thread writer(boost::bind(&XtcReadAheadTest::writeLive, inprogress, dgDataIn+1, 300));
+
+  XtcFileName files[1] = { XtcFileName(inprogress) };
+  const unsigned liveTimeout = 10;
+  boost::shared_ptr<ChunkFileIterI> chunkFIter = boost::make_shared<ChunkFileIterList>(files+0, files+1, liveTimeout);
+  XtcStreamDgIter iter(chunkFIter);
+  const ::DgData* out = dgDataOut;
+  bool ok = true;
+  for ( ; ok and out->timeSec; ++ out) {
+    Dgram dg = iter.next();
+    ok = checkDg(dg.dg(), false, *out);
+  }
+  if (ok) checkDg(iter.next().dg(), true, *out);
+
+  writer.join();
+  unlink(fname.c_str());
+}
+
 void
 XtcReadAheadTest::test(const ::DgData* in, const ::DgData* out)
 {
@@ -376,6 +435,28 @@ XtcReadAheadTest::write(const std::string& fileName, const ::DgData* dgData)
   close(fd);
 }
 
+// write datagrams one by one with a delay, then rename to the final name
+void
+XtcReadAheadTest::writeLive(const std::string& fileName, const ::DgData* dgData, unsigned delayMs)
+{
+  int fd = ::open(fileName.c_str(), O_WRONLY|O_APPEND|O_SYNC);
+  if (fd < 0) {
+    MsgLog("writer", error, "Failed to open output file: " << fileName);
+    return;
+  }
+
+  for ( ; dgData->timeSec; ++ dgData) {
+    boost::this_thread::sleep(boost::posix_time::milliseconds(delayMs));
+    Dgram::ptr dg = makeDgram(*dgData);
+    ::write(fd, (char*)dg.get(), sizeof(Pds::Dgram)+dg->xtc.sizeofPayload());
+  }
+  close(fd);
+
+  // reader sees EOF once the file has its final name
+  std::string finalName(fileName, 0, fileName.size()-11);
+  std::rename(fileName.c_str(), finalName.c_str());
+}
+
 int
 XtcReadAheadTest::open(const std::string& fileName)
 {